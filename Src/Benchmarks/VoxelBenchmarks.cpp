@@ -0,0 +1,1871 @@
+#include "Benchmarks/VoxelBenchmarks.hpp"
+#include "Voxel/VoxelTypes.hpp"
+#include "Voxel/ChunkTable.hpp"
+#include "Voxel/ChunkMesher.hpp"
+#include "Voxel/TransparentQuadSorter.hpp"
+#include "WorldGeneration/PerlinNoiseGenerator.hpp"
+#include "WorldGeneration/WorldNoise.hpp"
+#include "WorldGeneration/TerrainGenerator.hpp"
+#include "WorldGeneration/NoiseGraph.hpp"
+#include "Utilities/Profiling.hpp"
+#include "Utilities/OpenAddressingMap.hpp"
+
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <random>
+#include <vector>
+#include <map>
+#include <unordered_map>
+#include <unordered_set>
+#include <algorithm>
+#include <cmath>
+#include <cassert>
+#include <cstring>
+#include <cstdlib>
+#include <new>
+
+#ifdef BENCHMARK_COUNT_ALLOCATIONS
+// counts the heap allocations a thread makes while countAllocations is set (see runMeshScratchBenchmark).
+// This replaces the global operator new/delete, so it's only built with cmake -DBENCHMARK_COUNT_ALLOCATIONS=ON
+namespace {
+thread_local bool countAllocations = false;
+thread_local size_t numAllocations = 0;
+}
+
+void* operator new(std::size_t size) {
+    if(countAllocations) {
+        numAllocations++;
+    }
+    if(void* p = std::malloc(size == 0? 1 : size)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept {
+    std::free(p);
+}
+#endif
+
+namespace {
+
+// matches MTLEngine::chunkDims
+const Int3D benchChunkDims = {16, 32, 16};
+const int numBenchChunks = 64;
+
+// voxel types of one chunk, in x/y/z loop order
+typedef std::vector<EVoxelType> TerrainSample;
+
+// same shape of terrain as MTLEngine::generateChunk (first pass), so palettes
+// and type distributions are representative
+TerrainSample generateTestTerrain() {
+    const WorldNoise perlin(1);
+    const Int3D dims = benchChunkDims;
+    const simd::float3 dimsFloat3 = simd::make_float3(dims.x, dims.y, dims.z);
+    const int seaLevel = 5;
+    
+    TerrainSample sample(dims.x * dims.y * dims.z, EVoxelType::None);
+    auto at = [&](int x, int y, int z)->EVoxelType& { return sample[(x * dims.y + y) * dims.z + z]; };
+    
+    for(int x=0; x<dims.x; x++) {
+        for(int y=0; y<dims.y; y++) {
+            for(int z=0; z<dims.z; z++) {
+                simd::float3 v = simd::make_float3(x, y, z) / dimsFloat3;
+                
+                float p = perlin.noise(v) + ((float) y / dims.y) * 0.9f;
+                EVoxelType voxelType = p > 0? EVoxelType::None : EVoxelType::Dirt;
+                
+                if(y == 0) {
+                    voxelType = EVoxelType::Stone;
+                }
+                if(voxelType == EVoxelType::Dirt && y < seaLevel + (-25 * perlin.noise(v * 0.5f) + 5)) {
+                    voxelType = EVoxelType::Stone;
+                }
+                if(voxelType == EVoxelType::None && y > 0 && at(x, y-1, z) == EVoxelType::Dirt) {
+                    at(x, y-1, z) = EVoxelType::Grass;
+                }
+                if(voxelType == EVoxelType::None && y < seaLevel) {
+                    voxelType = EVoxelType::Water;
+                }
+                
+                at(x, y, z) = voxelType;
+            }
+        }
+    }
+    
+    return sample;
+}
+
+template<typename ChunkType>
+void fillChunk(ChunkType& chunk, const TerrainSample& sample) {
+    const Int3D dims = benchChunkDims;
+    int i = 0;
+    for(int x=0; x<dims.x; x++) {
+        for(int y=0; y<dims.y; y++) {
+            for(int z=0; z<dims.z; z++) {
+                chunk.setVoxel({x, y, z}, sample[i++]);
+            }
+        }
+    }
+}
+
+std::string formatBytes(double bytes) {
+    std::ostringstream ss;
+    ss << std::fixed << std::setprecision(2);
+    if(bytes >= 1024.0 * 1024.0) {
+        ss << bytes / (1024.0 * 1024.0) << " MB";
+    }
+    else {
+        ss << bytes / 1024.0 << " KB";
+    }
+    return ss.str();
+}
+
+void printThroughput(const char* label, double numOps, double microseconds) {
+    std::cout << "    " << std::left << std::setw(28) << label
+              << std::right << std::fixed << std::setprecision(1) << std::setw(10) << numOps / microseconds << " Mvoxels/s" << std::endl;
+}
+
+// greedy-mesher style sweep: for every slice along axis d, compare each voxel with
+// its neighbor at +d (returns the number of faces found, so the loop can't be optimized away)
+template<typename ChunkType>
+int sweepAxis(const ChunkType& chunk, int d) {
+    const Int3D dimsU = chunk.getDimensions();
+    const std::array<int, 3> dims = {dimsU.x, dimsU.y, dimsU.z};
+    const int u = (d+1)%3;
+    const int v = (d+2)%3;
+    
+    std::array<int, 3> x = {0,0,0};
+    std::array<int, 3> q = {0,0,0};
+    q[d] = 1;
+    
+    int numFaces = 0;
+    for(x[d]=-1; x[d]<dims[d]; x[d]++) {
+        for(x[v]=0; x[v]<dims[v]; x[v]++) {
+            for(x[u]=0; x[u]<dims[u]; x[u]++) {
+                const EVoxelType a = chunk.getVoxel({x[0], x[1], x[2]});
+                const EVoxelType b = chunk.getVoxel({x[0]+q[0], x[1]+q[1], x[2]+q[2]});
+                numFaces += (a == EVoxelType::None) != (b == EVoxelType::None);
+            }
+        }
+    }
+    return numFaces;
+}
+
+template<typename VoxelLayout>
+void benchmarkLayout(const char* layoutName, EVoxelStorageMode storageMode, const std::vector<TerrainSample>& terrain) {
+    std::vector<BasicChunk<VoxelLayout>> chunks;
+    chunks.reserve(terrain.size());
+    for(const TerrainSample& sample : terrain) {
+        chunks.emplace_back(nullptr, storageMode);
+        chunks.back().setDimensions(benchChunkDims);
+        fillChunk(chunks.back(), sample);
+        chunks.back().compactVoxelStorage();
+    }
+    
+    const double numVoxels = (double) terrain.size() * benchChunkDims.x * benchChunkDims.y * benchChunkDims.z;
+    const char* axisNames[3] = {"x", "y", "z"};
+    
+    std::cout << layoutName << " / " << (storageMode == EVoxelStorageMode::Flat? "Flat" : "Palette") << std::endl;
+    
+    int checksum = 0;
+    for(int d = 0; d < 3; d++) {
+        Timer t("sweep", false);
+        for(const auto& chunk : chunks) {
+            checksum += sweepAxis(chunk, d);
+        }
+        const std::string label = std::string("sweep along ") + axisNames[d] + " (d=" + std::to_string(d) + ")";
+        printThroughput(label.c_str(), numVoxels, t.getDurationMicroseconds());
+    }
+    
+    {
+        Timer t("cache order", false);
+        for(const auto& chunk : chunks) {
+            chunk.forEachNonEmptySectionVoxel([&](Int3D, EVoxelType type) {
+                checksum += type != EVoxelType::None;
+            });
+        }
+        printThroughput("cache-order iteration", numVoxels, t.getDurationMicroseconds());
+    }
+    
+    std::cout << "    (checksum " << checksum << ")" << std::endl;
+}
+
+// the std::hash<Int3D> the engine used before PackedInt3D/mixHash64, kept to show its collisions
+struct LegacyInt3DHash {
+    std::size_t operator()(const Int3D& k) const {
+        return ((std::hash<int>()(k.x) ^ (std::hash<int>()(k.y) << 1)) >> 1) ^ (std::hash<int>()(k.z) << 1);
+    }
+};
+
+// chunk indices within loadDistance of center, nearest first (like updateVisibleChunkIndices)
+std::vector<Int3D> loadAreaKeys(Int3D center, int loadDistance) {
+    std::vector<Int3D> keys;
+    for(int x = -loadDistance; x <= loadDistance; x++) {
+        for(int z = -loadDistance; z <= loadDistance; z++) {
+            keys.push_back(center.delta(x, 0, z));
+        }
+    }
+    std::stable_sort(keys.begin(), keys.end(), [&](const Int3D& a, const Int3D& b) {
+        const Int3D da = a - center;
+        const Int3D db = b - center;
+        return da.x*da.x + da.z*da.z < db.x*db.x + db.z*db.z;
+    });
+    return keys;
+}
+
+// lets one benchmark loop drive both the std containers and OpenAddressingMap
+template<typename Map, typename K>
+void mapInsert(Map& map, const K& key, int value) { map.insert({key, value}); }
+
+template<typename K, typename V, typename H>
+void mapInsert(OpenAddressingMap<K, V, H>& map, const K& key, int value) { map.insert(key, value); }
+
+template<typename Map, typename K>
+bool mapContains(const Map& map, const K& key) { return map.find(key) != map.end(); }
+
+template<typename K, typename V, typename H>
+bool mapContains(const OpenAddressingMap<K, V, H>& map, const K& key) { return map.contains(key); }
+
+template<typename K>
+K makeKey(const Int3D& v) { return K(v); }
+
+template<>
+Int3D makeKey<Int3D>(const Int3D& v) { return v; }
+
+// simulates the engine's access pattern: fill the load area, then walk the player along +x.
+// Every step drops the trailing column, adds the leading one, and looks up every loaded chunk
+// plus its 4 neighbors (as tryMeshChunk/meshChunk do)
+template<typename Map, typename K>
+void benchmarkContainer(const char* name, int loadDistance, int numSteps) {
+    // the load area is the same shape around every center, so sort it once outside the timer
+    const std::vector<Int3D> offsets = loadAreaKeys({0, 0, 0}, loadDistance);
+    
+    Map map;
+    long long numOps = 0;
+    long long found = 0;
+    
+    Timer t("container", false);
+    
+    Int3D center = {0, 0, 0};
+    for(const Int3D& offset : offsets) {
+        mapInsert(map, makeKey<K>(center + offset), 0);
+        numOps++;
+    }
+    
+    for(int step = 0; step < numSteps; step++) {
+        for(int z = -loadDistance; z <= loadDistance; z++) {
+            map.erase(makeKey<K>(center.delta(-loadDistance, 0, z)));
+            mapInsert(map, makeKey<K>(center.delta(loadDistance + 1, 0, z)), step);
+            numOps += 2;
+        }
+        center = center.delta(1, 0, 0);
+        
+        for(const Int3D& offset : offsets) {
+            const Int3D key = center + offset;
+            found += mapContains(map, makeKey<K>(key));
+            for(const Int3D& n : key.getNeighbors()) {
+                found += mapContains(map, makeKey<K>(n));
+            }
+            numOps += 5;
+        }
+    }
+    
+    const double microseconds = t.getDurationMicroseconds();
+    std::cout << "    " << std::left << std::setw(40) << name
+              << std::right << std::fixed << std::setprecision(1) << std::setw(8) << microseconds * 1000.0 / numOps << " ns/op"
+              << "    (found " << found << ")" << std::endl;
+}
+
+// number of keys that share a bucket with an earlier key, for a table with numBuckets buckets
+template<typename Hash>
+int countBucketCollisions(const std::vector<Int3D>& keys, size_t numBuckets) {
+    std::unordered_set<size_t> used;
+    int collisions = 0;
+    for(const Int3D& key : keys) {
+        collisions += !used.insert(Hash()(key) % numBuckets).second;
+    }
+    return collisions;
+}
+
+// chunks of test terrain, each meshed against others of the set as its neighbors
+// (every other chunk also gets a chunk below it, the rest have air above and below)
+struct MeshBenchWorld {
+    std::vector<ChunkHandle> chunks;
+    std::vector<ChunkMeshNeighbors> neighbors;
+};
+
+MeshBenchWorld createMeshBenchWorld() {
+    MeshBenchWorld world;
+    for(int i = 0; i < numBenchChunks; i++) {
+        ChunkHandle chunk = std::make_shared<Chunk>(nullptr, EVoxelStorageMode::Palette);
+        chunk->setDimensions(benchChunkDims);
+        chunk->setPosition(Int3D(i, 0, 0) * benchChunkDims);
+        fillChunk(*chunk, generateTestTerrain());
+        chunk->compactVoxelStorage();
+        world.chunks.push_back(std::move(chunk));
+    }
+    
+    for(int i = 0; i < numBenchChunks; i++) {
+        ChunkMeshNeighbors neighbors;
+        for(int n = 0; n < 4; n++) {
+            neighbors[n] = world.chunks[(i + n + 1) % numBenchChunks].get();
+        }
+        neighbors[4] = i % 2 == 1? world.chunks[(i + 5) % numBenchChunks].get() : nullptr;
+        neighbors[5] = nullptr;
+        world.neighbors.push_back(neighbors);
+    }
+    return world;
+}
+
+bool sameQuads(const std::vector<ChunkMeshQuad>& a, const std::vector<ChunkMeshQuad>& b) {
+    if(a.size() != b.size()) {
+        return false;
+    }
+    for(size_t i = 0; i < a.size(); i++) {
+        for(int p = 0; p < 4; p++) {
+            const simd::float4 pa = a[i].positions[p];
+            const simd::float4 pb = b[i].positions[p];
+            if(pa.x != pb.x || pa.y != pb.y || pa.z != pb.z || pa.w != pb.w) {
+                return false;
+            }
+        }
+        if(a[i].normal.x != b[i].normal.x || a[i].normal.y != b[i].normal.y || a[i].normal.z != b[i].normal.z ||
+           a[i].width != b[i].width || a[i].height != b[i].height || a[i].vxType != b[i].vxType ||
+           a[i].aoLevels != b[i].aoLevels) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// total area of the quads per (type, axis), which doesn't depend on how the faces were merged
+std::array<std::array<double, 3>, numVoxelTypes> faceAreaPerTypeAndAxis(const ChunkMeshQuads& quads) {
+    std::array<std::array<double, 3>, numVoxelTypes> area = {};
+    for(const std::vector<ChunkMeshQuad>* list : {&quads.opaque, &quads.water}) {
+        for(const ChunkMeshQuad& q : *list) {
+            const int axis = q.normal.x != 0.0f? 0 : (q.normal.y != 0.0f? 1 : 2);
+            area[(int) q.vxType][axis] += q.width * q.height;
+        }
+    }
+    return area;
+}
+
+// meshes every chunk of the world numRounds times, returns chunks/s
+double benchmarkMesher(EChunkMesher mesher, const MeshBenchWorld& world, int numRounds) {
+    ChunkMeshQuads quads;
+    size_t checksum = 0;
+    
+    Timer t("mesher", false);
+    for(int round = 0; round < numRounds; round++) {
+        for(size_t i = 0; i < world.chunks.size(); i++) {
+            quads.clear();
+            ChunkMesher::mesh(mesher, *world.chunks[i], world.neighbors[i], quads);
+            checksum += quads.opaque.size() + quads.water.size();
+        }
+    }
+    const double microseconds = t.getDurationMicroseconds();
+    
+    assert(checksum > 0);
+    return numRounds * world.chunks.size() / (microseconds / 1000000.0);
+}
+
+// the engine's atlas for the meshed voxel types
+const std::map<EVoxelType, VoxelAtlasEntry> benchAtlas = {
+    {EVoxelType::Grass, VoxelAtlasEntry(1,1,1,1,2,0)},
+    {EVoxelType::Stone, VoxelAtlasEntry(3)},
+    {EVoxelType::Dirt, VoxelAtlasEntry(0)},
+    {EVoxelType::Water, VoxelAtlasEntry(32)},
+};
+
+// an IndexedQuads vertex buffer as the vertices its indexed draw reads, i.e. in Triangles layout
+template<typename Vertex>
+std::vector<Vertex> expandIndexedQuads(const std::vector<Vertex>& vertices) {
+    std::vector<uint32_t> indices;
+    ChunkMesher::writeQuadIndices(vertices.size() / 4, indices);
+    
+    std::vector<Vertex> out;
+    out.reserve(indices.size());
+    for(const uint32_t i : indices) {
+        out.push_back(vertices[i]);
+    }
+    return out;
+}
+
+bool samePlanes(const ChunkMeshPlanes& a, const ChunkMeshPlanes& b) {
+    for(int d = 0; d < 3; d++) {
+        if(a.planes[d].size() != b.planes[d].size()) {
+            return false;
+        }
+        for(size_t p = 0; p < a.planes[d].size(); p++) {
+            if(!sameQuads(a.planes[d][p].opaque, b.planes[d][p].opaque) || !sameQuads(a.planes[d][p].water, b.planes[d][p].water)) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+// a chunk's quads, split by plane like ChunkMesher::meshPlanes
+ChunkMeshPlanes splitIntoPlanes(const Chunk& chunk, const ChunkMeshQuads& quads) {
+    ChunkMeshPlanes planes;
+    planes.init(chunk.getDimensions());
+    const simd::float3 chunkPosition = chunk.getPositionAsFloat3();
+    for(const std::vector<ChunkMeshQuad>* list : {&quads.opaque, &quads.water}) {
+        for(const ChunkMeshQuad& q : *list) {
+            const int d = q.normal.x != 0.0f? 0 : (q.normal.y != 0.0f? 1 : 2);
+            const int p = (int) (q.positions[0][d] - chunkPosition[d]);
+            ChunkMeshQuads& plane = planes.planes[d][p];
+            (list == &quads.water? plane.water : plane.opaque).push_back(q);
+        }
+    }
+    return planes;
+}
+
+bool sameVertex(const VertexData& a, const VertexData& b) {
+    return a.position.x == b.position.x && a.position.y == b.position.y && a.position.z == b.position.z && a.position.w == b.position.w &&
+           a.textureCoordinates.x == b.textureCoordinates.x && a.textureCoordinates.y == b.textureCoordinates.y &&
+           a.normal.x == b.normal.x && a.normal.y == b.normal.y && a.normal.z == b.normal.z &&
+           a.atlasIndex == b.atlasIndex && a.occlusion == b.occlusion &&
+           a.colorScale.x == b.colorScale.x && a.colorScale.y == b.colorScale.y && a.colorScale.z == b.colorScale.z;
+}
+
+// builds every chunk's vertices from its quads and copies them to an upload buffer, numRounds times.
+// writeVertices(chunkIndex, outVertices). Returns vertices/s
+template<typename Vertex, typename WriteFunc>
+double benchmarkVertexBuild(size_t numChunks, int numRounds, WriteFunc writeVertices) {
+    std::vector<Vertex> vertices;
+    std::vector<Vertex> uploadBuffer;
+    size_t numVertices = 0;
+    
+    Timer t("vertex build", false);
+    for(int round = 0; round < numRounds; round++) {
+        for(size_t i = 0; i < numChunks; i++) {
+            vertices.clear();
+            writeVertices(i, vertices);
+            uploadBuffer.resize(vertices.size());
+            std::memcpy(uploadBuffer.data(), vertices.data(), vertices.size() * sizeof(Vertex));
+            numVertices += vertices.size();
+        }
+    }
+    const double microseconds = t.getDurationMicroseconds();
+    
+    assert(numVertices > 0);
+    return numVertices / (microseconds / 1000000.0);
+}
+
+} // namespace
+
+void VoxelBenchmarks::runAll() {
+    runVoxelStorageBenchmark();
+    runVoxelLayoutBenchmark();
+    runHashContainerBenchmark();
+    runChunkPoolBenchmark();
+    runMesherBenchmark();
+    runVertexFormatBenchmark();
+    runIncrementalMeshBenchmark();
+    runFaceDirectionCullingBenchmark();
+    runLODMeshBenchmark();
+    runBakedAOBenchmark();
+    runTransparentSortBenchmark();
+    runMeshScratchBenchmark();
+    runNoiseBenchmark();
+    runTerrainGenerationBenchmark();
+    runTerrainLatticeBenchmark();
+    runNoiseGraphBenchmark();
+}
+
+void VoxelBenchmarks::runVoxelStorageBenchmark() {
+    std::cout << "=== Voxel storage: Flat vs Palette ===" << std::endl;
+    
+    std::vector<TerrainSample> terrain;
+    for(int i = 0; i < numBenchChunks; i++) {
+        terrain.push_back(generateTestTerrain());
+    }
+    
+    const Int3D dims = benchChunkDims;
+    const int volume = dims.x * dims.y * dims.z;
+    
+    // random coordinates shared by both modes
+    std::vector<Int3D> randomCoords;
+    {
+        std::default_random_engine gen(1234);
+        std::uniform_int_distribution<int> dx(0, dims.x - 1), dy(0, dims.y - 1), dz(0, dims.z - 1);
+        for(int i = 0; i < volume; i++) {
+            randomCoords.push_back(Int3D(dx(gen), dy(gen), dz(gen)));
+        }
+    }
+    
+    const std::array<EVoxelStorageMode, 2> modes = { EVoxelStorageMode::Flat, EVoxelStorageMode::Palette };
+    const std::array<const char*, 2> modeNames = { "Flat", "Palette" };
+    
+    for(int m = 0; m < (int) modes.size(); m++) {
+        std::vector<Chunk> chunks;
+        chunks.reserve(numBenchChunks);
+        
+        double writeUS = 0.0;
+        for(int i = 0; i < numBenchChunks; i++) {
+            chunks.emplace_back(nullptr, modes[m]);
+            chunks.back().setDimensions(dims);
+            
+            Timer t("write", false);
+            fillChunk(chunks.back(), terrain[i]);
+            chunks.back().compactVoxelStorage();
+            writeUS += t.getDurationMicroseconds();
+        }
+        
+        // verify both modes hold the same data
+        for(int i = 0; i < numBenchChunks; i++) {
+            int j = 0;
+            for(int x=0; x<dims.x; x++) {
+                for(int y=0; y<dims.y; y++) {
+                    for(int z=0; z<dims.z; z++) {
+                        if(chunks[i].getVoxel({x,y,z}) != terrain[i][j++]) {
+                            std::cout << "    ERROR: voxel mismatch in chunk " << i << std::endl;
+                            return;
+                        }
+                    }
+                }
+            }
+        }
+        
+        int nonEmpty = 0;
+        
+        Timer seqTimer("sequential read", false);
+        for(const Chunk& chunk : chunks) {
+            // y-major loop, matching the raw index order
+            for(int y=0; y<dims.y; y++) {
+                for(int z=0; z<dims.z; z++) {
+                    for(int x=0; x<dims.x; x++) {
+                        nonEmpty += chunk.getVoxel({x,y,z}) != EVoxelType::None;
+                    }
+                }
+            }
+        }
+        const double seqUS = seqTimer.getDurationMicroseconds();
+        
+        Timer randTimer("random read", false);
+        for(const Chunk& chunk : chunks) {
+            for(const Int3D& c : randomCoords) {
+                nonEmpty += chunk.getVoxel(c) != EVoxelType::None;
+            }
+        }
+        const double randUS = randTimer.getDurationMicroseconds();
+        
+        ChunkMemoryUsage total;
+        int numSections = 0;
+        int numUniformSections = 0;
+        for(const Chunk& chunk : chunks) {
+            total += chunk.getMemoryUsage();
+            
+            for(int i = 0; i < chunk.getNumSections(); i++) {
+                numSections++;
+                numUniformSections += chunk.getSection(i).isUniform();
+            }
+        }
+        
+        const double numOps = (double) numBenchChunks * volume;
+        
+        std::cout << modeNames[m] << " (" << numBenchChunks << " chunks, checksum " << nonEmpty << ")" << std::endl;
+        printThroughput("write (generation)", numOps, writeUS);
+        printThroughput("sequential getVoxel", numOps, seqUS);
+        printThroughput("random getVoxel", numOps, randUS);
+        
+        const double voxelPerChunk = (double) total.voxelBytes / numBenchChunks;
+        const double collisionPerChunk = (double) total.collisionBytes / numBenchChunks;
+        std::cout << "    voxel bytes / chunk:        " << formatBytes(voxelPerChunk) << std::endl;
+        std::cout << "    collision grid / chunk:     " << formatBytes(collisionPerChunk) << " (empty, before meshing)" << std::endl;
+        std::cout << "    uniform sections:           " << numUniformSections << " / " << numSections << " (stored without an array)" << std::endl;
+        
+        for(int loadDistance : {16, 32, 48}) {
+            const int numChunks = (2 * loadDistance + 1) * (2 * loadDistance + 1);
+            std::cout << "    loadDistance " << std::setw(2) << loadDistance << " (" << std::setw(4) << numChunks << " chunks): "
+                      << "voxels " << formatBytes(voxelPerChunk * numChunks)
+                      << ", voxels + collision grid " << formatBytes((voxelPerChunk + collisionPerChunk) * numChunks) << std::endl;
+        }
+    }
+}
+
+void VoxelBenchmarks::runVoxelLayoutBenchmark() {
+    std::cout << "=== Voxel layout: Linear vs Morton (meshChunk-style sweeps) ===" << std::endl;
+    
+    std::vector<TerrainSample> terrain;
+    for(int i = 0; i < numBenchChunks; i++) {
+        terrain.push_back(generateTestTerrain());
+    }
+    
+    for(EVoxelStorageMode storageMode : {EVoxelStorageMode::Flat, EVoxelStorageMode::Palette}) {
+        benchmarkLayout<LinearVoxelLayout>("Linear", storageMode, terrain);
+        benchmarkLayout<MortonVoxelLayout>("Morton", storageMode, terrain);
+    }
+}
+
+void VoxelBenchmarks::runHashContainerBenchmark() {
+    std::cout << "=== Int3D hashing and chunk containers ===" << std::endl;
+    
+    // symmetric keys like (x,0,z) and (z,0,x) are exactly the ones the legacy hash collapses
+    for(int loadDistance : {16, 32}) {
+        const std::vector<Int3D> keys = loadAreaKeys({0, 0, 0}, loadDistance);
+        const size_t numBuckets = 1 << (int) std::ceil(std::log2((double) keys.size() * 2));
+        
+        std::cout << "  load area " << loadDistance << " (" << keys.size() << " keys, " << numBuckets << " buckets)" << std::endl;
+        std::cout << "    bucket collisions, legacy XOR hash   " << countBucketCollisions<LegacyInt3DHash>(keys, numBuckets) << std::endl;
+        std::cout << "    bucket collisions, std::hash<Int3D>  " << countBucketCollisions<std::hash<Int3D>>(keys, numBuckets) << std::endl;
+    }
+    
+    // sanity check the packed key round trip over the signed range we care about
+    for(const Int3D& v : {Int3D(0, 0, 0), Int3D(-1, -1, -1), Int3D(1048575, -1048576, 12345), Int3D(-70000, 255, 70000)}) {
+        assert(PackedInt3D(v).unpack() == v);
+    }
+    
+    const int numSteps = 64;
+    for(int loadDistance : {16, 32}) {
+        std::cout << "  walking " << numSteps << " chunks, load distance " << loadDistance << std::endl;
+        benchmarkContainer<std::map<Int3D, int>, Int3D>("std::map<Int3D>", loadDistance, numSteps);
+        benchmarkContainer<std::unordered_map<Int3D, int, LegacyInt3DHash>, Int3D>("std::unordered_map<Int3D> legacy hash", loadDistance, numSteps);
+        benchmarkContainer<std::unordered_map<Int3D, int>, Int3D>("std::unordered_map<Int3D>", loadDistance, numSteps);
+        benchmarkContainer<std::unordered_map<PackedInt3D, int>, PackedInt3D>("std::unordered_map<PackedInt3D>", loadDistance, numSteps);
+        benchmarkContainer<OpenAddressingMap<Int3D, int>, Int3D>("OpenAddressingMap<Int3D>", loadDistance, numSteps);
+        benchmarkContainer<OpenAddressingMap<PackedInt3D, int>, PackedInt3D>("OpenAddressingMap<PackedInt3D>", loadDistance, numSteps);
+    }
+}
+
+void VoxelBenchmarks::runChunkPoolBenchmark() {
+    std::cout << "=== Chunk block pools: generate + collide + unload churn ===" << std::endl;
+    
+    std::vector<TerrainSample> terrain;
+    for(int i = 0; i < numBenchChunks; i++) {
+        terrain.push_back(generateTestTerrain());
+    }
+    
+    // one collision rect per surface column, roughly what meshing adds for the top faces
+    auto addSurfaceRects = [](Chunk& chunk) {
+        const Int3D dims = chunk.getDimensions();
+        for(int x = 0; x < dims.x; x++) {
+            for(int z = 0; z < dims.z; z++) {
+                int y = dims.y - 1;
+                while(y > 0 && chunk.getVoxel({x, y, z}) == EVoxelType::None) {
+                    y--;
+                }
+                const float top = (float) y + 1.0f;
+                chunk.addCollisionRect(chunk.makeCollisionRect({simd::make_float3(x, top, z), simd::make_float3(x + 1, top, z),
+                                                                simd::make_float3(x + 1, top, z + 1), simd::make_float3(x, top, z + 1)},
+                                                               simd::make_float3(0, 1, 0)));
+            }
+        }
+    };
+    
+    const int numRounds = 8;
+    
+    for(bool warmPool : {false, true}) {
+        for(EVoxelStorageMode storageMode : {EVoxelStorageMode::Flat, EVoxelStorageMode::Palette}) {
+            // a cold pool behaves like plain new/delete: every block is freshly allocated
+            const auto voxelStatsBefore = ChunkSection::getVoxelBlockPool().getStats();
+            const auto collisionStatsBefore = ChunkSection::getCollisionBlockPool().getStats();
+            
+            double microseconds = 0.0;
+            for(int round = 0; round < numRounds; round++) {
+                if(!warmPool) {
+                    ChunkSection::getVoxelBlockPool().trim();
+                    ChunkSection::getCollisionBlockPool().trim();
+                }
+                
+                Timer t("round", false);
+                {
+                    std::vector<ChunkHandle> chunks;
+                    for(const TerrainSample& sample : terrain) {
+                        ChunkHandle chunk = std::make_shared<Chunk>(nullptr, storageMode);
+                        chunk->setDimensions(benchChunkDims);
+                        fillChunk(*chunk, sample);
+                        chunk->compactVoxelStorage();
+                        addSurfaceRects(*chunk);
+                        chunks.push_back(std::move(chunk));
+                    }
+                    // unloaded here
+                }
+                microseconds += t.getDurationMicroseconds();
+            }
+            
+            const auto voxelStats = ChunkSection::getVoxelBlockPool().getStats();
+            const auto collisionStats = ChunkSection::getCollisionBlockPool().getStats();
+            
+            std::cout << "  " << (warmPool? "warm pool" : "cold pool") << " / " << (storageMode == EVoxelStorageMode::Flat? "Flat" : "Palette") << std::endl;
+            std::cout << "    " << std::left << std::setw(28) << "chunks/s"
+                      << std::right << std::fixed << std::setprecision(1) << std::setw(10)
+                      << numRounds * terrain.size() / (microseconds / 1000000.0) << std::endl;
+            std::cout << "    voxel blocks allocated " << voxelStats.numAllocated - voxelStatsBefore.numAllocated
+                      << ", reused " << voxelStats.numReused - voxelStatsBefore.numReused << std::endl;
+            std::cout << "    collision blocks allocated " << collisionStats.numAllocated - collisionStatsBefore.numAllocated
+                      << ", reused " << collisionStats.numReused - collisionStatsBefore.numReused << std::endl;
+        }
+    }
+}
+
+void VoxelBenchmarks::runMesherBenchmark() {
+    std::cout << "=== Greedy meshing: Scalar vs Bitmask vs SinglePass ===" << std::endl;
+    
+    const MeshBenchWorld world = createMeshBenchWorld();
+    
+    // the bitmask mesher must reproduce the scalar one exactly, quad for quad. The single-pass one
+    // merges differently, but must cover the same faces
+    size_t numScalarQuads = 0;
+    size_t numSinglePassQuads = 0;
+    int numBitmaskMismatches = 0;
+    int numSinglePassMismatches = 0;
+    for(size_t i = 0; i < world.chunks.size(); i++) {
+        ChunkMeshQuads scalarQuads;
+        ChunkMeshQuads bitmaskQuads;
+        ChunkMeshQuads singlePassQuads;
+        ChunkMesher::meshScalar(*world.chunks[i], world.neighbors[i], scalarQuads);
+        ChunkMesher::meshBitmask(*world.chunks[i], world.neighbors[i], bitmaskQuads);
+        ChunkMesher::meshSinglePass(*world.chunks[i], world.neighbors[i], singlePassQuads);
+        
+        numScalarQuads += scalarQuads.opaque.size() + scalarQuads.water.size();
+        numSinglePassQuads += singlePassQuads.opaque.size() + singlePassQuads.water.size();
+        if(!sameQuads(scalarQuads.opaque, bitmaskQuads.opaque) || !sameQuads(scalarQuads.water, bitmaskQuads.water)) {
+            numBitmaskMismatches++;
+        }
+        if(faceAreaPerTypeAndAxis(scalarQuads) != faceAreaPerTypeAndAxis(singlePassQuads)) {
+            numSinglePassMismatches++;
+        }
+    }
+    std::cout << "  Bitmask output: " << (numBitmaskMismatches == 0? "identical" : "MISMATCH") << " (" << numBitmaskMismatches << " of "
+              << world.chunks.size() << " chunks differ, " << numScalarQuads << " quads)" << std::endl;
+    std::cout << "  SinglePass faces: " << (numSinglePassMismatches == 0? "same" : "MISMATCH") << " (" << numSinglePassMismatches << " of "
+              << world.chunks.size() << " chunks differ, " << numSinglePassQuads << " quads)" << std::endl;
+    
+    const int numRounds = 8;
+    const double scalarChunksPerSecond = benchmarkMesher(EChunkMesher::Scalar, world, numRounds);
+    const double bitmaskChunksPerSecond = benchmarkMesher(EChunkMesher::Bitmask, world, numRounds);
+    const double singlePassChunksPerSecond = benchmarkMesher(EChunkMesher::SinglePass, world, numRounds);
+    
+    std::cout << std::fixed << std::setprecision(1);
+    std::cout << "    " << std::left << std::setw(28) << "Scalar chunks/s" << std::right << std::setw(10) << scalarChunksPerSecond << std::endl;
+    std::cout << "    " << std::left << std::setw(28) << "Bitmask chunks/s" << std::right << std::setw(10) << bitmaskChunksPerSecond
+              << "  (" << bitmaskChunksPerSecond / scalarChunksPerSecond << "x)" << std::endl;
+    std::cout << "    " << std::left << std::setw(28) << "SinglePass chunks/s" << std::right << std::setw(10) << singlePassChunksPerSecond
+              << "  (" << singlePassChunksPerSecond / scalarChunksPerSecond << "x)" << std::endl;
+}
+
+void VoxelBenchmarks::runVertexFormatBenchmark() {
+    std::cout << "=== Voxel vertex format: VertexData vs PackedVoxelVertex, Triangles vs IndexedQuads ===" << std::endl;
+    
+    const MeshBenchWorld world = createMeshBenchWorld();
+    std::vector<ChunkMeshQuads> chunkQuads(world.chunks.size());
+    for(size_t i = 0; i < world.chunks.size(); i++) {
+        ChunkMesher::meshBitmask(*world.chunks[i], world.neighbors[i], chunkQuads[i]);
+    }
+    
+    // every packed vertex must decode back to the VertexData the engine builds, and the indexed
+    // buffers must draw the same vertices as the Triangles ones
+    const std::vector<simd::float3> colorPalette = {{0, 0, 0}};
+    size_t numVertices = 0;
+    size_t numIndexedVertices = 0;
+    int numPackedMismatches = 0;
+    int numIndexedMismatches = 0;
+    for(size_t i = 0; i < world.chunks.size(); i++) {
+        std::vector<VertexData> vertices;
+        std::vector<VertexData> indexedVertices;
+        std::vector<PackedVoxelVertex> packedVertices;
+        std::vector<PackedVoxelVertex> indexedPackedVertices;
+        for(const std::vector<ChunkMeshQuad>* quads : {&chunkQuads[i].opaque, &chunkQuads[i].water}) {
+            ChunkMesher::writeVertices(*quads, benchAtlas, EChunkVertexLayout::Triangles, vertices);
+            ChunkMesher::writeVertices(*quads, benchAtlas, EChunkVertexLayout::IndexedQuads, indexedVertices);
+            ChunkMesher::writePackedVertices(*world.chunks[i], *quads, benchAtlas, 0, EChunkVertexLayout::Triangles, packedVertices);
+            ChunkMesher::writePackedVertices(*world.chunks[i], *quads, benchAtlas, 0, EChunkVertexLayout::IndexedQuads, indexedPackedVertices);
+        }
+        numVertices += vertices.size();
+        numIndexedVertices += indexedVertices.size();
+        
+        const simd::float3 chunkPosition = world.chunks[i]->getPositionAsFloat3();
+        bool samePacked = vertices.size() == packedVertices.size();
+        for(size_t v = 0; samePacked && v < vertices.size(); v++) {
+            samePacked = sameVertex(vertices[v], unpackVoxelVertex(packedVertices[v], chunkPosition, colorPalette));
+        }
+        numPackedMismatches += !samePacked;
+        
+        const std::vector<VertexData> expanded = expandIndexedQuads(indexedVertices);
+        const std::vector<PackedVoxelVertex> expandedPacked = expandIndexedQuads(indexedPackedVertices);
+        bool sameIndexed = indexedVertices.size() % 4 == 0 && expanded.size() == vertices.size() && expandedPacked.size() == packedVertices.size();
+        for(size_t v = 0; sameIndexed && v < vertices.size(); v++) {
+            sameIndexed = sameVertex(vertices[v], expanded[v]) &&
+                          expandedPacked[v].positionUV == packedVertices[v].positionUV &&
+                          expandedPacked[v].attributes == packedVertices[v].attributes;
+        }
+        numIndexedMismatches += !sameIndexed;
+    }
+    std::cout << "  Packed round trip: " << (numPackedMismatches == 0? "identical" : "MISMATCH") << " (" << numPackedMismatches << " of "
+              << world.chunks.size() << " chunks differ, " << numVertices << " vertices)" << std::endl;
+    std::cout << "  IndexedQuads draw: " << (numIndexedMismatches == 0? "identical" : "MISMATCH") << " (" << numIndexedMismatches << " of "
+              << world.chunks.size() << " chunks differ, " << numIndexedVertices << " vertices)" << std::endl;
+    
+    auto printSize = [&](const char* label, size_t vertexSize, size_t count) {
+        const double mb = count * vertexSize / (1024.0 * 1024.0);
+        std::cout << "    " << std::left << std::setw(28) << label << std::right << std::setw(4) << vertexSize << " B/vertex"
+                  << std::setw(10) << mb << " MB" << std::setw(10) << mb * 1024.0 / world.chunks.size() << " KB/chunk" << std::endl;
+    };
+    std::cout << std::fixed << std::setprecision(2);
+    printSize("VertexData", sizeof(VertexData), numVertices);
+    printSize("VertexData indexed", sizeof(VertexData), numIndexedVertices);
+    printSize("PackedVoxelVertex", sizeof(PackedVoxelVertex), numVertices);
+    printSize("PackedVoxelVertex indexed", sizeof(PackedVoxelVertex), numIndexedVertices);
+    
+    // build + copy to an upload buffer, from already meshed quads
+    const int numRounds = 16;
+    auto vertexDataPerSecond = [&](EChunkVertexLayout layout) {
+        return benchmarkVertexBuild<VertexData>(world.chunks.size(), numRounds, [&](size_t i, std::vector<VertexData>& out) {
+            ChunkMesher::writeVertices(chunkQuads[i].opaque, benchAtlas, layout, out);
+            ChunkMesher::writeVertices(chunkQuads[i].water, benchAtlas, layout, out);
+        });
+    };
+    auto packedPerSecond = [&](EChunkVertexLayout layout) {
+        return benchmarkVertexBuild<PackedVoxelVertex>(world.chunks.size(), numRounds, [&](size_t i, std::vector<PackedVoxelVertex>& out) {
+            ChunkMesher::writePackedVertices(*world.chunks[i], chunkQuads[i].opaque, benchAtlas, 0, layout, out);
+            ChunkMesher::writePackedVertices(*world.chunks[i], chunkQuads[i].water, benchAtlas, 0, layout, out);
+        });
+    };
+    
+    // quads/s, since the layouts don't write the same number of vertices per quad
+    const double numQuads = numVertices / 6.0;
+    auto printThroughput = [&](const char* label, double verticesPerSecond, size_t vertexSize, size_t numLayoutVertices, double baseline) {
+        const double quadsPerSecond = verticesPerSecond * numQuads / numLayoutVertices;
+        std::cout << "    " << std::left << std::setw(28) << label << std::right << std::setw(10) << quadsPerSecond / 1e6 << " Mquads/s"
+                  << std::setw(10) << verticesPerSecond * vertexSize / (1024.0 * 1024.0) << " MB/s";
+        if(baseline > 0.0) {
+            std::cout << "  (" << quadsPerSecond / baseline << "x)";
+        }
+        std::cout << std::endl;
+        return quadsPerSecond;
+    };
+    std::cout << std::setprecision(1);
+    const double baseline = printThroughput("VertexData", vertexDataPerSecond(EChunkVertexLayout::Triangles), sizeof(VertexData), numVertices, 0.0);
+    printThroughput("VertexData indexed", vertexDataPerSecond(EChunkVertexLayout::IndexedQuads), sizeof(VertexData), numIndexedVertices, baseline);
+    printThroughput("Packed", packedPerSecond(EChunkVertexLayout::Triangles), sizeof(PackedVoxelVertex), numVertices, baseline);
+    printThroughput("Packed indexed", packedPerSecond(EChunkVertexLayout::IndexedQuads), sizeof(PackedVoxelVertex), numIndexedVertices, baseline);
+}
+
+void VoxelBenchmarks::runIncrementalMeshBenchmark() {
+    std::cout << "=== Voxel edits: full re-mesh vs dirty planes only ===" << std::endl;
+    
+    MeshBenchWorld world = createMeshBenchWorld();
+    const Int3D dims = world.chunks[0]->getDimensions();
+    
+    // the planes of every chunk must be the scalar mesher's quads, split by plane
+    int numPlaneMismatches = 0;
+    std::vector<ChunkMeshPlanes> chunkPlanes(world.chunks.size());
+    for(size_t i = 0; i < world.chunks.size(); i++) {
+        ChunkMesher::meshPlanes(*world.chunks[i], world.neighbors[i], chunkPlanes[i]);
+        
+        ChunkMeshQuads scalarQuads;
+        ChunkMesher::meshScalar(*world.chunks[i], world.neighbors[i], scalarQuads);
+        numPlaneMismatches += !samePlanes(chunkPlanes[i], splitIntoPlanes(*world.chunks[i], scalarQuads));
+    }
+    std::cout << "  Planes vs Scalar: " << (numPlaneMismatches == 0? "identical" : "MISMATCH") << " (" << numPlaneMismatches << " of "
+              << world.chunks.size() << " chunks differ)" << std::endl;
+    
+    // random block breaks/places around the terrain surface. Each edit re-meshes the dirty planes of
+    // the chunk (and of its neighbors when it's on a border), like MTLEngine::editVoxel
+    std::mt19937 rng(7);
+    const EVoxelType placedTypes[] = {EVoxelType::None, EVoxelType::Stone, EVoxelType::Dirt, EVoxelType::Water};
+    const int numEdits = 2000;
+    double incrementalMicroseconds = 0.0;
+    int numIncrementalMismatches = 0;
+    
+    for(int e = 0; e < numEdits; e++) {
+        const size_t chunkIndex = rng() % world.chunks.size();
+        Chunk& chunk = *world.chunks[chunkIndex];
+        const Int3D coords((int) (rng() % dims.x), (int) (rng() % dims.y), (int) (rng() % dims.z));
+        chunk.setVoxel(coords, placedTypes[rng() % 4]);
+        
+        Timer t("edit", false);
+        ChunkMeshDirtyPlanes dirtyPlanes;
+        std::array<ChunkMeshDirtyPlanes, 6> neighborDirtyPlanes;
+        ChunkMeshDirtyPlanes::markVoxelEdit(dims, coords, dirtyPlanes, neighborDirtyPlanes);
+        ChunkMesher::remeshDirtyPlanes(chunk, world.neighbors[chunkIndex], dirtyPlanes, chunkPlanes[chunkIndex]);
+        
+        // the chunks that have the edited one as their neighbor k see it on their side k, i.e. they're
+        // its neighbor on the opposite side (k ^ 1 in getAllNeighbors order)
+        for(size_t i = 0; i < world.chunks.size(); i++) {
+            for(int k = 0; k < 6; k++) {
+                if(world.neighbors[i][k] == &chunk && neighborDirtyPlanes[k ^ 1].isDirty()) {
+                    ChunkMesher::remeshDirtyPlanes(*world.chunks[i], world.neighbors[i], neighborDirtyPlanes[k ^ 1], chunkPlanes[i]);
+                }
+            }
+        }
+        incrementalMicroseconds += t.getDurationMicroseconds();
+        
+        if(e % 50 == 0) {
+            for(size_t i = 0; i < world.chunks.size(); i++) {
+                ChunkMeshPlanes fresh;
+                ChunkMesher::meshPlanes(*world.chunks[i], world.neighbors[i], fresh);
+                numIncrementalMismatches += !samePlanes(fresh, chunkPlanes[i]);
+            }
+        }
+    }
+    std::cout << "  Incremental vs full: " << (numIncrementalMismatches == 0? "identical" : "MISMATCH") << " ("
+              << numIncrementalMismatches << " of " << numEdits / 50 * world.chunks.size() << " chunk checks differ)" << std::endl;
+    
+    const int numRounds = 4;
+    Timer t("full", false);
+    ChunkMeshQuads quads;
+    for(int round = 0; round < numRounds; round++) {
+        for(size_t i = 0; i < world.chunks.size(); i++) {
+            quads.clear();
+            ChunkMesher::meshBitmask(*world.chunks[i], world.neighbors[i], quads);
+        }
+    }
+    const double fullMicroseconds = t.getDurationMicroseconds() / (numRounds * world.chunks.size());
+    const double editMicroseconds = incrementalMicroseconds / numEdits;
+    
+    std::cout << std::fixed << std::setprecision(1);
+    std::cout << "    " << std::left << std::setw(28) << "Full re-mesh (Bitmask) us" << std::right << std::setw(10) << fullMicroseconds << std::endl;
+    std::cout << "    " << std::left << std::setw(28) << "Dirty planes us/edit" << std::right << std::setw(10) << editMicroseconds
+              << "  (" << fullMicroseconds / editMicroseconds << "x)" << std::endl;
+}
+
+void VoxelBenchmarks::runFaceDirectionCullingBenchmark() {
+    std::cout << "=== Face direction culling: vertices submitted per camera ===" << std::endl;
+    
+    const MeshBenchWorld world = createMeshBenchWorld();
+    const Int3D dims = world.chunks[0]->getDimensions();
+    const simd::float3 dimsFloat3 = dims.to_float3();
+    
+    // every chunk's buffer, built one direction after the other like MTLEngine::buildChunkVertices.
+    // Each range must hold only its direction's faces, and all the faces of writeVertices
+    std::vector<std::vector<VertexData>> chunkVertices(world.chunks.size());
+    std::vector<ChunkFaceRanges> chunkRanges(world.chunks.size());
+    int numRangeMismatches = 0;
+    for(size_t i = 0; i < world.chunks.size(); i++) {
+        ChunkMeshQuads quads;
+        ChunkMesher::meshBitmask(*world.chunks[i], world.neighbors[i], quads);
+        
+        std::vector<VertexData>& vertices = chunkVertices[i];
+        for(int direction = 0; direction < numChunkFaceDirections; direction++) {
+            chunkRanges[i].offsets[direction] = (int) vertices.size();
+            ChunkMesher::writeVerticesFacing(quads.opaque, direction, benchAtlas, EChunkVertexLayout::IndexedQuads, vertices);
+        }
+        chunkRanges[i].offsets[numChunkFaceDirections] = (int) vertices.size();
+        
+        std::vector<VertexData> unsortedVertices;
+        ChunkMesher::writeVertices(quads.opaque, benchAtlas, EChunkVertexLayout::IndexedQuads, unsortedVertices);
+        bool sameRanges = unsortedVertices.size() == vertices.size();
+        for(int direction = 0; direction < numChunkFaceDirections; direction++) {
+            for(int v = chunkRanges[i].offsets[direction]; v < chunkRanges[i].offsets[direction + 1]; v++) {
+                sameRanges = sameRanges && packedNormalIndex(vertices[v].normal) == direction;
+            }
+        }
+        numRangeMismatches += !sameRanges;
+    }
+    std::cout << "  Direction ranges: " << (numRangeMismatches == 0? "ok" : "MISMATCH") << " (" << numRangeMismatches << " of "
+              << world.chunks.size() << " chunks differ)" << std::endl;
+    
+    // Random cameras over the chunks laid out as an 8x8 area (each chunk is tested as if it was at its
+    // cell of the area, its vertices are moved there by moving the camera the other way). Faces that
+    // are skipped must all face away from the camera, i.e. be back-face culled anyway
+    const int areaWidth = 8;
+    std::mt19937 rng(11);
+    std::uniform_real_distribution<float> areaX(0.0f, areaWidth * dimsFloat3.x);
+    std::uniform_real_distribution<float> areaY(0.0f, 2.0f * dimsFloat3.y);
+    std::uniform_real_distribution<float> areaZ(0.0f, areaWidth * dimsFloat3.z);
+    const int numCameras = 256;
+    
+    size_t numVertices = 0;
+    size_t numSubmittedVertices = 0;
+    size_t numDrawCalls = 0;
+    size_t numFrontFacingSkipped = 0;
+    for(int c = 0; c < numCameras; c++) {
+        const simd::float3 cameraPosition = simd::make_float3(areaX(rng), areaY(rng), areaZ(rng));
+        for(size_t i = 0; i < world.chunks.size(); i++) {
+            const simd::float3 areaOrigin = simd::make_float3(i % areaWidth, 0, i / areaWidth % areaWidth) * dimsFloat3;
+            const simd::float3 chunkPosition = world.chunks[i]->getPositionAsFloat3();
+            const simd::float3 chunkCamera = cameraPosition - areaOrigin + chunkPosition;
+            
+            const ChunkFaceDirectionMask visibleDirections = findVisibleFaceDirections(chunkCamera, chunkPosition, chunkPosition + dimsFloat3);
+            
+            const ChunkFaceRanges& ranges = chunkRanges[i];
+            numVertices += ranges.getTotalNumVertices();
+            for(int direction = 0; direction < numChunkFaceDirections; direction++) {
+                if((visibleDirections >> direction) & 1) {
+                    numSubmittedVertices += ranges.getNumVertices(direction);
+                    continue;
+                }
+                for(int v = ranges.offsets[direction]; v < ranges.offsets[direction + 1]; v += 4) {
+                    const VertexData& vertex = chunkVertices[i][v];
+                    const simd::float3 toCamera = chunkCamera - simd::make_float3(vertex.position.x, vertex.position.y, vertex.position.z);
+                    numFrontFacingSkipped += simd::dot(toCamera, vertex.normal) > 0.0f;
+                }
+            }
+            
+            // runs of visible directions are drawn together, see ChunkRenderer::draw
+            int runStart = -1;
+            for(int direction = 0; direction <= numChunkFaceDirections; direction++) {
+                const bool visible = direction < numChunkFaceDirections && ((visibleDirections >> direction) & 1);
+                if(visible && runStart < 0) {
+                    runStart = ranges.offsets[direction];
+                }
+                else if(!visible && runStart >= 0) {
+                    numDrawCalls += ranges.offsets[direction] > runStart;
+                    runStart = -1;
+                }
+            }
+        }
+    }
+    
+    std::cout << "  Skipped faces facing the camera: " << numFrontFacingSkipped << std::endl;
+    std::cout << std::fixed << std::setprecision(1);
+    std::cout << "    " << std::left << std::setw(28) << "Vertices submitted %" << std::right << std::setw(10)
+              << 100.0 * numSubmittedVertices / numVertices << std::endl;
+    std::cout << "    " << std::left << std::setw(28) << "Draw calls per chunk" << std::right << std::setw(10)
+              << (double) numDrawCalls / (numCameras * world.chunks.size()) << std::endl;
+}
+
+void VoxelBenchmarks::runLODMeshBenchmark() {
+    std::cout << "=== Level of detail meshes: vertices and meshing time per lod ===" << std::endl;
+    
+    const MeshBenchWorld world = createMeshBenchWorld();
+    const int numRounds = 4;
+    
+    // average vertices per chunk (IndexedQuads layout) and microseconds per chunk of every lod
+    std::array<double, ChunkMesher::maxLOD + 1> verticesPerChunk = {};
+    std::array<double, ChunkMesher::maxLOD + 1> microsecondsPerChunk = {};
+    for(int lod = 0; lod <= ChunkMesher::maxLOD; lod++) {
+        ChunkMeshQuads quads;
+        size_t numQuads = 0;
+        
+        Timer t("lod", false);
+        for(int round = 0; round < numRounds; round++) {
+            for(size_t i = 0; i < world.chunks.size(); i++) {
+                quads.clear();
+                if(lod == 0) {
+                    ChunkMesher::meshBitmask(*world.chunks[i], world.neighbors[i], quads);
+                }
+                else {
+                    ChunkMesher::meshLOD(*world.chunks[i], world.neighbors[i], lod, quads);
+                }
+                numQuads += quads.opaque.size() + quads.water.size();
+            }
+        }
+        microsecondsPerChunk[lod] = t.getDurationMicroseconds() / (numRounds * world.chunks.size());
+        verticesPerChunk[lod] = 4.0 * numQuads / (numRounds * world.chunks.size());
+    }
+    
+    std::cout << std::fixed << std::setprecision(1);
+    for(int lod = 0; lod <= ChunkMesher::maxLOD; lod++) {
+        const std::string label = "LOD " + std::to_string(lod) + " (" + std::to_string(1 << lod) + "x)";
+        std::cout << "    " << std::left << std::setw(28) << label << std::right << std::setw(10) << verticesPerChunk[lod] << " vertices/chunk"
+                  << std::setw(10) << microsecondsPerChunk[lod] << " us/chunk" << std::endl;
+    }
+    
+    // vertices drawn for a square render area, all at full detail vs with lod rings starting at
+    // MTLEngine::chunkLODDistances' defaults
+    const std::array<int, ChunkMesher::maxLOD> lodDistances = {4, 7};
+    std::cout << std::setprecision(2);
+    for(int renderDistance : {10, 20, 40}) {
+        double fullVertices = 0.0;
+        double lodVertices = 0.0;
+        for(int x = -renderDistance; x <= renderDistance; x++) {
+            for(int z = -renderDistance; z <= renderDistance; z++) {
+                const int distance = std::max(std::abs(x), std::abs(z));
+                int lod = 0;
+                while(lod < ChunkMesher::maxLOD && distance >= lodDistances[lod]) {
+                    lod++;
+                }
+                fullVertices += verticesPerChunk[0];
+                lodVertices += verticesPerChunk[lod];
+            }
+        }
+        const std::string label = "Render distance " + std::to_string(renderDistance);
+        std::cout << "    " << std::left << std::setw(28) << label << std::right << std::setw(10) << fullVertices / 1e6 << " M full"
+                  << std::setw(10) << lodVertices / 1e6 << " M lod  (" << fullVertices / lodVertices << "x)" << std::endl;
+    }
+}
+
+void VoxelBenchmarks::runBakedAOBenchmark() {
+    std::cout << "=== Baked ambient occlusion: SinglePass vs BakedAO ===" << std::endl;
+    
+    MeshBenchWorld world = createMeshBenchWorld();
+    const Int3D dims = world.chunks[0]->getDimensions();
+    
+    // BakedAO must cover the same faces as SinglePass (only split further where the occlusion changes),
+    // and meshing it plane by plane must give the same quads
+    size_t numSinglePassQuads = 0;
+    size_t numAOQuads = 0;
+    std::array<size_t, 4> numCornersPerLevel = {};
+    int numFaceMismatches = 0;
+    int numPlaneMismatches = 0;
+    std::vector<ChunkMeshPlanes> chunkPlanes(world.chunks.size());
+    for(size_t i = 0; i < world.chunks.size(); i++) {
+        ChunkMeshQuads singlePassQuads;
+        ChunkMeshQuads aoQuads;
+        ChunkMesher::meshSinglePass(*world.chunks[i], world.neighbors[i], singlePassQuads);
+        ChunkMesher::meshBakedAO(*world.chunks[i], world.neighbors[i], aoQuads);
+        
+        numSinglePassQuads += singlePassQuads.opaque.size() + singlePassQuads.water.size();
+        numAOQuads += aoQuads.opaque.size() + aoQuads.water.size();
+        for(const ChunkMeshQuad& q : aoQuads.opaque) {
+            for(const uint8_t level : q.aoLevels) {
+                numCornersPerLevel[level]++;
+            }
+        }
+        numFaceMismatches += faceAreaPerTypeAndAxis(singlePassQuads) != faceAreaPerTypeAndAxis(aoQuads);
+        
+        ChunkMesher::meshPlanes(*world.chunks[i], world.neighbors[i], chunkPlanes[i], true);
+        numPlaneMismatches += !samePlanes(chunkPlanes[i], splitIntoPlanes(*world.chunks[i], aoQuads));
+    }
+    std::cout << "  BakedAO faces: " << (numFaceMismatches == 0? "same" : "MISMATCH") << " (" << numFaceMismatches << " of "
+              << world.chunks.size() << " chunks differ, " << numAOQuads << " quads vs " << numSinglePassQuads << ")" << std::endl;
+    std::cout << "  Planes vs BakedAO: " << (numPlaneMismatches == 0? "identical" : "MISMATCH") << " (" << numPlaneMismatches << " of "
+              << world.chunks.size() << " chunks differ)" << std::endl;
+    
+    // random edits, re-meshing only the dirty planes like MTLEngine::editVoxel: the occlusion of the
+    // faces around the edited voxel (also across chunk borders) must stay up to date
+    std::mt19937 rng(11);
+    const EVoxelType placedTypes[] = {EVoxelType::None, EVoxelType::Stone, EVoxelType::Dirt, EVoxelType::Water};
+    const int numEdits = 1000;
+    double incrementalMicroseconds = 0.0;
+    int numIncrementalMismatches = 0;
+    for(int e = 0; e < numEdits; e++) {
+        const size_t chunkIndex = rng() % world.chunks.size();
+        Chunk& chunk = *world.chunks[chunkIndex];
+        const Int3D coords((int) (rng() % dims.x), (int) (rng() % dims.y), (int) (rng() % dims.z));
+        chunk.setVoxel(coords, placedTypes[rng() % 4]);
+        
+        Timer t("edit", false);
+        ChunkMeshDirtyPlanes dirtyPlanes;
+        std::array<ChunkMeshDirtyPlanes, 6> neighborDirtyPlanes;
+        ChunkMeshDirtyPlanes::markVoxelEdit(dims, coords, dirtyPlanes, neighborDirtyPlanes, true);
+        ChunkMesher::remeshDirtyPlanes(chunk, world.neighbors[chunkIndex], dirtyPlanes, chunkPlanes[chunkIndex], true);
+        for(size_t i = 0; i < world.chunks.size(); i++) {
+            for(int k = 0; k < 6; k++) {
+                if(world.neighbors[i][k] == &chunk && neighborDirtyPlanes[k ^ 1].isDirty()) {
+                    ChunkMesher::remeshDirtyPlanes(*world.chunks[i], world.neighbors[i], neighborDirtyPlanes[k ^ 1], chunkPlanes[i], true);
+                }
+            }
+        }
+        incrementalMicroseconds += t.getDurationMicroseconds();
+        
+        if(e % 50 == 0) {
+            for(size_t i = 0; i < world.chunks.size(); i++) {
+                ChunkMeshPlanes fresh;
+                ChunkMesher::meshPlanes(*world.chunks[i], world.neighbors[i], fresh, true);
+                numIncrementalMismatches += !samePlanes(fresh, chunkPlanes[i]);
+            }
+        }
+    }
+    std::cout << "  Incremental vs full: " << (numIncrementalMismatches == 0? "identical" : "MISMATCH") << " ("
+              << numIncrementalMismatches << " of " << numEdits / 50 * world.chunks.size() << " chunk checks differ)" << std::endl;
+    
+    const size_t numCorners = numCornersPerLevel[0] + numCornersPerLevel[1] + numCornersPerLevel[2] + numCornersPerLevel[3];
+    const int numRounds = 8;
+    const double singlePassChunksPerSecond = benchmarkMesher(EChunkMesher::SinglePass, world, numRounds);
+    const double aoChunksPerSecond = benchmarkMesher(EChunkMesher::BakedAO, world, numRounds);
+    
+    std::cout << std::fixed << std::setprecision(1);
+    std::cout << "    " << std::left << std::setw(28) << "Occluded opaque corners %" << std::right << std::setw(10)
+              << 100.0 * (numCorners - numCornersPerLevel[3]) / numCorners
+              << "  (levels 0/1/2: " << numCornersPerLevel[0] << "/" << numCornersPerLevel[1] << "/" << numCornersPerLevel[2] << ")" << std::endl;
+    std::cout << "    " << std::left << std::setw(28) << "Quads vs SinglePass" << std::right << std::setw(10)
+              << (double) numAOQuads / numSinglePassQuads << "x" << std::endl;
+    std::cout << "    " << std::left << std::setw(28) << "SinglePass chunks/s" << std::right << std::setw(10) << singlePassChunksPerSecond << std::endl;
+    std::cout << "    " << std::left << std::setw(28) << "BakedAO chunks/s" << std::right << std::setw(10) << aoChunksPerSecond
+              << "  (" << aoChunksPerSecond / singlePassChunksPerSecond << "x)" << std::endl;
+    std::cout << "    " << std::left << std::setw(28) << "Dirty planes us/edit" << std::right << std::setw(10)
+              << incrementalMicroseconds / numEdits << std::endl;
+}
+
+void VoxelBenchmarks::runTransparentSortBenchmark() {
+    std::cout << "=== Transparent quads: back-to-front sort per frame, all chunks vs changed regions ===" << std::endl;
+    
+    const MeshBenchWorld world = createMeshBenchWorld();
+    const Int3D dims = world.chunks[0]->getDimensions();
+    const simd::float3 dimsFloat3 = dims.to_float3();
+    
+    // every chunk's water quads, with the chunks laid out as an 8x8 area (like runFaceDirectionCullingBenchmark)
+    const int areaWidth = 8;
+    std::vector<Int3D> chunkIndices;
+    std::vector<simd::float3> aabbMins;
+    std::vector<std::vector<simd::float3>> chunkCentroids;
+    size_t numQuads = 0;
+    for(size_t i = 0; i < world.chunks.size(); i++) {
+        ChunkMeshQuads quads;
+        ChunkMesher::meshBitmask(*world.chunks[i], world.neighbors[i], quads);
+        std::vector<VertexData> vertices;
+        ChunkMesher::writeVertices(quads.water, benchAtlas, EChunkVertexLayout::IndexedQuads, vertices);
+        
+        const Int3D cell((int) i % areaWidth, 0, (int) i / areaWidth);
+        const simd::float3 aabbMin = (cell * dims).to_float3();
+        std::vector<simd::float3> centroids;
+        TransparentQuadSorter::findQuadCentroids(vertices, 4, centroids);
+        for(simd::float3& c : centroids) {
+            c = c - world.chunks[i]->getPositionAsFloat3() + aabbMin;
+        }
+        numQuads += centroids.size();
+        chunkIndices.push_back(cell);
+        aabbMins.push_back(aabbMin);
+        chunkCentroids.push_back(std::move(centroids));
+    }
+    
+    // a walk over the area at about 4 voxels/s at 60 fps
+    const int numFrames = 3000;
+    std::mt19937 rng(5);
+    std::uniform_real_distribution<float> turn(-0.2f, 0.2f);
+    std::vector<simd::float3> cameraPath;
+    simd::float3 camera = {dimsFloat3.x * areaWidth / 2, dimsFloat3.y * 0.6f, dimsFloat3.z * areaWidth / 2};
+    float heading = 0.0f;
+    for(int f = 0; f < numFrames; f++) {
+        heading += turn(rng);
+        camera += simd::make_float3(std::cos(heading), 0.0f, std::sin(heading)) * 0.07f;
+        camera.x = std::clamp(camera.x, 0.0f, dimsFloat3.x * areaWidth);
+        camera.z = std::clamp(camera.z, 0.0f, dimsFloat3.z * areaWidth);
+        cameraPath.push_back(camera);
+    }
+    
+    // the sorted orders must be back to front, up to the 16-bit quantization of the distances
+    TransparentQuadSorter sorter;
+    int numOrderErrors = 0;
+    std::vector<uint32_t> order;
+    for(size_t i = 0; i < chunkCentroids.size(); i++) {
+        const std::vector<simd::float3>& centroids = chunkCentroids[i];
+        const simd::float3 eye = cameraPath[i * numFrames / chunkCentroids.size()];
+        sorter.sortBackToFront(centroids, eye, order);
+        
+        float minDistance = INFINITY;
+        float maxDistance = 0.0f;
+        for(const simd::float3& c : centroids) {
+            minDistance = std::min(minDistance, simd::distance(c, eye));
+            maxDistance = std::max(maxDistance, simd::distance(c, eye));
+        }
+        const float tolerance = (maxDistance - minDistance) / 65535.0f * 1.01f;
+        std::vector<bool> seen(centroids.size(), false);
+        for(size_t k = 0; k < order.size(); k++) {
+            seen[order[k]] = true;
+            if(k > 0 && simd::distance(centroids[order[k]], eye) > simd::distance(centroids[order[k - 1]], eye) + tolerance) {
+                numOrderErrors++;
+            }
+        }
+        numOrderErrors += order.size() != centroids.size() || std::find(seen.begin(), seen.end(), false) != seen.end();
+    }
+    std::cout << "  Back-to-front order: " << (numOrderErrors == 0? "ok" : "MISMATCH") << " (" << numOrderErrors << " errors, "
+              << numQuads << " water quads in " << chunkCentroids.size() << " chunks)" << std::endl;
+    
+    // every chunk re-sorted every frame vs only the chunks whose camera region changed, both writing
+    // the index lists the renderer uploads
+    std::vector<uint32_t> indices;
+    size_t checksum = 0;
+    Timer tFull("full", false);
+    for(const simd::float3& eye : cameraPath) {
+        for(size_t i = 0; i < chunkCentroids.size(); i++) {
+            sorter.sortBackToFront(chunkCentroids[i], eye, order);
+            indices.clear();
+            ChunkMesher::writeSortedQuadIndices(order, EChunkVertexLayout::IndexedQuads, indices);
+            checksum += indices.size();
+        }
+    }
+    const double fullMicroseconds = tFull.getDurationMicroseconds() / numFrames;
+    
+    for(size_t i = 0; i < chunkCentroids.size(); i++) {
+        sorter.setChunkQuads(chunkIndices[i], aabbMins[i], aabbMins[i] + dimsFloat3, chunkCentroids[i]);
+    }
+    Timer tIncremental("incremental", false);
+    for(const simd::float3& eye : cameraPath) {
+        for(size_t i = 0; i < chunkCentroids.size(); i++) {
+            if(sorter.sortChunk(chunkIndices[i], eye)) {
+                indices.clear();
+                ChunkMesher::writeSortedQuadIndices(*sorter.getSortedQuads(chunkIndices[i]), EChunkVertexLayout::IndexedQuads, indices);
+                checksum += indices.size();
+            }
+        }
+    }
+    const double incrementalMicroseconds = tIncremental.getDurationMicroseconds() / numFrames;
+    assert(checksum > 0);
+    
+    std::cout << std::fixed << std::setprecision(2);
+    std::cout << "    " << std::left << std::setw(28) << "All chunks us/frame" << std::right << std::setw(10) << fullMicroseconds << std::endl;
+    std::cout << "    " << std::left << std::setw(28) << "Changed regions us/frame" << std::right << std::setw(10) << incrementalMicroseconds
+              << "  (" << fullMicroseconds / incrementalMicroseconds << "x)" << std::endl;
+    std::cout << "    " << std::left << std::setw(28) << "Chunks re-sorted per frame" << std::right << std::setw(10)
+              << (double) sorter.getNumSorts() / numFrames << "  of " << chunkCentroids.size() << std::endl;
+}
+
+void VoxelBenchmarks::runMeshScratchBenchmark() {
+    std::cout << "=== Meshing allocations: fresh buffers per chunk vs the thread's scratch buffers ===" << std::endl;
+    
+    const MeshBenchWorld world = createMeshBenchWorld();
+    
+    // what MTLEngine::meshChunk and meshChunkLODs do with a chunk, in the thread's scratch buffers
+    // (the collision rects are the chunk's, they're allocated for every mesh either way)
+    auto meshLikeEngine = [&world](size_t i) {
+        ChunkMeshScratch& scratch = ChunkMesher::getThreadScratch();
+        const Chunk& chunk = *world.chunks[i];
+        for(int lod = 0; lod <= ChunkMesher::maxLOD; lod++) {
+            scratch.quads.clear();
+            if(lod == 0) {
+                ChunkMesher::mesh(EChunkMesher::BakedAO, chunk, world.neighbors[i], scratch.quads);
+                
+                std::vector<std::unique_ptr<CollisionRect>> collisionRects;
+                for(const ChunkMeshQuad& q : scratch.quads.opaque) {
+                    std::array<simd::float3, 4> quadPosLS;
+                    for(int c = 0; c < (int) q.positions.size(); c++) {
+                        quadPosLS[c] = q.positions[c].xyz - chunk.getPositionAsFloat3();
+                    }
+                    collisionRects.push_back(chunk.makeCollisionRect(quadPosLS, q.normal));
+                }
+            }
+            else {
+                ChunkMesher::meshLOD(chunk, world.neighbors[i], lod, scratch.quads);
+            }
+            scratch.chunkVertices.clear();
+            scratch.transparentVertices.clear();
+            for(int direction = 0; direction < numChunkFaceDirections; direction++) {
+                ChunkMesher::writeVerticesFacing(scratch.quads.opaque, direction, benchAtlas, EChunkVertexLayout::IndexedQuads, scratch.chunkVertices);
+                ChunkMesher::writeVerticesFacing(scratch.quads.water, direction, benchAtlas, EChunkVertexLayout::IndexedQuads, scratch.transparentVertices);
+            }
+            if(lod == 0) {
+                TransparentQuadSorter::findQuadCentroids(scratch.transparentVertices, 4, scratch.transparentCentroids);
+            }
+        }
+        return scratch.chunkVertices.size();
+    };
+    
+    // the scratch buffers' storage, a buffer that (re)allocated has a new one
+    auto bufferStorage = []() {
+        std::vector<std::pair<const void*, size_t>> storage;
+        ChunkMesher::getThreadScratch().forEachBuffer([&storage](const auto& buffer) {
+            storage.push_back({buffer.data(), buffer.capacity()});
+        });
+        return storage;
+    };
+    
+    struct RunAllocations {
+        // the scratch buffers that (re)allocated per chunk (a buffer growing several times within a chunk counts once)
+        double bufferRegrowths = 0.0;
+        // every heap allocation made while meshing, per chunk (only counted with BENCHMARK_COUNT_ALLOCATIONS)
+        double heapAllocations = 0.0;
+    };
+    
+    // returns chunks/s. The storage is compared outside the timed meshing
+    auto run = [&](bool freshBuffers, int numRounds, RunAllocations& outAllocations) {
+        size_t checksum = 0;
+        size_t numBufferRegrowths = 0;
+        size_t numHeapAllocations = 0;
+        double microseconds = 0.0;
+        for(int round = 0; round < numRounds; round++) {
+            for(size_t i = 0; i < world.chunks.size(); i++) {
+                const std::vector<std::pair<const void*, size_t>> before = freshBuffers?
+                    std::vector<std::pair<const void*, size_t>>() : bufferStorage();
+                
+                Timer t("meshing", false);
+#ifdef BENCHMARK_COUNT_ALLOCATIONS
+                const size_t numAllocationsBefore = numAllocations;
+                countAllocations = true;
+#endif
+                if(freshBuffers) {
+                    // like every chunk having its own temporaries
+                    ChunkMesher::getThreadScratch() = ChunkMeshScratch();
+                }
+                checksum += meshLikeEngine(i);
+#ifdef BENCHMARK_COUNT_ALLOCATIONS
+                countAllocations = false;
+                numHeapAllocations += numAllocations - numAllocationsBefore;
+#endif
+                microseconds += t.getDurationMicroseconds();
+                
+                const std::vector<std::pair<const void*, size_t>> after = bufferStorage();
+                for(size_t b = 0; b < after.size(); b++) {
+                    const bool allocated = freshBuffers? after[b].second > 0 : after[b] != before[b];
+                    numBufferRegrowths += allocated;
+                }
+            }
+        }
+        assert(checksum > 0);
+        const double numChunks = (double) numRounds * world.chunks.size();
+        outAllocations.bufferRegrowths = numBufferRegrowths / numChunks;
+        outAllocations.heapAllocations = numHeapAllocations / numChunks;
+        return numChunks / (microseconds / 1000000.0);
+    };
+    
+    const int numRounds = 4;
+    RunAllocations freshAllocations;
+    RunAllocations firstPassAllocations;
+    RunAllocations warmAllocations;
+    const double freshChunksPerSecond = run(true, numRounds, freshAllocations);
+    // the first pass grows the scratch buffers to the high-water mark
+    ChunkMesher::getThreadScratch() = ChunkMeshScratch();
+    run(false, 1, firstPassAllocations);
+    const double warmChunksPerSecond = run(false, numRounds, warmAllocations);
+    
+    auto printAllocations = [](const char* label, const RunAllocations& allocations) {
+        std::cout << "    " << std::left << std::setw(28) << label << std::right << std::setw(10) << allocations.bufferRegrowths
+                  << " scratch buffer regrowths/chunk";
+#ifdef BENCHMARK_COUNT_ALLOCATIONS
+        std::cout << std::setw(10) << allocations.heapAllocations << " heap allocations/chunk";
+#endif
+    };
+    
+    std::cout << std::fixed << std::setprecision(1);
+    printAllocations("Fresh buffers", freshAllocations);
+    std::cout << std::setw(10) << freshChunksPerSecond << " chunks/s" << std::endl;
+    printAllocations("Scratch, first pass", firstPassAllocations);
+    std::cout << std::endl;
+    printAllocations("Scratch, warm", warmAllocations);
+    std::cout << std::setw(10) << warmChunksPerSecond << " chunks/s  (" << warmChunksPerSecond / freshChunksPerSecond << "x)" << std::endl;
+#ifndef BENCHMARK_COUNT_ALLOCATIONS
+    std::cout << "    (configure with -DBENCHMARK_COUNT_ALLOCATIONS=ON to count every heap allocation)" << std::endl;
+#endif
+}
+
+void VoxelBenchmarks::runNoiseBenchmark() {
+    std::cout << "=== Perlin noise: scalar noise() vs batched fillNoise(), per-column generators vs WorldNoise ===" << std::endl;
+    
+    // PerlinNoiseGenerator or WorldNoise
+    auto benchmark = [](const char* label, auto& perlin, const std::vector<simd::float3>& points) {
+        const int numPoints = (int) points.size();
+        std::vector<float> x(numPoints), y(numPoints), z(numPoints);
+        for(int i = 0; i < numPoints; i++) {
+            x[i] = points[i].x;
+            y[i] = points[i].y;
+            z[i] = points[i].z;
+        }
+        
+        const int numRounds = 8;
+        std::vector<float> scalarNoise(numPoints), batchedNoise(numPoints);
+        Timer scalarTimer("scalar", false);
+        for(int round = 0; round < numRounds; round++) {
+            for(int i = 0; i < numPoints; i++) {
+                scalarNoise[i] = perlin.noise(points[i]);
+            }
+        }
+        const double scalarMicroseconds = scalarTimer.getDurationMicroseconds();
+        
+        Timer batchedTimer("batched", false);
+        for(int round = 0; round < numRounds; round++) {
+            perlin.fillNoise(x.data(), y.data(), z.data(), numPoints, batchedNoise.data());
+        }
+        const double batchedMicroseconds = batchedTimer.getDurationMicroseconds();
+        
+        int numMismatches = 0;
+        for(int i = 0; i < numPoints; i++) {
+            numMismatches += scalarNoise[i] != batchedNoise[i];
+        }
+        
+        std::cout << "  " << label << std::endl;
+        std::cout << std::fixed << std::setprecision(1);
+        std::cout << "    " << std::left << std::setw(28) << "Scalar" << std::right << std::setw(10)
+                  << numRounds * numPoints / scalarMicroseconds << " Mpoints/s" << std::endl;
+        std::cout << "    " << std::left << std::setw(28) << "Batched" << std::right << std::setw(10)
+                  << numRounds * numPoints / batchedMicroseconds << " Mpoints/s  ("
+                  << scalarMicroseconds / batchedMicroseconds << "x)" << std::endl;
+        std::cout << "    differing results: " << numMismatches << " of " << numPoints << std::endl;
+        assert(numMismatches == 0);
+    };
+    
+    // a column generator with synced faces, like MTLEngine used to create for every chunk column
+    auto createColumnGenerator = [](simd::int3 resolution) {
+        PerlinNoiseGenerator neighbor(resolution);
+        PerlinNoiseGenerator perlin(resolution);
+        perlin.syncFace(neighbor, 0, 1);
+        perlin.syncFace(neighbor, 1, 0);
+        perlin.syncFace(neighbor, 4, 5);
+        perlin.syncFace(neighbor, 5, 4);
+        return perlin;
+    };
+    
+    // every sample point of a chunk's columns, like MTLEngine::generateChunk at the first level, relative
+    // to the chunk at chunkIndex
+    const Int3D dims = benchChunkDims;
+    const simd::float3 dimsFloat3 = simd::make_float3(dims.x, dims.y, dims.z);
+    auto chunkColumnPoints = [&](Int3D chunkIndex, std::vector<simd::float3>& outPoints) {
+        for(int x = 0; x < dims.x; x++) {
+            for(int z = 0; z < dims.z; z++) {
+                for(int y = 0; y <= dims.y; y++) {
+                    const float sampleY = std::clamp((float) y, 0.f, (float) dims.y - 1);
+                    outPoints.push_back(simd::make_float3(chunkIndex.x * dims.x + x, sampleY, chunkIndex.z * dims.z + z) / dimsFloat3);
+                }
+            }
+        }
+    };
+    
+    std::vector<simd::float3> columnPoints;
+    chunkColumnPoints(Int3D(0, 0, 0), columnPoints);
+    PerlinNoiseGenerator columnGenerator = createColumnGenerator(simd::make_int3(1, 1, 1));
+    benchmark("PerlinNoiseGenerator, chunk columns (resolution 1)", columnGenerator, columnPoints);
+    
+    // points all over a finer lattice (faces, corners and hashed gradients), mirrored by the sign
+    const simd::int3 fineResolution = simd::make_int3(8, 4, 8);
+    std::mt19937 rng(7);
+    std::uniform_real_distribution<float> coordinate(-0.999f, 0.999f);
+    std::vector<simd::float3> randomPoints;
+    for(int i = 0; i < 1 << 18; i++) {
+        randomPoints.push_back(simd::make_float3(coordinate(rng) * fineResolution.x, coordinate(rng) * fineResolution.y,
+                                                 coordinate(rng) * fineResolution.z));
+    }
+    PerlinNoiseGenerator fineGenerator = createColumnGenerator(fineResolution);
+    benchmark("PerlinNoiseGenerator, random points (8x4x8)", fineGenerator, randomPoints);
+    
+    // the columns of a whole load area, in world space
+    const int areaRadius = 4;
+    std::vector<simd::float3> areaPoints;
+    for(int cx = -areaRadius; cx <= areaRadius; cx++) {
+        for(int cz = -areaRadius; cz <= areaRadius; cz++) {
+            chunkColumnPoints(Int3D(cx, 0, cz), areaPoints);
+        }
+    }
+    const WorldNoise worldNoise(1);
+    benchmark("WorldNoise, chunk columns of a 9x9 chunk area", worldNoise, areaPoints);
+    
+    // what every new chunk column cost before it could be generated (serially, on the one bfs thread)
+    const int numGenerators = 4096;
+    Timer generatorTimer("generators", false);
+    int checksum = 0;
+    for(int i = 0; i < numGenerators; i++) {
+        checksum += createColumnGenerator(simd::make_int3(1, 1, 1)).getResolution().x;
+    }
+    const double generatorMicroseconds = generatorTimer.getDurationMicroseconds();
+    assert(checksum == numGenerators);
+    std::cout << std::fixed << std::setprecision(2);
+    std::cout << "  per-column PerlinNoiseGenerator + 4 syncFace: " << generatorMicroseconds / numGenerators
+              << " us/column (WorldNoise: none)" << std::endl;
+    
+    // the same seed gives the same world, and chunks agree along their borders by construction
+    const WorldNoise sameSeed(1);
+    const WorldNoise otherSeed(2);
+    int numSameSeedMismatches = 0;
+    int numOtherSeedMatches = 0;
+    for(const simd::float3& p : areaPoints) {
+        numSameSeedMismatches += worldNoise.noise(p) != sameSeed.noise(p);
+        numOtherSeedMatches += worldNoise.noise(p) == otherSeed.noise(p);
+    }
+    std::cout << "  same seed, differing results: " << numSameSeedMismatches << " of " << areaPoints.size()
+              << ", other seed, equal results: " << numOtherSeedMatches << std::endl;
+    assert(numSameSeedMismatches == 0);
+}
+
+void VoxelBenchmarks::runTerrainGenerationBenchmark() {
+    std::cout << "=== Terrain generation: Volumetric vs Heightmap ===" << std::endl;
+    
+    const WorldNoise noise(1);
+    const Int3D dims = benchChunkDims;
+    // the levels of MTLEngine (worldMinChunkY to worldMaxChunkY) and its overhang band
+    const int minLevel = 0;
+    const int maxLevel = 3;
+    const int overhangBand = 2;
+    const int areaSize = 8;
+    
+    std::vector<Int3D> columns;
+    for(int cx = 0; cx < areaSize; cx++) {
+        for(int cz = 0; cz < areaSize; cz++) {
+            columns.push_back(Int3D(cx, 0, cz));
+        }
+    }
+    const int numChunks = (int) columns.size() * (maxLevel - minLevel + 1);
+    
+    // generates every level of every column like MTLEngine::generateChunk, returns the chunks in
+    // columns order, level by level
+    auto generate = [&](ETerrainGenerator generator, size_t& outNoiseSamples, double& outMicroseconds) {
+        std::vector<ChunkHandle> chunks;
+        outNoiseSamples = 0;
+        Timer t("generate", false);
+        for(const Int3D& column : columns) {
+            TerrainHeightmap heightmap;
+            if(generator == ETerrainGenerator::Heightmap) {
+                heightmap = TerrainGenerator::createHeightmap(noise, column.x, column.z, dims);
+                outNoiseSamples += heightmap.numNoiseSamples;
+            }
+            for(int level = minLevel; level <= maxLevel; level++) {
+                const Int3D chunkIndex(column.x, level, column.z);
+                ChunkHandle chunk = std::make_shared<Chunk>(nullptr, EVoxelStorageMode::Palette);
+                chunk->setDimensions(dims);
+                chunk->setPosition(chunkIndex * dims);
+                if(generator == ETerrainGenerator::Heightmap) {
+                    outNoiseSamples += TerrainGenerator::fillFromHeightmap(*chunk, noise, heightmap, chunkIndex, overhangBand);
+                }
+                else {
+                    outNoiseSamples += TerrainGenerator::fillVolumetric(*chunk, noise, chunkIndex);
+                }
+                chunk->compactVoxelStorage();
+                chunks.push_back(std::move(chunk));
+            }
+        }
+        outMicroseconds = t.getDurationMicroseconds();
+        return chunks;
+    };
+    
+    size_t volumetricSamples = 0;
+    size_t heightmapSamples = 0;
+    double volumetricMicroseconds = 0.0;
+    double heightmapMicroseconds = 0.0;
+    const std::vector<ChunkHandle> volumetric = generate(ETerrainGenerator::Volumetric, volumetricSamples, volumetricMicroseconds);
+    const std::vector<ChunkHandle> heightmap = generate(ETerrainGenerator::Heightmap, heightmapSamples, heightmapMicroseconds);
+    
+    std::cout << std::fixed << std::setprecision(1);
+    std::cout << "    " << std::left << std::setw(28) << "Volumetric" << std::right << std::setw(10)
+              << (double) volumetricSamples / numChunks << " noise samples/chunk"
+              << std::setw(10) << numChunks / (volumetricMicroseconds / 1000000.0) << " chunks/s" << std::endl;
+    std::cout << "    " << std::left << std::setw(28) << "Heightmap (band 2)" << std::right << std::setw(10)
+              << (double) heightmapSamples / numChunks << " noise samples/chunk"
+              << std::setw(10) << numChunks / (heightmapMicroseconds / 1000000.0) << " chunks/s  ("
+              << (double) volumetricSamples / heightmapSamples << "x fewer samples, "
+              << volumetricMicroseconds / heightmapMicroseconds << "x faster)" << std::endl;
+    
+    // how alike the two terrains are (they sample the noise differently, so they aren't identical)
+    size_t numVoxels = 0;
+    size_t numSameSolidity = 0;
+    for(size_t i = 0; i < volumetric.size(); i++) {
+        for(int x = 0; x < dims.x; x++) {
+            for(int y = 0; y < dims.y; y++) {
+                for(int z = 0; z < dims.z; z++) {
+                    const EVoxelType a = volumetric[i]->getVoxel(Int3D(x, y, z));
+                    const EVoxelType b = heightmap[i]->getVoxel(Int3D(x, y, z));
+                    const bool aIsSolid = a != EVoxelType::None && a != EVoxelType::Water;
+                    const bool bIsSolid = b != EVoxelType::None && b != EVoxelType::Water;
+                    numSameSolidity += aIsSolid == bIsSolid;
+                    numVoxels++;
+                }
+            }
+        }
+    }
+    std::cout << "    voxels solid in both or air in both: " << 100.0 * numSameSolidity / numVoxels << "%" << std::endl;
+    
+    // the heightmaps of neighboring columns are built independently, the surface still doesn't step more
+    // along the chunk borders than inside the chunks
+    float maxInnerStep = 0.0f;
+    float maxBorderStep = 0.0f;
+    for(int cx = 0; cx + 1 < areaSize; cx++) {
+        const TerrainHeightmap a = TerrainGenerator::createHeightmap(noise, cx, 0, dims);
+        const TerrainHeightmap b = TerrainGenerator::createHeightmap(noise, cx + 1, 0, dims);
+        for(int z = 0; z < dims.z; z++) {
+            for(int x = 0; x + 1 < dims.x; x++) {
+                maxInnerStep = std::max(maxInnerStep, std::abs(a.getSurfaceHeight(x + 1, z) - a.getSurfaceHeight(x, z)));
+            }
+            maxBorderStep = std::max(maxBorderStep, std::abs(b.getSurfaceHeight(0, z) - a.getSurfaceHeight(dims.x - 1, z)));
+        }
+    }
+    std::cout << std::setprecision(2);
+    std::cout << "    largest surface step inside chunks: " << maxInnerStep << ", across chunk borders: " << maxBorderStep << std::endl;
+}
+
+void VoxelBenchmarks::runTerrainLatticeBenchmark() {
+    std::cout << "=== Terrain generation: CoarseLattice vs Volumetric ===" << std::endl;
+    
+    const WorldNoise noise(1);
+    const Int3D dims = benchChunkDims;
+    // the terrain levels (the ones above are air either way)
+    std::vector<Int3D> chunkIndices;
+    for(int cx = 0; cx < 8; cx++) {
+        for(int cz = 0; cz < 8; cz++) {
+            for(int level = 0; level < 2; level++) {
+                chunkIndices.push_back(Int3D(cx, level, cz));
+            }
+        }
+    }
+    
+    // generates every chunk, returns chunks/s
+    auto generate = [&](auto fill, std::vector<ChunkHandle>& outChunks, size_t& outNoiseSamples) {
+        outChunks.clear();
+        outNoiseSamples = 0;
+        Timer t("generate", false);
+        for(const Int3D& chunkIndex : chunkIndices) {
+            ChunkHandle chunk = std::make_shared<Chunk>(nullptr, EVoxelStorageMode::Palette);
+            chunk->setDimensions(dims);
+            chunk->setPosition(chunkIndex * dims);
+            outNoiseSamples += fill(*chunk, chunkIndex);
+            chunk->compactVoxelStorage();
+            outChunks.push_back(std::move(chunk));
+        }
+        return chunkIndices.size() / (t.getDurationMicroseconds() / 1000000.0);
+    };
+    
+    std::vector<ChunkHandle> volumetric;
+    size_t volumetricSamples = 0;
+    const double volumetricChunksPerSecond = generate([&](Chunk& chunk, const Int3D& chunkIndex) {
+        return TerrainGenerator::fillVolumetric(chunk, noise, chunkIndex);
+    }, volumetric, volumetricSamples);
+    
+    std::cout << std::fixed << std::setprecision(1);
+    std::cout << "    " << std::left << std::setw(28) << "Volumetric" << std::right << std::setw(10)
+              << (double) volumetricSamples / chunkIndices.size() << " noise samples/chunk"
+              << std::setw(10) << volumetricChunksPerSecond << " chunks/s" << std::endl;
+    
+    for(const int spacing : {2, 4, 8}) {
+        std::vector<ChunkHandle> lattice;
+        size_t latticeSamples = 0;
+        const double latticeChunksPerSecond = generate([&](Chunk& chunk, const Int3D& chunkIndex) {
+            return TerrainGenerator::fillFromLattice(chunk, noise, chunkIndex, spacing);
+        }, lattice, latticeSamples);
+        
+        // the error mode, on the same chunks
+        TerrainLatticeError error;
+        for(const Int3D& chunkIndex : chunkIndices) {
+            Chunk chunk(nullptr, EVoxelStorageMode::Palette);
+            chunk.setDimensions(dims);
+            TerrainGenerator::fillFromLattice(chunk, noise, chunkIndex, spacing, &error);
+        }
+        
+        // the voxels on either side of each x border come from the same lattice points there, so their
+        // noise only differs by a voxel's worth of interpolation (a seam would show up as a larger step)
+        size_t numBorderVoxels = 0;
+        size_t numBorderSolidityChanges = 0;
+        size_t numInnerSolidityChanges = 0;
+        size_t numInnerPairs = 0;
+        auto isSolid = [](EVoxelType type) { return type != EVoxelType::None && type != EVoxelType::Water; };
+        for(size_t c = 0; c < chunkIndices.size(); c++) {
+            for(int y = 0; y < dims.y; y++) {
+                for(int z = 0; z < dims.z; z++) {
+                    for(int x = 0; x + 1 < dims.x; x++) {
+                        numInnerSolidityChanges += isSolid(lattice[c]->getVoxel(Int3D(x, y, z))) != isSolid(lattice[c]->getVoxel(Int3D(x + 1, y, z)));
+                        numInnerPairs++;
+                    }
+                    // the chunk at +x is 2 entries on (levels are interleaved)
+                    const size_t right = c + 2 * 8;
+                    if(right < chunkIndices.size()) {
+                        numBorderSolidityChanges += isSolid(lattice[c]->getVoxel(Int3D(dims.x - 1, y, z))) != isSolid(lattice[right]->getVoxel(Int3D(0, y, z)));
+                        numBorderVoxels++;
+                    }
+                }
+            }
+        }
+        
+        const std::string label = "CoarseLattice, " + std::to_string(spacing) + "-voxel cells";
+        std::cout << std::setprecision(1);
+        std::cout << "    " << std::left << std::setw(28) << label << std::right << std::setw(10)
+                  << (double) latticeSamples / chunkIndices.size() << " noise samples/chunk"
+                  << std::setw(10) << latticeChunksPerSecond << " chunks/s  ("
+                  << (double) volumetricSamples / latticeSamples << "x fewer samples, "
+                  << latticeChunksPerSecond / volumetricChunksPerSecond << "x faster)" << std::endl;
+        std::cout << std::setprecision(4);
+        std::cout << "      noise error mean " << error.sumNoiseError / error.numVoxels << ", max " << error.maxNoiseError
+                  << ", voxels differing " << 100.0 * error.numDifferingVoxels / error.numVoxels << "%" << std::endl;
+        std::cout << "      solid/air changes between neighbors: " << 100.0 * numInnerSolidityChanges / numInnerPairs
+                  << "% inside chunks, " << 100.0 * numBorderSolidityChanges / numBorderVoxels << "% across borders" << std::endl;
+    }
+}
+
+void VoxelBenchmarks::runNoiseGraphBenchmark() {
+    std::cout << "=== Terrain generation: NoiseGraph vs Volumetric ===" << std::endl;
+    
+    // Assets/Terrain/terrain.noisegraph, i.e. Volumetric's terrain
+    const std::string defaultGraph = R"(
+        terrain     = perlin frequency=0.0625,0.03125,0.0625
+        heightBias  = height slope=0.028125
+        density     = add terrain heightBias
+        solid       = mul density -1
+        stoneNoise  = perlin frequency=0.03125,0.015625,0.03125
+        stoneDepth  = mul stoneNoise -25
+        stoneTop    = height slope=-1 offset=10
+        stone       = add stoneDepth stoneTop
+        output solid = solid
+        output stone = stone
+    )";
+    // warped fBm hills with cellular caves and a value noise stone layer
+    const std::string cavesGraph = R"(
+        hills       = fbm source=perlin frequency=0.015625,0.03125,0.015625 octaves=4 seed=1
+        warpX       = perlin frequency=0.03125 seed=2
+        warpZ       = perlin frequency=0.03125 seed=3
+        warpedHills = warp hills warpX 0 warpZ amplitude=8
+        hillsBias   = height slope=-0.03 offset=0.2
+        hillsSolid  = add warpedHills hillsBias
+        caves       = cellular frequency=0.0625,0.125,0.0625 seed=4
+        solid       = select -1 hillsSolid caves threshold=0.3
+        clampedSolid = clamp solid -1 1
+        stoneNoise  = value frequency=0.03125 seed=5
+        stoneDepth  = mul stoneNoise -8
+        stoneTop    = height slope=-1 offset=12
+        stone       = add stoneDepth stoneTop
+        output solid = clampedSolid
+        output stone = stone
+    )";
+    
+    const WorldNoise noise(1);
+    const Int3D dims = benchChunkDims;
+    // the terrain levels and the 2 above them, which both skip as air
+    std::vector<Int3D> chunkIndices;
+    for(int cx = 0; cx < 8; cx++) {
+        for(int cz = 0; cz < 8; cz++) {
+            for(int level = 0; level < 4; level++) {
+                chunkIndices.push_back(Int3D(cx, level, cz));
+            }
+        }
+    }
+    
+    // generates every chunk, returns chunks/s
+    auto generate = [&](auto fill, std::vector<ChunkHandle>& outChunks, size_t& outNoiseSamples) {
+        outChunks.clear();
+        outNoiseSamples = 0;
+        Timer t("generate", false);
+        for(const Int3D& chunkIndex : chunkIndices) {
+            ChunkHandle chunk = std::make_shared<Chunk>(nullptr, EVoxelStorageMode::Palette);
+            chunk->setDimensions(dims);
+            chunk->setPosition(chunkIndex * dims);
+            outNoiseSamples += fill(*chunk, chunkIndex);
+            chunk->compactVoxelStorage();
+            outChunks.push_back(std::move(chunk));
+        }
+        return chunkIndices.size() / (t.getDurationMicroseconds() / 1000000.0);
+    };
+    
+    std::vector<ChunkHandle> volumetric;
+    size_t volumetricSamples = 0;
+    const double volumetricChunksPerSecond = generate([&](Chunk& chunk, const Int3D& chunkIndex) {
+        return TerrainGenerator::fillVolumetric(chunk, noise, chunkIndex);
+    }, volumetric, volumetricSamples);
+    
+    std::cout << std::fixed << std::setprecision(1);
+    std::cout << "    " << std::left << std::setw(28) << "Volumetric" << std::right << std::setw(10)
+              << (double) volumetricSamples / chunkIndices.size() << " noise samples/chunk"
+              << std::setw(10) << volumetricChunksPerSecond << " chunks/s" << std::endl;
+    
+    const std::array<std::pair<const char*, const std::string*>, 2> graphs = {{
+        {"NoiseGraph, default", &defaultGraph},
+        {"NoiseGraph, warped caves", &cavesGraph}
+    }};
+    for(const auto& [name, text] : graphs) {
+        std::string error;
+        std::optional<NoiseGraph> graph = NoiseGraph::parse(*text, error);
+        std::optional<NoiseGraphPlan> plan;
+        if(graph.has_value()) {
+            plan = NoiseGraphPlan::compile(*graph, TerrainGenerator::getGraphOutputNames(), noise.getSeed(), error);
+        }
+        if(!plan.has_value()) {
+            std::cout << "    ERROR: " << name << ": " << error << std::endl;
+            return;
+        }
+        
+        std::vector<ChunkHandle> chunks;
+        size_t graphSamples = 0;
+        const double graphChunksPerSecond = generate([&](Chunk& chunk, const Int3D& chunkIndex) {
+            return TerrainGenerator::fillFromGraph(chunk, *plan, chunkIndex);
+        }, chunks, graphSamples);
+        
+        size_t numVoxels = 0;
+        size_t numAgreeing = 0;
+        size_t numSolid = 0;
+        for(size_t c = 0; c < chunkIndices.size(); c++) {
+            for(int x = 0; x < dims.x; x++) {
+                for(int y = 0; y < dims.y; y++) {
+                    for(int z = 0; z < dims.z; z++) {
+                        const EVoxelType type = chunks[c]->getVoxel(Int3D(x, y, z));
+                        numAgreeing += type == volumetric[c]->getVoxel(Int3D(x, y, z));
+                        numSolid += type != EVoxelType::None && type != EVoxelType::Water;
+                        numVoxels++;
+                    }
+                }
+            }
+        }
+        
+        std::cout << std::setprecision(1);
+        std::cout << "    " << std::left << std::setw(28) << name << std::right << std::setw(10)
+                  << (double) graphSamples / chunkIndices.size() << " noise samples/chunk"
+                  << std::setw(10) << graphChunksPerSecond << " chunks/s  ("
+                  << graphChunksPerSecond / volumetricChunksPerSecond << "x Volumetric)" << std::endl;
+        std::cout << "      " << graph->getNodes().size() << " nodes -> " << plan->getNumInstructions() << " instructions over "
+                  << plan->getNumRegisters() << " registers, " << plan->getNumNoiseSamplesPerPoint() << " noise samples/voxel" << std::endl;
+        std::cout << std::setprecision(2);
+        std::cout << "      voxels solid " << 100.0 * numSolid / numVoxels << "%, same as Volumetric "
+                  << 100.0 * numAgreeing / numVoxels << "%" << std::endl;
+    }
+}
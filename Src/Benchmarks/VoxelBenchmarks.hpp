@@ -0,0 +1,75 @@
+#pragma once
+
+// Offline benchmarks for the voxel/chunk data structures.
+// Run with: ./JustAnotherMinecraftClone --benchmark
+//
+// These don't need a window or a Metal device, so they're run before the engine is initialized
+// and print their reports to stdout.
+class VoxelBenchmarks {
+public:
+    static void runAll();
+    
+    // memory report + get/set throughput of EVoxelStorageMode::Flat vs EVoxelStorageMode::Palette
+    static void runVoxelStorageBenchmark();
+    
+    // greedy-mesher style sweeps along each axis for LinearVoxelLayout vs MortonVoxelLayout
+    static void runVoxelLayoutBenchmark();
+    
+    // Int3D hash quality + std::map vs std::unordered_map vs OpenAddressingMap over load-area key sets
+    static void runHashContainerBenchmark();
+    
+    // chunks/s and block allocations when chunks are generated and unloaded in a loop, cold vs warm BlockPools
+    static void runChunkPoolBenchmark();
+    
+    // chunks/s of the Scalar vs Bitmask vs SinglePass greedy mesher, and checks that Bitmask's output is
+    // identical to Scalar's and that SinglePass covers the same faces
+    static void runMesherBenchmark();
+    
+    // bytes per chunk and build + copy throughput of VertexData vs PackedVoxelVertex vertices, in the
+    // Triangles and IndexedQuads layouts. Checks that the packed vertices decode back to the same
+    // VertexData, and that the indexed buffers draw the same vertices as the Triangles ones
+    static void runVertexFormatBenchmark();
+    
+    // microseconds per single-voxel edit when only the dirty planes are re-meshed, vs a full re-mesh,
+    // and checks that the planes stay identical to meshing from scratch
+    static void runIncrementalMeshBenchmark();
+    
+    // share of the vertices submitted when the face directions that point away from the camera are
+    // skipped per chunk, over random cameras, and checks that no skipped face could be front-facing
+    static void runFaceDirectionCullingBenchmark();
+    
+    // vertices and meshing time per chunk of each level of detail, and the vertices of a render area
+    // at full detail vs with lod rings
+    static void runLODMeshBenchmark();
+    
+    // chunks/s and quads of BakedAO vs SinglePass and the share of occluded corners. Checks that BakedAO
+    // covers the same faces, and that its planes stay identical to meshing from scratch through edits
+    static void runBakedAOBenchmark();
+    
+    // microseconds per frame to keep every chunk's water quads back to front along a camera walk, sorting
+    // every chunk every frame vs only the chunks whose camera region changed. Checks the sorted orders
+    static void runTransparentSortBenchmark();
+    
+    // scratch buffer regrowths (and heap allocations, with BENCHMARK_COUNT_ALLOCATIONS) per chunk and chunks/s
+    // when meshing like MTLEngine::meshChunk (all lods), with fresh buffers for every chunk vs the thread's
+    // reused ChunkMeshScratch
+    static void runMeshScratchBenchmark();
+    
+    // Mpoints/s of the scalar noise vs the batched fillNoise of PerlinNoiseGenerator and WorldNoise, over
+    // the chunk columns MTLEngine::generateChunk samples, and what setting up a per-column generator used
+    // to cost. Checks that the batched noise is identical to the scalar one
+    static void runNoiseBenchmark();
+    
+    // noise samples per chunk and chunks/s of ETerrainGenerator::Volumetric vs Heightmap over an area of
+    // chunk columns, how much of their terrain agrees, and the surface steps along chunk borders
+    static void runTerrainGenerationBenchmark();
+    
+    // noise samples per chunk and chunks/s of ETerrainGenerator::CoarseLattice at a few lattice spacings vs
+    // Volumetric, the noise error and the share of voxels that differ, and that chunks agree along their borders
+    static void runTerrainLatticeBenchmark();
+    
+    // instructions, noise samples per chunk and chunks/s of ETerrainGenerator::NoiseGraph, for the default
+    // graph (Volumetric's terrain) and a heavier one, vs Volumetric, and how much of the default graph's
+    // terrain agrees with Volumetric's
+    static void runNoiseGraphBenchmark();
+};
@@ -1,49 +1,147 @@
 #include "ChunkRenderer.hpp"
+#include "Voxel/ChunkMesher.hpp"
+#include <vector>
+#include <cstring>
 
 std::map<Int3D, ChunkRenderData> ChunkRenderer::cachedChunkBuffers = std::map<Int3D, ChunkRenderData>();
 
 std::map<Int3D, ChunkRenderData> ChunkRenderer::cachedTransparentChunkBuffers = std::map<Int3D, ChunkRenderData>();
 
+std::map<Int3D, ChunkLODRenderData> ChunkRenderer::cachedChunkLODBuffers = std::map<Int3D, ChunkLODRenderData>();
 
-void ChunkRenderer::render(const Chunk& chunk, MTL::RenderCommandEncoder* renderCommandEncoder, MTL::Device* metalDevice, int index) {
-    if(!vertexBuffer || dirty) {
-        Int3D chunkIndex = chunk.getIndex();
-        
-        if(cachedChunkBuffers.contains(chunkIndex)) {
-            ChunkRenderData rd = cachedChunkBuffers[chunkIndex];
-            vertexBuffer = rd.buffer;
-            numVertices = rd.numVertices;
-            dirty = false;
+std::map<Int3D, ChunkSortedIndices> ChunkRenderer::sortedTransparentIndices = std::map<Int3D, ChunkSortedIndices>();
+
+MTL::Buffer* ChunkRenderer::quadIndexBuffer = nullptr;
+
+size_t ChunkRenderer::quadIndexBufferNumQuads = 0;
+
+void ChunkRenderer::createQuadIndexBuffer(MTL::Device* metalDevice, size_t numQuads) {
+    releaseQuadIndexBuffer();
+    
+    std::vector<uint32_t> indices;
+    ChunkMesher::writeQuadIndices(numQuads, indices);
+    quadIndexBuffer = metalDevice->newBuffer(indices.data(), sizeof(uint32_t) * indices.size(), MTL::ResourceStorageModeShared);
+    quadIndexBufferNumQuads = numQuads;
+}
+
+void ChunkRenderer::releaseQuadIndexBuffer() {
+    if(quadIndexBuffer) {
+        quadIndexBuffer->release();
+        quadIndexBuffer = nullptr;
+    }
+    quadIndexBufferNumQuads = 0;
+}
+
+void ChunkRenderer::writeSortedTransparentIndices(MTL::Device* metalDevice, const Int3D& chunkIndex, const std::vector<uint32_t>& indices) {
+    ChunkSortedIndices& sorted = sortedTransparentIndices[chunkIndex];
+    const size_t numBytes = sizeof(uint32_t) * indices.size();
+    if(sorted.buffer && sorted.buffer->length() < numBytes) {
+        sorted.buffer->release();
+        sorted.buffer = nullptr;
+    }
+    if(!sorted.buffer && numBytes > 0) {
+        sorted.buffer = metalDevice->newBuffer(numBytes, MTL::ResourceStorageModeShared);
+    }
+    if(numBytes > 0) {
+        // (the previous frame's command buffer has completed by now)
+        std::memcpy(sorted.buffer->contents(), indices.data(), numBytes);
+    }
+    sorted.numIndices = (int) indices.size();
+}
+
+void ChunkRenderer::releaseSortedTransparentIndices(const Int3D& chunkIndex) {
+    auto it = sortedTransparentIndices.find(chunkIndex);
+    if(it != sortedTransparentIndices.end()) {
+        if(it->second.buffer) {
+            it->second.buffer->release();
         }
+        sortedTransparentIndices.erase(it);
     }
-    
-    renderCommandEncoder->setVertexBuffer(vertexBuffer, 0, 0);
-    
-    
-    MTL::PrimitiveType typeTriangle = MTL::PrimitiveTypeTriangle;
-    NS::UInteger vertexStart = 0;
-    NS::UInteger vertexCount = numVertices;
-    renderCommandEncoder->drawPrimitives(typeTriangle, vertexStart, vertexCount);
 }
 
-void ChunkRenderer::renderTransparent(const Chunk& chunk, MTL::RenderCommandEncoder* renderCommandEncoder) {
-    if(transparentDirty || !transparentRenderData.buffer) {
-        Int3D chunkIndex = chunk.getIndex();
+void ChunkRenderer::draw(MTL::RenderCommandEncoder* renderCommandEncoder, const ChunkFaceRanges& faceRanges, bool isIndexed,
+                         ChunkFaceDirectionMask visibleDirections) {
+    int direction = 0;
+    while(direction < numChunkFaceDirections) {
+        if(!((visibleDirections >> direction) & 1)) {
+            direction++;
+            continue;
+        }
         
-        if(cachedTransparentChunkBuffers.contains(chunkIndex)) {
-            transparentRenderData = cachedTransparentChunkBuffers[chunkIndex];
-            transparentDirty = false;
+        const int start = faceRanges.offsets[direction];
+        while(direction < numChunkFaceDirections && ((visibleDirections >> direction) & 1)) {
+            direction++;
+        }
+        const int end = faceRanges.offsets[direction];
+        
+        if(end > start) {
+            drawRange(renderCommandEncoder, start, end - start, isIndexed);
         }
     }
+}
+
+void ChunkRenderer::drawRange(MTL::RenderCommandEncoder* renderCommandEncoder, int vertexStart, int vertexCount, bool isIndexed) {
+    MTL::PrimitiveType typeTriangle = MTL::PrimitiveTypeTriangle;
+    if(isIndexed) {
+        // quad q's indices are at q * 6 in the shared index buffer, and point at its vertices q * 4
+        const size_t numIndicesPerQuad = ChunkMesher::quadIndexPattern.size();
+        const NS::UInteger indexStart = vertexStart / 4 * numIndicesPerQuad;
+        const NS::UInteger indexCount = vertexCount / 4 * numIndicesPerQuad;
+        renderCommandEncoder->drawIndexedPrimitives(typeTriangle, indexCount, MTL::IndexTypeUInt32, quadIndexBuffer, indexStart * sizeof(uint32_t));
+        return;
+    }
+    
+    renderCommandEncoder->drawPrimitives(typeTriangle, NS::UInteger(vertexStart), NS::UInteger(vertexCount));
+}
+
+
+void ChunkRenderer::render(const Chunk& chunk, MTL::RenderCommandEncoder* renderCommandEncoder, MTL::Device* metalDevice, int index,
+                           ChunkFaceDirectionMask visibleDirections) {
+    auto it = cachedChunkBuffers.find(chunk.getIndex());
+    if(it == cachedChunkBuffers.end() || !it->second.buffer) {
+        return;
+    }
+    const ChunkRenderData& rd = it->second;
+    
+    renderCommandEncoder->setVertexBuffer(rd.buffer, 0, 0);
     
-    if(transparentDirty || !transparentRenderData.buffer || transparentRenderData.numVertices == 0) {
+    draw(renderCommandEncoder, rd.faceRanges, rd.numIndices > 0, visibleDirections);
+}
+
+void ChunkRenderer::renderTransparent(const Chunk& chunk, MTL::RenderCommandEncoder* renderCommandEncoder,
+                                      ChunkFaceDirectionMask visibleDirections, const ChunkSortedIndices* sortedIndices) {
+    auto it = cachedTransparentChunkBuffers.find(chunk.getIndex());
+    if(it == cachedTransparentChunkBuffers.end() || !it->second.buffer || it->second.numVertices == 0) {
         return;
     }
+    const ChunkRenderData& transparentRenderData = it->second;
     
     renderCommandEncoder->setVertexBuffer(transparentRenderData.buffer, 0, 0);
 
-    MTL::PrimitiveType typeTriangle = MTL::PrimitiveTypeTriangle;
-    NS::UInteger vertexStart = 0;
-    NS::UInteger vertexCount = transparentRenderData.numVertices;
-    renderCommandEncoder->drawPrimitives(typeTriangle, vertexStart, vertexCount);
+    // (sorted indices of an older mesh, not re-sorted yet, are ignored)
+    const int numVerticesPerQuad = transparentRenderData.numIndices > 0? 4 : 6;
+    const int numQuads = transparentRenderData.numVertices / numVerticesPerQuad;
+    if(sortedIndices && sortedIndices->buffer && sortedIndices->numIndices == numQuads * (int) ChunkMesher::quadIndexPattern.size()) {
+        renderCommandEncoder->drawIndexedPrimitives(MTL::PrimitiveTypeTriangle, NS::UInteger(sortedIndices->numIndices),
+                                                    MTL::IndexTypeUInt32, sortedIndices->buffer, 0);
+        return;
+    }
+
+    draw(renderCommandEncoder, transparentRenderData.faceRanges, transparentRenderData.numIndices > 0, visibleDirections);
+}
+
+bool ChunkRenderer::renderLOD(const Int3D& chunkIndex, MTL::RenderCommandEncoder* renderCommandEncoder, int lod, bool transparent,
+                              ChunkFaceDirectionMask visibleDirections) {
+    assert(lod >= 1 && lod <= ChunkMesher::maxLOD);
+    auto it = cachedChunkLODBuffers.find(chunkIndex);
+    if(it == cachedChunkLODBuffers.end() || it->second.lod != lod) {
+        return false;
+    }
+    
+    const ChunkRenderData& rd = transparent? it->second.transparent : it->second.opaque;
+    if(rd.buffer && rd.numVertices > 0) {
+        renderCommandEncoder->setVertexBuffer(rd.buffer, 0, 0);
+        draw(renderCommandEncoder, rd.faceRanges, rd.numIndices > 0, visibleDirections);
+    }
+    return true;
 }
@@ -2,32 +2,78 @@
 #include <map>
 #include "Metal/Metal.hpp"
 #import "Voxel/VoxelTypes.hpp"
+#import "Voxel/ChunkFaceDirections.hpp"
+#import "Voxel/ChunkMesher.hpp"
 
 struct ChunkRenderData {
     MTL::Buffer* buffer;
     int numVertices;
+    // EChunkVertexLayout::IndexedQuads buffers are drawn with this many indices of the shared
+    // quadIndexBuffer, 0 for Triangles buffers (drawn as numVertices vertices)
+    int numIndices = 0;
+    // the vertices of each face direction, so directions facing away from the camera can be skipped
+    ChunkFaceRanges faceRanges;
+};
+
+// a chunk's mesh at the lower level of detail it's drawn at (see ChunkMesher::meshLOD)
+struct ChunkLODRenderData {
+    int lod = 0;
+    ChunkRenderData opaque = {};
+    ChunkRenderData transparent = {};
+    
+    void releaseBuffers() {
+        for(ChunkRenderData* rd : {&opaque, &transparent}) {
+            if(rd->buffer) {
+                rd->buffer->release();
+            }
+        }
+    }
+};
+
+// indices that draw a chunk's transparent quads back to front (see TransparentQuadSorter)
+struct ChunkSortedIndices {
+    MTL::Buffer* buffer = nullptr;
+    int numIndices = 0;
 };
 
 class ChunkRenderer {
     
 public:
+    // The meshed chunks' buffers, guarded by MTLEngine::cachedChunkRDMutex (held while rendering). A chunk's
+    // buffers are released as soon as it's re-meshed or unloaded, so the renderers look them up on every
+    // draw rather than keep the pointers
     static std::map<Int3D, ChunkRenderData> cachedChunkBuffers;
     static std::map<Int3D, ChunkRenderData> cachedTransparentChunkBuffers;
+    static std::map<Int3D, ChunkLODRenderData> cachedChunkLODBuffers;
+    static std::map<Int3D, ChunkSortedIndices> sortedTransparentIndices;
     
-    ChunkRenderer(): vertexBuffer(nullptr), dirty(true), numVertices(-1) {}
+    // copies indices to the chunk's sorted index buffer, which is only reallocated when it grows
+    static void writeSortedTransparentIndices(MTL::Device* metalDevice, const Int3D& chunkIndex, const std::vector<uint32_t>& indices);
+    static void releaseSortedTransparentIndices(const Int3D& chunkIndex);
     
-    void render(const Chunk& chunk, MTL::RenderCommandEncoder* renderCommandEncoder, MTL::Device* metalDevice, int index);
-    void renderTransparent(const Chunk& chunk, MTL::RenderCommandEncoder* renderCommandEncoder);
-    void markDirty() {
-        dirty = true;
-        transparentDirty = true;
-    }
-    bool isDirty() const { return dirty; }
+    // ChunkMesher::quadIndexPattern repeated for quadIndexBufferNumQuads quads (uint32 indices)
+    static MTL::Buffer* quadIndexBuffer;
+    static size_t quadIndexBufferNumQuads;
+    static void createQuadIndexBuffer(MTL::Device* metalDevice, size_t numQuads);
+    static void releaseQuadIndexBuffer();
+    
+    // only the faces of visibleDirections are drawn (see findVisibleFaceDirections)
+    void render(const Chunk& chunk, MTL::RenderCommandEncoder* renderCommandEncoder, MTL::Device* metalDevice, int index,
+                ChunkFaceDirectionMask visibleDirections = allChunkFaceDirections);
+    // With sortedIndices (that cover all of the chunk's current transparent quads), every quad is drawn
+    // in their order and visibleDirections is ignored, as the sorted order mixes the directions
+    void renderTransparent(const Chunk& chunk, MTL::RenderCommandEncoder* renderCommandEncoder,
+                           ChunkFaceDirectionMask visibleDirections = allChunkFaceDirections,
+                           const ChunkSortedIndices* sortedIndices = nullptr);
+    // Draws the chunk's mesh at lod (> 0), opaque or transparent. Returns false if the chunk doesn't have
+    // a mesh of that lod (yet, or anymore), then nothing is drawn
+    static bool renderLOD(const Int3D& chunkIndex, MTL::RenderCommandEncoder* renderCommandEncoder, int lod, bool transparent,
+                          ChunkFaceDirectionMask visibleDirections = allChunkFaceDirections);
     
 private:
-    MTL::Buffer* vertexBuffer;
-    ChunkRenderData transparentRenderData;
-    bool dirty;
-    bool transparentDirty;
-    int numVertices;
+    // draws the faces of visibleDirections, consecutive directions in a single draw call
+    static void draw(MTL::RenderCommandEncoder* renderCommandEncoder, const ChunkFaceRanges& faceRanges, bool isIndexed,
+                     ChunkFaceDirectionMask visibleDirections);
+    // draws vertices [vertexStart, vertexStart + vertexCount)
+    static void drawRange(MTL::RenderCommandEncoder* renderCommandEncoder, int vertexStart, int vertexCount, bool isIndexed);
 };
@@ -27,13 +27,21 @@
 #include <vector>
 #include <thread>
 #include <mutex>
+#include <shared_mutex>
 #include <chrono>
 #include <optional>
 
 #import "AAPLMathUtilities.h"
-#import "WorldGeneration/PerlinNoiseGenerator.hpp"
+#import "WorldGeneration/WorldNoise.hpp"
+#import "WorldGeneration/TerrainGenerator.hpp"
+#import "WorldGeneration/NoiseGraph.hpp"
 #import "Core/Camera.hpp"
 #import "Voxel/VoxelTypes.hpp"
+#import "Voxel/ChunkTable.hpp"
+#import "Voxel/ChunkMesher.hpp"
+#import "Voxel/ToroidalGrid.hpp"
+#import "Voxel/ChunkEviction.hpp"
+#import "Voxel/TransparentQuadSorter.hpp"
 
 #include <assimp/scene.h>
 #include "Core/Mesh/AssimpNodeManager.hpp"
@@ -77,7 +85,48 @@ class MTLEngine : public IEngine {
 public:
     static const int loadDistance;
     static const int renderDistance;
+    // chunks are stacked in columns, from level worldMinChunkY up to worldMaxChunkY (inclusive)
+    static const int worldMinChunkY;
+    static const int worldMaxChunkY;
+    // load/render distances in chunk levels above and below curChunk
+    static const int verticalLoadDistance;
+    static const int verticalRenderDistance;
     static const Int3D chunkDims;
+    static const EVoxelStorageMode voxelStorageMode;
+    // Scalar and Bitmask produce the same quads, Bitmask is the fastest with the current few voxel types.
+    // SinglePass's cost doesn't grow with the number of types (see VoxelBenchmarks::runMesherBenchmark).
+    // BakedAO also bakes the corners' ambient occlusion into the vertices (see VoxelBenchmarks::runBakedAOBenchmark)
+    static const EChunkMesher chunkMesher;
+    // IndexedQuads writes 4 vertices per quad instead of 6 (see VoxelBenchmarks::runVertexFormatBenchmark)
+    static const EChunkVertexLayout chunkVertexLayout;
+    // chunks at least chunkLODDistances[lod - 1] chunks from curChunk (in the XZ plane) are drawn with
+    // their ChunkMesher::meshLOD mesh of that lod
+    static const std::array<int, ChunkMesher::maxLOD> chunkLODDistances;
+    // chunks further than this from curChunk are unloaded
+    static const int unloadDistance;
+    static const int verticalUnloadDistance;
+    // loaded chunks (voxels, collision and mesh buffers) outside the load area are unloaded LRU-first past
+    // this many bytes
+    static const size_t chunkMemoryBudget;
+    // number of engine ticks between eviction passes (a pass also runs whenever curChunk changes)
+    static const int chunkEvictionInterval;
+    // seed of the terrain's WorldNoise, 0 picks a new world every run
+    static const uint32_t worldSeed;
+    // Volumetric by default. Heightmap takes over 10x fewer noise samples per chunk, but isn't the same world
+    // (~98% of the voxels agree, see VoxelBenchmarks::runTerrainGenerationBenchmark)
+    static const ETerrainGenerator terrainGenerator;
+    // with ETerrainGenerator::Heightmap, 3D noise moves the surface by up to this many voxels (0 for a plain heightfield)
+    static const int terrainOverhangBand;
+    // with ETerrainGenerator::CoarseLattice, voxels between the noise's lattice points (must divide chunkDims)
+    static const int terrainLatticeSpacing;
+    // with ETerrainGenerator::CoarseLattice, also samples the noise at every voxel and shows how far the lattice is
+    // from it in the debug window
+    static const bool measureTerrainLatticeError;
+    // with ETerrainGenerator::NoiseGraph, the graph the terrain is evaluated from (outputs "solid" and "stone", see
+    // TerrainGenerator::fillFromGraph). If it can't be loaded the terrain falls back to Volumetric
+    static const char* const terrainGraphPath;
+    // how far (in voxels) from the camera the dig key (EKey::Down) reaches
+    static const float digReach;
     
 public:
     MTLEngine()
@@ -96,6 +145,11 @@ public:
     virtual void setLineColor(int index, simd::float3 color);
     virtual void setLineVisibility(int index, bool isVisible);
     
+    // Sets a voxel of a loaded chunk (main thread only, waits for the meshers to finish their current
+    // chunks). If the chunk is already meshed, only the planes the edit touches are re-meshed, in the
+    // chunk and in the neighbors whose border it's on. Returns false if the chunk isn't loaded.
+    bool editVoxel(const Int3D& chunkIndex, const Int3D& coords, EVoxelType type);
+    
 protected:
     virtual void commitLines();
 
@@ -114,12 +168,52 @@ private:
     void initChunkGeneration();
     void initiatePerlinGeneration();
     void resolveChunkGeneration();
-    void createPerlinGenerators();
+    void queueChunksToGenerate();
     void tryGenerateChunk();
     void generateChunk(Int3D chunkIndex);
     void tryMeshChunk();
+    // whether the chunk's level was queued for generation in its column, i.e. it's loaded or will be
+    bool isChunkQueuedForGeneration(const Int3D& chunkIndex);
     void meshChunk(Int3D chunkIndex);
+    // the loaded chunks around chunkIndex in ChunkMeshNeighbors order, outHandles keeps them alive
+    ChunkMeshNeighbors findMeshNeighbors(const Int3D& chunkIndex, std::array<ChunkHandle, 6>& outHandles);
+    // the collision rects of the quads, to be added to the chunk under chunkCollisionMutex
+    void addCollisionRects(const Chunk& chunk, const std::vector<ChunkMeshQuad>& quads,
+                           std::vector<std::unique_ptr<CollisionRect>>& outRects);
+    // the vertices of the chunk's quads, plus its lamps, grouped by face direction
+    void buildChunkVertices(const Chunk& chunk, const ChunkMeshQuads& quads,
+                            std::vector<VertexData>& outChunkVertices, std::vector<VertexData>& outTransparentVertices,
+                            ChunkFaceRanges& outChunkRanges, ChunkFaceRanges& outTransparentRanges);
+    // a buffer for the vertices (nullptr if there are none)
+    ChunkRenderData createChunkRenderData(const std::vector<VertexData>& vertices, const ChunkFaceRanges& faceRanges);
+    // editGeneration is the chunk's edit generation from before its voxels were read: a mesh of voxels that were
+    // edited since is dropped (along with collisionRects, the chunk's new rects if not null)
+    void storeChunkRenderData(const Int3D& chunkIndex, Chunk& chunk,
+                              const std::vector<VertexData>& chunkVertices, const std::vector<VertexData>& transparentVertices,
+                              const ChunkFaceRanges& chunkRanges, const ChunkFaceRanges& transparentRanges,
+                              uint32_t editGeneration, std::vector<std::unique_ptr<CollisionRect>>* collisionRects,
+                              size_t meshPlanesBytes = 0);
+    // builds and uploads the chunk's mesh at lod, replacing its previous lower level of detail mesh (nothing
+    // for lod 0). Dropped like storeChunkRenderData's if the chunk was edited since editGeneration
+    void meshChunkLOD(const Int3D& chunkIndex, const Chunk& chunk, const ChunkMeshNeighbors& neighbors, int lod,
+                      uint32_t editGeneration);
+    // builds the lod requestChunkLOD asked for (on a mesh worker)
+    void meshRequestedChunkLOD(const Int3D& chunkIndex);
+    // queues the chunk's mesh at lod (> 0) to be built, unless it's queued already (cachedChunkRDMutex held)
+    void requestChunkLOD(const Int3D& chunkIndex, int lod);
+    // releases the chunk's lower level of detail mesh, and drops its request (cachedChunkRDMutex held)
+    void releaseChunkLOD(const Int3D& chunkIndex);
+    // the number of edits made to the chunk's voxels, or to its neighbors' next to it (cachedChunkRDMutex held)
+    uint32_t getChunkEditGeneration(const Int3D& chunkIndex) const;
+    // the level of detail the chunk is drawn at, see chunkLODDistances
+    int getChunkLOD(const Int3D& chunkIndex) const;
+    // re-meshes the dirty planes of an already meshed chunk, and updates its collision rects and buffers
+    void remeshEditedChunk(const Int3D& chunkIndex, const ChunkMeshDirtyPlanes& dirtyPlanes);
+    // clears the first solid voxel within digReach along the camera's forward vector
+    void digVoxelInView();
     void initChunkRenderers();
+    void evictChunks();
+    void unloadChunk(const Int3D& chunkIndex);
     
     // init
     void initCascadingShadowMaps();
@@ -161,7 +255,9 @@ private:
     void renderChunk(const Chunk& chunk);
     void sendRenderCommand();
     void draw();
-    void drawChunkGeometry(MTL::RenderCommandEncoder* renderCommandEncoder);
+    // cullFaceDirections skips each chunk's faces that point away from the main camera (only valid for
+    // passes drawn from it)
+    void drawChunkGeometry(MTL::RenderCommandEncoder* renderCommandEncoder, bool cullFaceDirections = false);
     
     struct CameraMovementKeyMap {
         EKey forward;
@@ -189,6 +285,8 @@ private:
     
     void updateUniforms();
     Int3D calculateCurrentChunk(const float3 pos) const;
+    // whether chunk level y is between worldMinChunkY and worldMaxChunkY
+    static bool isChunkLevelInWorld(int y);
     void updateVisibleChunkIndices();
     
     // glfw callbacks
@@ -205,7 +303,9 @@ private:
     //
     bool isKeyDown(const EKey k) const { return keydownArr[k]; }
 
-    void addPointLight(float3 posWS, float3 color);
+    // returns the light's id, or -1 if there's no room left
+    int addPointLight(float3 posWS, float3 color);
+    void removePointLight(int id);
 
 private:
     MTL::Device* metalDevice;
@@ -299,6 +399,8 @@ private:
     std::vector<LightVolumeData> pointLights;
     std::mutex pointLightArrMutex;
     int curPointLightIndex;
+    // slots below curPointLightIndex that were freed by removePointLight
+    std::vector<int> freePointLightIndices;
     
     //
     // bloom - gaussian blur pipeline
@@ -363,6 +465,7 @@ private:
     float2 prevMousePos;
     bool captureMouse = true;
     bool spaceWasDown;
+    bool digWasDown;
     
     //
     // camera
@@ -413,22 +516,66 @@ private:
     // 
     std::vector<std::thread> chunkGenThreads;
     std::vector<std::thread> meshGenThreads;
-    // thread to check which chunks, say set C, need perlin generators
+    // thread to check which chunks, say set C, need to be generated
     //  - will then add all chunks in C to the terrain generation queue
-    std::thread perlinGenThread;
-    std::map<Int3D, PerlinNoiseGenerator> generators;
+    std::thread chunkQueueThread;
+    // the terrain's noise, a function of the world position only (see worldSeed)
+    WorldNoise terrainNoise;
+    // see measureTerrainLatticeError
+    TerrainLatticeError terrainLatticeError;
+    std::mutex terrainLatticeErrorMutex;
+    // with ETerrainGenerator::NoiseGraph, compiled from terrainGraphPath in init
+    std::optional<NoiseGraphPlan> terrainGraph;
+    struct ChunkColumn {
+        // with ETerrainGenerator::Heightmap, built by the first of its levels to be generated. Only the levels
+        // of this column read it: neighboring columns and ChunkMesher::meshLOD still go through the voxels
+        std::shared_ptr<const TerrainHeightmap> heightmap;
+        // bit (y - worldMinChunkY) is set once level y was queued for generation, and cleared when it's unloaded
+        uint64_t queuedLevels = 0;
+    };
+    // one column per XZ chunk index within loadDistance + 1 of curChunk (the bfs reaches one ring past the
+    // load area)
+    ToroidalGrid<ChunkColumn> chunkColumns;
+    std::mutex chunkColumnsMutex;
     moodycamel::ConcurrentQueue<Int3D> chunksToGenerate;
     moodycamel::ConcurrentQueue<Int3D> chunksToMesh;
+    // chunks whose mesh at the level of detail they're now drawn at isn't built yet (see requestChunkLOD)
+    moodycamel::ConcurrentQueue<Int3D> chunksToMeshLOD;
     moodycamel::ProducerToken chunksToMeshPTok;
     std::mutex chunksToMeshPTokMutex;
-    std::mutex loadedChunksMutex;
     std::mutex cachedChunkRDMutex;
+    // bytes used by each loaded chunk (voxels, collision, mesh buffers), guarded by cachedChunkRDMutex
+    OpenAddressingMap<Int3D, size_t> chunkMemoryUsage;
+    // the lod each chunk of chunksToMeshLOD is to be built at, guarded by cachedChunkRDMutex
+    OpenAddressingMap<Int3D, int> requestedChunkLODs;
+    // the loaded chunks meshChunk has started meshing at least once, guarded by cachedChunkRDMutex
+    OpenAddressingMap<Int3D, bool> meshedChunks;
+    // the chunks a mesh worker is meshing right now, guarded by cachedChunkRDMutex (a chunk queued again
+    // meanwhile is put back in the queue rather than meshed by two workers at once)
+    OpenAddressingMap<Int3D, bool> chunksBeingMeshed;
+    // held while a chunk's collision rects are replaced or edited, and by physicsTick while it uses them
+    std::mutex chunkCollisionMutex;
+    // bumped by editVoxel for each chunk whose mesh an edit changes, guarded by cachedChunkRDMutex. Meshes of the
+    // voxels from before an edit are dropped when they're stored, rather than edits waiting for the meshers
+    OpenAddressingMap<Int3D, uint32_t> chunkEditGenerations;
+    // the centroids of each meshed chunk's transparent quads, kept back to front for the camera, guarded by cachedChunkRDMutex
+    TransparentQuadSorter transparentQuadSorter;
+    std::vector<uint32_t> sortedTransparentIndices;
+    uint64_t frameIndex;
     bool chunkGenPending;
 
-    // all loaded chunks
-    std::map<Int3D, Chunk> loadedChunks;
-    std::map<Int3D, std::shared_ptr<ChunkRenderer>> chunkRenderers;
+    // all loaded chunks, safe to access from any thread
+    ChunkTable loadedChunks;
+    // the quads of the chunks edited since they were last fully meshed, split by plane (see editVoxel).
+    // Inserted and erased under cachedChunkRDMutex; the planes themselves are only touched by editVoxel, which
+    // keeps them alive while a full mesh started meanwhile erases them
+    std::map<Int3D, std::shared_ptr<ChunkMeshPlanes>> editedChunkMeshes;
+    // one renderer per chunk within renderDistance of curChunk, per column indexed by (y - worldMinChunkY)
+    ToroidalGrid<std::vector<std::shared_ptr<ChunkRenderer>>> chunkRenderers;
     std::vector<Int3D> sortedVisibleChunks;
+    // offsets from curChunk of every chunk within renderDistance (and verticalRenderDistance),
+    // sorted furthest -> nearest
+    std::vector<Int3D> sortedVisibleChunkOffsets;
     
     bool visibleChunksDirty;
     MTL::Buffer* visibleChunkBuffer;
@@ -22,12 +22,15 @@
 #include <set>
 #include <algorithm>
 #include <random>
+#include <cmath>
 
 #include "assimp/Importer.hpp"
 #include <assimp/scene.h>
 #include <assimp/postprocess.h>
 
-#include "WorldGeneration/PerlinNoiseGenerator.hpp"
+#include "WorldGeneration/WorldNoise.hpp"
+#include "WorldGeneration/TerrainGenerator.hpp"
+#include "WorldGeneration/NoiseGraph.hpp"
 #include "Math/CommonMath.hpp"
 #include "Utilities/Profiling.hpp"
 #include "Gameplay/Player.hpp"
@@ -36,11 +39,34 @@
 
 const int MTLEngine::loadDistance = 16;
 const int MTLEngine::renderDistance = 10;
+const int MTLEngine::worldMinChunkY = 0;
+const int MTLEngine::worldMaxChunkY = 3;
+// one more level than is rendered, so the top/bottom visible levels have both Y neighbors to mesh against
+const int MTLEngine::verticalLoadDistance = 2;
+const int MTLEngine::verticalRenderDistance = 1;
 const Int3D MTLEngine::chunkDims = {16,32,16};
+const EVoxelStorageMode MTLEngine::voxelStorageMode = EVoxelStorageMode::Palette;
+const EChunkMesher MTLEngine::chunkMesher = EChunkMesher::BakedAO;
+const EChunkVertexLayout MTLEngine::chunkVertexLayout = EChunkVertexLayout::IndexedQuads;
+const std::array<int, ChunkMesher::maxLOD> MTLEngine::chunkLODDistances = {4, 7};
+// one ring past the load area, so chunks at its edge aren't unloaded and regenerated as the player moves back and forth
+const int MTLEngine::unloadDistance = MTLEngine::loadDistance + 1;
+const int MTLEngine::verticalUnloadDistance = MTLEngine::verticalLoadDistance + 1;
+const size_t MTLEngine::chunkMemoryBudget = size_t(512) * 1024 * 1024;
+const int MTLEngine::chunkEvictionInterval = 60;
+const uint32_t MTLEngine::worldSeed = 0;
+const ETerrainGenerator MTLEngine::terrainGenerator = ETerrainGenerator::Volumetric;
+const int MTLEngine::terrainOverhangBand = 2;
+const int MTLEngine::terrainLatticeSpacing = 4;
+const bool MTLEngine::measureTerrainLatticeError = false;
+const char* const MTLEngine::terrainGraphPath = "assets/Terrain/terrain.noisegraph";
+const float MTLEngine::digReach = 6.0f;
+
+static_assert(MTLEngine::worldMaxChunkY - MTLEngine::worldMinChunkY < 64, "ChunkColumn::queuedLevels has one bit per chunk level");
 
 
 void MTLEngine::init() {
-    //  - generate PerlinGenerator per chunk, radiating from origin chunk (Breadth-first search) (single-thread)
+    //  - queue the chunks to generate, radiating from origin chunk (Breadth-first search) (single-thread)
     //      - during gameplay, re-create this thread if there's a good reason to (e.g. player moves chunks)
     //  - add chunk to queue denoting it is ready for vertex buffer generation (can be spread out over X threads)
     //      - finished vertex buffer added to cache
@@ -61,8 +87,10 @@ void MTLEngine::init() {
     visibleChunkBuffer = nullptr;
     visibleChunksDirty = true;
     curChunk = Int3D(0,0,0);
+    frameIndex = 0;
     
     spaceWasDown = false;
+    digWasDown = false;
     
     keydownArr.fill(false);
     
@@ -115,6 +143,17 @@ void MTLEngine::init() {
     initLinePass();
     
     
+    chunkColumns = ToroidalGrid<ChunkColumn>(loadDistance + 1);
+    terrainNoise = WorldNoise(worldSeed != 0? worldSeed : std::random_device()());
+    if(terrainGenerator == ETerrainGenerator::NoiseGraph) {
+        std::string error;
+        if(std::optional<NoiseGraph> graph = NoiseGraph::load(terrainGraphPath, error); graph.has_value()) {
+            terrainGraph = NoiseGraphPlan::compile(*graph, TerrainGenerator::getGraphOutputNames(), terrainNoise.getSeed(), error);
+        }
+        if(!terrainGraph.has_value()) {
+            std::cout << "Error terrain graph: " << error << ", generating Volumetric terrain instead" << std::endl;
+        }
+    }
     initChunkGeneration();
     resolveChunkGeneration();
     initChunkRenderers();
@@ -165,6 +204,7 @@ void MTLEngine::cleanup() {
     msaaRenderTarget->release();
     depthRenderTarget->release();
     renderPassDescriptor->release();
+    ChunkRenderer::releaseQuadIndexBuffer();
     metalDevice->release();
     delete atlasTexture;
 }
@@ -403,29 +443,40 @@ void MTLEngine::initChunkGeneration() {
 
 void MTLEngine::resolveChunkGeneration() {
     // https://stackoverflow.com/a/36224563
-    if(perlinGenThread.joinable()) {
-        std::cout << "perlinGenThread is busy" << std::endl;
+    if(chunkQueueThread.joinable()) {
+        std::cout << "chunkQueueThread is busy" << std::endl;
         return;
     }
     
     chunkGenPending = false;
     
-    perlinGenThread = std::thread(&MTLEngine::createPerlinGenerators, this);
+    chunkQueueThread = std::thread(&MTLEngine::queueChunksToGenerate, this);
 }
 
-void MTLEngine::createPerlinGenerators() {
-    // perlinGenThreadBusy = true;
+void MTLEngine::queueChunksToGenerate() {
     // bfs
     //
     //
-    const int3 perlinRes = {1,1,1};
+    const Int3D center = curChunk;
+    {
+        // columns that left the window belong to chunks that are out of load distance
+        std::lock_guard<std::mutex> guard(chunkColumnsMutex);
+        chunkColumns.recenter(center, [](const Int3D& oldIndex, const Int3D& newIndex, ChunkColumn& column) {
+            column = ChunkColumn();
+        });
+    }
+    
+    // chunk levels within vertical load distance of the center
+    const int minLevel = std::max(worldMinChunkY, center.y - verticalLoadDistance);
+    const int maxLevel = std::min(worldMaxChunkY, center.y + verticalLoadDistance);
     
     std::set<Int3D> seen;
     
     std::queue<Int3D> queue;
     
     
-    queue.push(curChunk);
+    // the bfs runs over columns (y == 0), every level of a column is queued from there
+    queue.push(Int3D(center.x, 0, center.z));
     seen.insert(queue.front());
     
     while(!queue.empty()) {
@@ -438,56 +489,34 @@ void MTLEngine::createPerlinGenerators() {
         const Int3D top = index + Int3D(0, 0, 1);// top as in +z
         const Int3D bottom = index + Int3D(0, 0, -1);
         
-        if(!generators.contains(index)) {
-            PerlinNoiseGenerator newGenerator(perlinRes);
-            
-            // try to sync faces if the corresponding generator exists
-            // (we only generate of XZ plane, so only neighbors in that dimension)
-            
-            // 0: YZ face when x==0
-            // 1: YZ face when x==resolution.x
-            // 2: XZ face when y==0 (not used)
-            // 3: XZ face when y==resolution.y (not used)
-            // 4: XY face when z==0
-            // 5: XY face when z==resolution.z
-            if(generators.contains(right)) {
-                newGenerator.syncFace(generators[right], 0, 1);
-            }
-            
-            if(generators.contains(left)) {
-                newGenerator.syncFace(generators[left], 1, 0);
-            }
-            
-            if(generators.contains(top)) {
-                newGenerator.syncFace(generators[top], 4, 5);
-            }
-            
-            if(generators.contains(bottom)) {
-                newGenerator.syncFace(generators[bottom], 5, 4);
+        std::vector<Int3D> levelsToGenerate;
+        {
+            std::lock_guard<std::mutex> guard(chunkColumnsMutex);
+            
+            ChunkColumn& column = chunkColumns.at(index);
+            for(int y = minLevel; y <= maxLevel; y++) {
+                const uint64_t levelBit = uint64_t(1) << (y - worldMinChunkY);
+                if(!(column.queuedLevels & levelBit)) {
+                    column.queuedLevels |= levelBit;
+                    levelsToGenerate.push_back(Int3D(index.x, y, index.z));
+                }
             }
-            
-            generators.insert({index, newGenerator});
-            
-            // this chunk is ready to generate, and should be generated right away
-            // perhaps there's a "watcher" thread, watching chunksToGenerate and
-            // dispatches jobs as the queue fills up
-	    //
-	    chunksToGenerate.enqueue(index);
-            // std::lock_guard<std::mutex> guard(chunksToGenerateMutex);
-            //chunksToGenerate.push(index);
         }
-        else {
-            // checking dup is fine, since we always start from the chunk where the player is.
-            // - We will constantly be checking loadDistance * loadDistance chunks in this queue.
-            // - A better solution would be storing the current edge chunks and performing bfs from there
-            // - That would make this operation go from O(n^2) to O(2n)==O(n) where n is loadDistance
-            
-            // std::cout << "Checking dup!!!" << std::endl;
+        
+        // these chunks are ready to generate, and should be generated right away
+        // perhaps there's a "watcher" thread, watching chunksToGenerate and
+        // dispatches jobs as the queue fills up
+        //
+        // (levels that were queued before are skipped. We still visit every column within loadDistance
+        // on each pass, storing the current edge columns and performing bfs from there would make this
+        // O(n) instead of O(n^2) where n is loadDistance)
+        for(const Int3D& chunkIndex : levelsToGenerate) {
+            chunksToGenerate.enqueue(chunkIndex);
         }
         
         
-        if(abs(curChunk.x - index.x) < loadDistance &&
-           abs(curChunk.z - index.z) < loadDistance) {
+        if(abs(center.x - index.x) < loadDistance &&
+           abs(center.z - index.z) < loadDistance) {
             
             std::array<Int3D, 4> neighbors = {left, right, top, bottom};
             
@@ -501,11 +530,7 @@ void MTLEngine::createPerlinGenerators() {
         }
     }
     
-    // dispatch chunk generation jobs
-    // std::cout << "generators finished" << std::endl;
-    
-    // perlinGenThreadBusy = false;
-    perlinGenThread.detach();
+    chunkQueueThread.detach();
 }
 
 void MTLEngine::tryGenerateChunk() {
@@ -531,8 +556,37 @@ void MTLEngine::tryGenerateChunk() {
 
 void MTLEngine::generateChunk(Int3D chunkIndex) {
     // generates chunk's voxel types and initializes its vertex buffer
+    
+    // a level may be queued again while its chunk is still loaded (e.g. after its column left the window and came back)
+    if(loadedChunks.contains(chunkIndex)) {
+        return;
+    }
+    
+    std::shared_ptr<const TerrainHeightmap> heightmap;
+    {
+        std::lock_guard<std::mutex> guard(chunkColumnsMutex);
+        const ChunkColumn* column = chunkColumns.find(chunkIndex);
+        if(column == nullptr) {
+            // left the load area before it could be generated
+            return;
+        }
+        heightmap = column->heightmap;
+    }
+    
+    if(terrainGenerator == ETerrainGenerator::Heightmap && heightmap == nullptr) {
+        // the first level of the column to be generated builds its heightmap, the other levels reuse it.
+        // Two levels may build it at once, they get the same one
+        heightmap = std::make_shared<const TerrainHeightmap>(TerrainGenerator::createHeightmap(terrainNoise, chunkIndex.x, chunkIndex.z, chunkDims));
+        
+        std::lock_guard<std::mutex> guard(chunkColumnsMutex);
+        if(ChunkColumn* column = chunkColumns.find(chunkIndex); column != nullptr && column->heightmap == nullptr) {
+            column->heightmap = heightmap;
+        }
+    }
 
-    Chunk newChunk(this);
+    // built in place, inserting the handle into loadedChunks never copies or moves the chunk
+    ChunkHandle chunk = std::make_shared<Chunk>(this, voxelStorageMode);
+    Chunk& newChunk = *chunk;
     newChunk.setDimensions(chunkDims);
     newChunk.setIndex(chunkIndex);
     
@@ -540,85 +594,47 @@ void MTLEngine::generateChunk(Int3D chunkIndex) {
     {
         // Timer ttt("Generate chunk voxels");
         
-        // const int3 chunkXYZ = make_int3(chunkIndex.x, chunkIndex.y, chunkIndex.z);
-        
         // world position is its index * dimensions per chunk
         newChunk.setPosition(chunkIndex * chunkDims);
         
-        float3 chunkDimsFloat3 = make_float3(chunkDims.x, chunkDims.y, chunkDims.z);
-        
-        PerlinNoiseGenerator perlin = generators[chunkIndex];
-        int3 perlinRes = perlin.getResolution();
-        float3 perlinResFloat3 = make_float3(perlinRes.x, perlinRes.y, perlinRes.z);
-        
-        const int seaLevel = 5;
+        const int seaLevel = TerrainGenerator::seaLevel;
         
         std::uniform_real_distribution<float> dis(0.f, 1.f);
         std::default_random_engine gen;
         
-        const auto dims = newChunk.getDimensions();
-        for(int x=0; x<dims.x; x++) {
-            for(int y=0; y<dims.y; y++) {
-                for(int z=0; z<dims.z; z++) {
-                    float3 v = (make_float3(x,y,z) / chunkDimsFloat3) * perlinResFloat3; // * chunkDimsFloat3 + chunkPosFloat3;
-                    
-                    float p = perlin.noise(v);
-                    
-                    EVoxelType voxelType = EVoxelType::Dirt;
-                    
-                    float py = (float) y / dims.y;
-                    
-                    p += py * 0.9;
-                    
-                    // if y is high, more chance of being None
-                    
-                    
-                    if(p > 0) {
-                        voxelType = EVoxelType::None;
-                    }
-                    
-                    if(y == 0) {
-                        voxelType = EVoxelType::Stone;
-                    }
-                    
-                    if(y == dims.y - 1) {
-                        //  voxelType = EVoxelType::Stone;
-                    }
-                    
-                    if(voxelType == EVoxelType::Dirt && y < seaLevel + (-25 * perlin.noise(v * 0.5) + 5)) {
-                        voxelType = EVoxelType::Stone;
-                    }
-                    
-                    if(voxelType == EVoxelType::None &&
-                       y > 0 &&
-                       newChunk.getVoxel(Int3D(x,y-1,z)) == EVoxelType::Dirt
-                       ) {
-                        
-                        newChunk.setVoxel(Int3D(x,y-1,z), EVoxelType::Grass);
-                    }
-                    
-                    if(y == dims.y - 1 && voxelType == EVoxelType::Dirt) {
-                        voxelType = EVoxelType::Grass;
-                    }
-                    
-                    if(voxelType == EVoxelType::None && y < seaLevel) {
-                        voxelType = EVoxelType::Water;
-                    }
-                    
-                    
-                    //voxelType = EVoxelType::Water;
-                    if(y == 0) {
-                        //voxelType = EVoxelType::Stone;
-                    }
-                    
-                    newChunk.setVoxel({x,y,z}, voxelType);
-                }
+        if(terrainGenerator == ETerrainGenerator::Heightmap) {
+            TerrainGenerator::fillFromHeightmap(newChunk, terrainNoise, *heightmap, chunkIndex, terrainOverhangBand);
+        }
+        else if(terrainGenerator == ETerrainGenerator::CoarseLattice) {
+            if(measureTerrainLatticeError) {
+                TerrainLatticeError error;
+                TerrainGenerator::fillFromLattice(newChunk, terrainNoise, chunkIndex, terrainLatticeSpacing, &error);
+                std::lock_guard<std::mutex> guard(terrainLatticeErrorMutex);
+                terrainLatticeError.add(error);
             }
+            else {
+                TerrainGenerator::fillFromLattice(newChunk, terrainNoise, chunkIndex, terrainLatticeSpacing);
+            }
+        }
+        else if(terrainGenerator == ETerrainGenerator::NoiseGraph && terrainGraph.has_value()) {
+            TerrainGenerator::fillFromGraph(newChunk, *terrainGraph, chunkIndex);
+        }
+        else {
+            TerrainGenerator::fillVolumetric(newChunk, terrainNoise, chunkIndex);
         }
         
+        const auto dims = newChunk.getDimensions();
+        
         // 2nd pass (trees, etc.)
         for(int x=0; x<dims.x; x++) {
             for(int y=0; y<dims.y; y++) {
+                // only stone voxels are considered below, skip sections that can't have any
+                const ChunkSection& section = newChunk.getSection(y / ChunkSection::size);
+                if(section.isUniform() && section.getUniformType() != EVoxelType::Stone) {
+                    y += ChunkSection::size - 1;
+                    continue;
+                }
+                
                 for(int z=0; z<dims.z; z++) {
                     auto voxelType = newChunk.getVoxel(Int3D(x,y,z));
                     
@@ -641,23 +657,54 @@ void MTLEngine::generateChunk(Int3D chunkIndex) {
                             newChunk.setVoxelLightColor({x,y,z}, randColor);
                             
                             float3 voxelPosWS = newChunk.getPositionAsFloat3() + make_float3(x,y,z);
-                            addPointLight(voxelPosWS + make_float3(0.5, 0.5, 0.5), randColor);
+                            const int lightId = addPointLight(voxelPosWS + make_float3(0.5, 0.5, 0.5), randColor);
+                            if(lightId != -1) {
+                                newChunk.addPointLightId(lightId);
+                            }
                             newChunk.setVoxel({x,y,z}, voxelType);
                         }
                     }
                 }
             }
         }
+        
+        newChunk.compactVoxelStorage();
     }
     
+    const size_t voxelBytes = newChunk.getMemoryUsage().getTotal();
+    
+    if(!loadedChunks.insert(chunkIndex, chunk)) {
+        // another worker generated it first
+        for(int lightId : chunk->getPointLightIds()) {
+            removePointLight(lightId);
+        }
+        return;
+    }
+    
+    // the levels above and below that were already meshed did so against air where this chunk is
+    std::vector<Int3D> chunksToRemesh;
     {
-        std::lock_guard<std::mutex> guard(loadedChunksMutex);
-        loadedChunks.insert({chunkIndex, newChunk});
+        std::lock_guard<std::mutex> guard(cachedChunkRDMutex);
+        // (unless it was already unloaded again)
+        if(loadedChunks.contains(chunkIndex)) {
+            chunkMemoryUsage.insert(chunkIndex, voxelBytes);
+        }
+        for(const Int3D& neighbor : {chunkIndex + Int3D(0, 1, 0), chunkIndex + Int3D(0, -1, 0)}) {
+            if(meshedChunks.contains(neighbor)) {
+                chunksToRemesh.push_back(neighbor);
+            }
+        }
     }
     
     {
-	std::lock_guard<std::mutex> guard(chunksToMeshPTokMutex);
-	assert(chunksToMesh.enqueue(chunksToMeshPTok, chunkIndex));
+        // (enqueued outside the asserts, which compile away under NDEBUG)
+        std::lock_guard<std::mutex> guard(chunksToMeshPTokMutex);
+        bool queued = chunksToMesh.enqueue(chunksToMeshPTok, chunkIndex);
+        for(const Int3D& neighbor : chunksToRemesh) {
+            queued &= chunksToMesh.enqueue(chunksToMeshPTok, neighbor);
+        }
+        assert(queued);
+        (void) queued;
     }
 }
 
@@ -667,16 +714,16 @@ void MTLEngine::tryMeshChunk() {
     while(true) {
         std::optional<Int3D> chunkToMesh;
 	Int3D chunkInd;
-	if(chunksToMesh.try_dequeue(chunkInd)) {
+	if(chunksToMesh.try_dequeue(chunkInd) && loadedChunks.contains(chunkInd)) {
+	    // (chunks that were unloaded while queued are dropped)
 	    // we can only mesh the chunk if all of its neighbors are loaded
+	    // (levels above/below the world have no chunks, and neither do the levels past the vertical load
+	    // distance, they're meshed against as air. generateChunk re-meshes the chunk if one arrives later)
 	    bool allNeighborsLoaded = true;
-	    {
-		std::lock_guard<std::mutex> guard(loadedChunksMutex);
-		auto neighbors = chunkInd.getNeighbors();
-		for(const auto n: neighbors) {
-		    bool hasNeighbor = loadedChunks.find(n) != loadedChunks.end();
-		    allNeighborsLoaded &= hasNeighbor;
-		}
+	    for(const Int3D& n : chunkInd.getAllNeighbors()) {
+		const bool isVerticalNeighbor = n.y != chunkInd.y;
+		allNeighborsLoaded &= !isChunkLevelInWorld(n.y) || loadedChunks.contains(n)
+		                      || (isVerticalNeighbor && !isChunkQueuedForGeneration(n));
 	    }
 	    
 	    if(allNeighborsLoaded) {
@@ -686,7 +733,9 @@ void MTLEngine::tryMeshChunk() {
 		// re-queue
 		//
 		std::lock_guard<std::mutex> guard(chunksToMeshPTokMutex);
-		assert(chunksToMesh.enqueue(chunksToMeshPTok, chunkInd));
+		const bool queued = chunksToMesh.enqueue(chunksToMeshPTok, chunkInd);
+		assert(queued);
+		(void) queued;
 		
 		// std::cout << "re-queueing chunk: " << chunkInd.x << ", " << chunkInd.y << ", " << chunkInd.z << std::endl;
 	    }
@@ -696,528 +745,714 @@ void MTLEngine::tryMeshChunk() {
 	    //std::cout << "meshing chunk: " << chunkInd.x << ", " << chunkInd.y << ", " << chunkInd.z << std::endl;
             meshChunk(chunkToMesh.value());
         }
+        
+        // lower level of detail meshes are only queued as chunks change ring, and cost a fraction of a full
+        // mesh, so they're all built right away
+        while(chunksToMeshLOD.try_dequeue(chunkInd)) {
+            meshRequestedChunkLOD(chunkInd);
+        }
 
         std::this_thread::sleep_for(50ms);
     }
 }
 
+bool MTLEngine::isChunkQueuedForGeneration(const Int3D& chunkIndex) {
+    std::lock_guard<std::mutex> guard(chunkColumnsMutex);
+    const ChunkColumn* column = chunkColumns.find(chunkIndex);
+    return column != nullptr && (column->queuedLevels & (uint64_t(1) << (chunkIndex.y - worldMinChunkY)));
+}
+
+// shared locks on the voxels of a chunk and of its neighbors, while a mesh worker reads them (only around the
+// reads: editVoxel waits for these, the rest of the meshing runs alongside it and is dropped if it's stale)
+typedef std::array<std::shared_lock<std::shared_mutex>, 7> ChunkMeshVoxelLocks;
+static ChunkMeshVoxelLocks lockMeshVoxels(const Chunk& chunk, const ChunkMeshNeighbors& neighbors) {
+    ChunkMeshVoxelLocks locks;
+    locks[0] = std::shared_lock<std::shared_mutex>(chunk.getVoxelsMutex());
+    for(int i = 0; i < (int) neighbors.size(); i++) {
+        if(neighbors[i] != nullptr) {
+            locks[i + 1] = std::shared_lock<std::shared_mutex>(neighbors[i]->getVoxelsMutex());
+        }
+    }
+    return locks;
+}
+
+ChunkMeshNeighbors MTLEngine::findMeshNeighbors(const Int3D& chunkIndex, std::array<ChunkHandle, 6>& outHandles) {
+    // +x, -x, +z, -z, -y, +y (the Y neighbors are nullptr above/below the world, where it's all air)
+    ChunkMeshNeighbors neighbors;
+    auto neighborInds = chunkIndex.getAllNeighbors();
+    for(int i=0; i<(int)neighborInds.size(); i++) {
+        outHandles[i] = loadedChunks.find(neighborInds[i]);
+        neighbors[i] = outHandles[i].get();
+    }
+    return neighbors;
+}
+
 void MTLEngine::meshChunk(Int3D chunkIndex) {
-    Chunk* chunk;
-    std::array<Chunk*, 4> neighbors;
+    int lod = 0;
+    uint32_t editGeneration = 0;
+    bool isBeingMeshed = false;
     {
-        std::lock_guard<std::mutex> guard(loadedChunksMutex);
-        chunk = &loadedChunks.at(chunkIndex);
-        auto neighborInds = chunkIndex.getNeighbors();
-        for(int i=0; i<(int)neighborInds.size(); i++) {
-            neighbors[i] = &loadedChunks.at(neighborInds[i]);
+        // marked before the neighbors are looked up: a level generated after this either is among them,
+        // or sees the mark and queues the chunk again (see generateChunk)
+        std::lock_guard<std::mutex> guard(cachedChunkRDMutex);
+        if(!loadedChunks.contains(chunkIndex)) {
+            return;
+        }
+        isBeingMeshed = chunksBeingMeshed.contains(chunkIndex);
+        if(!isBeingMeshed) {
+            chunksBeingMeshed.insert(chunkIndex, true);
         }
     }
+    if(isBeingMeshed) {
+        // another worker is meshing it, possibly from voxels before it was queued again: meshed once that's done
+        std::lock_guard<std::mutex> guard(chunksToMeshPTokMutex);
+        const bool queued = chunksToMesh.enqueue(chunksToMeshPTok, chunkIndex);
+        assert(queued);
+        (void) queued;
+        return;
+    }
     
-    std::vector<VertexData> chunkVertices;
-    std::vector<VertexData> transparentVertices;
+    // unmarked however this returns
+    struct BeingMeshedGuard {
+        MTLEngine& engine;
+        Int3D chunkIndex;
+        ~BeingMeshedGuard() {
+            std::lock_guard<std::mutex> guard(engine.cachedChunkRDMutex);
+            engine.chunksBeingMeshed.erase(chunkIndex);
+        }
+    } beingMeshedGuard{*this, chunkIndex};
+    
+    {
+        std::lock_guard<std::mutex> guard(cachedChunkRDMutex);
+        if(!meshedChunks.contains(chunkIndex)) {
+            meshedChunks.insert(chunkIndex, true);
+        }
+        
+        // the planes of earlier edits are stale once this mesh replaces theirs
+        editedChunkMeshes.erase(chunkIndex);
+        
+        // the lower level of detail mesh it's drawn with, if any, is rebuilt along with it
+        auto lodIt = ChunkRenderer::cachedChunkLODBuffers.find(chunkIndex);
+        lod = lodIt != ChunkRenderer::cachedChunkLODBuffers.end()? lodIt->second.lod : 0;
+        
+        // read before the voxels, an edit made while they're read makes this mesh stale
+        editGeneration = getChunkEditGeneration(chunkIndex);
+    }
+    
+    // the handles keep the chunks alive while meshing, the raw pointers are just for convenience
+    ChunkHandle chunkHandle = loadedChunks.find(chunkIndex);
+    std::array<ChunkHandle, 6> neighborHandles;
+    
+    Chunk* chunk = chunkHandle.get();
+    const ChunkMeshNeighbors neighbors = findMeshNeighbors(chunkIndex, neighborHandles);
+    
+    // (a neighbor unloaded since tryMeshChunk checked them is meshed against as air, like the levels
+    // outside the world)
+    if(chunk == nullptr) {
+        return;
+    }
+    
+    // this worker's buffers, reused from chunk to chunk
+    ChunkMeshScratch& scratch = ChunkMesher::getThreadScratch();
+    std::vector<VertexData>& chunkVertices = scratch.chunkVertices;
+    std::vector<VertexData>& transparentVertices = scratch.transparentVertices;
+    chunkVertices.clear();
+    transparentVertices.clear();
+    ChunkFaceRanges chunkRanges;
+    ChunkFaceRanges transparentRanges;
+    std::vector<std::unique_ptr<CollisionRect>> collisionRects;
     
     {
         // Timer ttt("Chunk Greedy Meshing");
         
         // greedy meshing
-        Int3D dimsU = chunk->getDimensions();
-        std::array<int, 3> dims = { (int) dimsU.x, (int) dimsU.y, (int) dimsU.z};
+        ChunkMeshQuads& meshQuads = scratch.quads;
+        meshQuads.clear();
+        {
+            ChunkMeshVoxelLocks voxelLocks = lockMeshVoxels(*chunk, neighbors);
+            ChunkMesher::mesh(chunkMesher, *chunk, neighbors, meshQuads);
+        }
         
-        struct Quad {
-            Quad() = default;
-            
-            std::array<float4, 4> positions; // world-space positions
-            float3 normal;
-            float width;
-            float height;
-            EVoxelType vxType;
+        // built aside and swapped in whole with the mesh, physicsTick may be using the rects of the previous one
+        addCollisionRects(*chunk, meshQuads.opaque, collisionRects);
+        
+        buildChunkVertices(*chunk, meshQuads, chunkVertices, transparentVertices, chunkRanges, transparentRanges);
+    }
+    
+    storeChunkRenderData(chunkIndex, *chunk, chunkVertices, transparentVertices, chunkRanges, transparentRanges,
+                         editGeneration, &collisionRects);
+    meshChunkLOD(chunkIndex, *chunk, neighbors, lod, editGeneration);
+}
+
+void MTLEngine::addCollisionRects(const Chunk& chunk, const std::vector<ChunkMeshQuad>& quads,
+                                  std::vector<std::unique_ptr<CollisionRect>>& outRects) {
+    for(const ChunkMeshQuad& q : quads) {
+        if(!voxelTypeAtlasIndexMap.contains(q.vxType)) {
+            continue;
+        }
+        
+        std::array<simd::float3, 4> quadPosLS;
+        for(int i = 0; i < q.positions.size(); i++) {
+            quadPosLS[i] = q.positions[i].xyz - chunk.getPositionAsFloat3();
+        }
+        
+        outRects.push_back(chunk.makeCollisionRect(quadPosLS, q.normal));
+    }
+}
+
+void MTLEngine::buildChunkVertices(const Chunk& chunk, const ChunkMeshQuads& quads,
+                                   std::vector<VertexData>& outChunkVertices, std::vector<VertexData>& outTransparentVertices,
+                                   ChunkFaceRanges& outChunkRanges, ChunkFaceRanges& outTransparentRanges) {
+    // invidiual voxels (voxels that shouldn't be merged, e.g. light blocks)
+    // essentially non-terrain voxels, or more complex voxels that have their own attributes
+    
+    // Cube for use in a right-handed coordinate system with triangle faces
+    // specified with a Counter-Clockwise winding order.
+    
+    const float3 fwd {0,0,1};
+    const float3 top {0,1,0};
+    const float3 right {1,0,0};
+    static const std::vector<VertexData> cubeVertTemplate = {
+        // Front face
+        {{-0.5, -0.5, 0.5, 1.0}, {0.0, 0.0}, fwd},
+        {{0.5, -0.5, 0.5, 1.0}, {1.0, 0.0}, fwd},
+        {{0.5, 0.5, 0.5, 1.0}, {1.0, 1.0}, fwd},
+        {{0.5, 0.5, 0.5, 1.0}, {1.0, 1.0}, fwd},
+        {{-0.5, 0.5, 0.5, 1.0}, {0.0, 1.0}, fwd},
+        {{-0.5, -0.5, 0.5, 1.0}, {0.0, 0.0}, fwd},
+
+        // Back face
+        {{0.5, -0.5, -0.5, 1.0}, {0.0, 0.0}, -fwd},
+        {{-0.5, -0.5, -0.5, 1.0}, {1.0, 0.0}, -fwd},
+        {{-0.5, 0.5, -0.5, 1.0}, {1.0, 1.0}, -fwd},
+        {{-0.5, 0.5, -0.5, 1.0}, {1.0, 1.0}, -fwd},
+        {{0.5, 0.5, -0.5, 1.0}, {0.0, 1.0}, -fwd},
+        {{0.5, -0.5, -0.5, 1.0}, {0.0, 0.0}, -fwd},
+
+        // Top face
+        {{-0.5, 0.5, 0.5, 1.0}, {0.0, 0.0}, top},
+        {{0.5, 0.5, 0.5, 1.0}, {1.0, 0.0}, top},
+        {{0.5, 0.5, -0.5, 1.0}, {1.0, 1.0}, top},
+        {{0.5, 0.5, -0.5, 1.0}, {1.0, 1.0}, top},
+        {{-0.5, 0.5, -0.5, 1.0}, {0.0, 1.0}, top},
+        {{-0.5, 0.5, 0.5, 1.0}, {0.0, 0.0}, top},
+
+        // Bottom face
+        {{-0.5, -0.5, -0.5, 1.0}, {0.0, 0.0}, -top},
+        {{0.5, -0.5, -0.5, 1.0}, {1.0, 0.0}, -top},
+        {{0.5, -0.5, 0.5, 1.0}, {1.0, 1.0}, -top},
+        {{0.5, -0.5, 0.5, 1.0}, {1.0, 1.0}, -top},
+        {{-0.5, -0.5, 0.5, 1.0}, {0.0, 1.0}, -top},
+        {{-0.5, -0.5, -0.5, 1.0}, {0.0, 0.0}, -top},
+
+        // Left face
+        {{-0.5, -0.5, -0.5, 1.0}, {0.0, 0.0}, -right},
+        {{-0.5, -0.5, 0.5, 1.0}, {1.0, 0.0}, -right},
+        {{-0.5, 0.5, 0.5, 1.0}, {1.0, 1.0}, -right},
+        {{-0.5, 0.5, 0.5, 1.0}, {1.0, 1.0}, -right},
+        {{-0.5, 0.5, -0.5, 1.0}, {0.0, 1.0}, -right},
+        {{-0.5, -0.5, -0.5, 1.0}, {0.0, 0.0}, -right},
+
+        // Right face
+        {{0.5, -0.5, 0.5, 1.0}, {0.0, 0.0}, right},
+        {{0.5, -0.5, -0.5, 1.0}, {1.0, 0.0}, right},
+        {{0.5, 0.5, -0.5, 1.0}, {1.0, 1.0}, right},
+        {{0.5, 0.5, -0.5, 1.0}, {1.0, 1.0}, right},
+        {{0.5, 0.5, 0.5, 1.0}, {0.0, 1.0}, right},
+        {{0.5, -0.5, 0.5, 1.0}, {0.0, 0.0}, right},
+    };
+    
+    // the lamps' faces, in chunkVertexLayout (in this thread's scratch buffer)
+    std::vector<VertexData>& lampVertices = ChunkMesher::getThreadScratch().lampVertices;
+    lampVertices.clear();
+    const int numLampVerticesPerFace = chunkVertexLayout == EChunkVertexLayout::IndexedQuads? 4 : 6;
+    
+    const VoxelAtlasEntry& lampEntry = voxelTypeAtlasIndexMap[EVoxelType::Lamp];
+    for(auto [coord, color] : chunk.getVoxelLightColorMap()) {
+        float3 localOffset = coord.to_float3() + make_float3(0.5, 0.5, 0.5);
+        
+        float4 offset = chunk.getPositionAsFloat4() + make_float4(localOffset.x, localOffset.y, localOffset.z, 0.0f);
+        const matrix_float4x4 toWorld = matrix4x4_translation(offset.x, offset.y, offset.z);
+        auto addVertex = [&](const VertexData& templateVertex) {
+            VertexData vd = templateVertex;
+            // to WS position
+            vd.position = toWorld * vd.position;
+            vd.atlasIndex = lampEntry.right; // all the same, anyway
+            vd.colorScale = color;
+            lampVertices.push_back(vd);
         };
         
-        std::vector<Quad> quads;
-        std::vector<Quad> waterQuads;
-        // std::vector<int2> quadHW;
-        
-        // TODO: chunk will hold array of possible voxel types it currently has
-        std::vector<EVoxelType> voxelTypesToCheck = {EVoxelType::Grass, EVoxelType::Dirt, EVoxelType::Stone, EVoxelType::Water};
-        
-        // this currently costs: O(n * dims^3) where n is number of voxel types
-        for(const EVoxelType& voxelType : voxelTypesToCheck) {
-            for(int d=0; d<3; d++) {
-                // std::cout << "mask = " << d << std::endl;
-                int u = (d+1)%3;
-                int v = (d+2)%3;
-                std::array<int, 3> x = {0,0,0};
-                std::array<int, 3> q = {0,0,0}; // delta
-                
-                struct MaskData {
-                    MaskData() = default;
-                    MaskData(bool incident, bool isBackface)
-                    : incident(incident), isBackface(isBackface) {};
-                    
-                    bool incident;
-                    bool isBackface;
-                };
-                std::vector<MaskData> mask(dims[u] * dims[v], MaskData());
-                
-                
-                q[d] = 1;
-                
-                for(x[d]=-1; x[d]<(int)dims[d]; ) {
-                    int n = 0;
-                    
-                    for(x[v]=0; x[v]<dims[v]; x[v]++) {
-                        for(x[u]=0; x[u]<dims[u]; x[u]++) {
-                            
-                            // d==0 front-back
-                            // d==1 top-bottom
-                            // d==2 left-right
-                            Chunk* beforeChunk = nullptr;
-                            Chunk* afterChunk = nullptr;
-                            if(d==0) {
-                                beforeChunk = neighbors[1];
-                                afterChunk = neighbors[0];
-                            }
-                            else if(d==2) {
-                                beforeChunk = neighbors[3];
-                                afterChunk = neighbors[2];
-                            }
-                            
-                            const bool xInRangeLeft = x[d] >= 0; // only invalid when x[d]==-1 on first iteration
-                            const bool xInRangeRight = x[d] < dims[d] - 1;
-                            
-                            bool xVal = false;
-                            
-                            EVoxelType xValType = EVoxelType::None;
-                            EVoxelType xDeltaValType = EVoxelType::None;
-                            
-                            if(xInRangeLeft) {
-                                xValType = chunk->getVoxel({(int) x[0], (int) x[1], (int) x[2]});
-                            }
-                            else {
-                                if(d != 1) {
-                                    if(d == 0) {
-                                        xValType = beforeChunk->getVoxel({(int) dims[d] - 1, (int) x[1], (int) x[2]});
-                                    }
-                                    else if(d == 2) {
-                                        xValType = beforeChunk->getVoxel({(int) x[0], (int) x[1], (int) dims[d] - 1});
-                                    }
-                                }
-                                else {
-                                    xValType = EVoxelType::None;
-                                }
-                            }
-                            
-                           
-                            bool xDeltaVal = false;
-                            if(xInRangeRight) {
-                                xDeltaValType = chunk->getVoxel({(int) x[0] + q[0], (int) x[1]+q[1], (int) x[2]+q[2]});
-                            }
-                            else {
-                                if(d != 1) {
-                                    if(d == 0) {
-                                        xDeltaValType = afterChunk->getVoxel({(int) 0, (int) x[1], (int) x[2]});
-                                    }
-                                    else if(d == 2) {
-                                        xDeltaValType = afterChunk->getVoxel({(int) x[0], (int) x[1], (int) 0});
-                                    }
-                                }
-                                else {
-                                    xDeltaValType = EVoxelType::None;
-                                }
-                            }
-                            
-                            
-                            /*
-                             
-                            const bool xVal = xInRangeLeft?
-                            chunk.getVoxel({(int) x[0], (int) x[1], (int) x[2]}) == voxelType
-                            : false;
-                             
-                             
-                            const bool xDeltaVal = xInRangeRight?
-                            chunk.getVoxel({(int) x[0] + q[0], (int) x[1]+q[1], (int) x[2]+q[2]}) == voxelType
-                            : false;
-                            */
-                            
-                            //
-                            // depending which is seen determines the normal (and quad orientation)
-                            //
-                            // Say X is a non-empty voxel:
-                            //
-                            // [ |X| ] =>  - when x==0  =>  normal is <-
-                            // [0|1|2]     - when x==1  =>  normal is ->
-                            //
-                            
-                            bool incident = false;
-                            bool isBackface = false;
-                            
-                            if(voxelType != EVoxelType::Water) {
-                                if(xValType == voxelType && (xDeltaValType == EVoxelType::None || xDeltaValType == EVoxelType::Water)) {
-                                    incident = true;
-                                    isBackface = true;
-                                }
-                                
-                                if(xDeltaValType == voxelType && (xValType == EVoxelType::None || xValType == EVoxelType::Water)) {
-                                    incident = true;
-                                    isBackface = false;
-                                }
-                            }
-                            else {
-                                if(xValType == voxelType && (xDeltaValType == EVoxelType::None)) {
-                                    incident = true;
-                                    isBackface = true;
-                                }
-                                
-                                if(xDeltaValType == voxelType && (xValType == EVoxelType::None)) {
-                                    incident = true;
-                                    isBackface = false;
-                                }
-                            }
-                            
-                            
-                            // mask[n] = MaskData(xVal != xDeltaVal, xVal && !xDeltaVal);
-                            mask[n] = MaskData(incident, isBackface);
-                            n++;
-                        }
-                    }
-                    
-                    x[d]++;
-                    n = 0;
-                    
-                    for(int j=0; j<dims[v]; j++) {
-                        for(int i=0; i<dims[u]; ) {
-                            if(mask[n].incident) {
-                                int w;
-                                for(w=1; i+w<dims[u] && mask[n+w].incident ; w++) {
-                                }
-                                
-                                bool done = false;
-                                int h;
-                                int k;
-                                for(h=1; j+h<dims[v]; h++) {
-                                    for(k=0; k<w; k++) {
-                                        if(!mask[n+k+h*dims[u]].incident) {
-                                            done = true;
-                                            break;
-                                        }
-                                    }
-                                    if(done) {
-                                        break;
-                                    }
-                                }
-                                
-                                
-                                x[u] = i; x[v] = j;
-                                std::array<int, 3> du = {0, 0, 0};
-                                std::array<int, 3> dv = {0, 0, 0};
-                                du[u] = w;
-                                dv[v] = h;
-                                
-                                float4 worldOffset = chunk->getPositionAsFloat4();
-                                
-                                // coords in counter-clockwise (CCW)
-                                std::array<float4, 4> verts = {
-                                    make_float4(x[0], x[1], x[2], 1.0) + worldOffset,
-                                    make_float4(x[0]+du[0], x[1]+du[1], x[2]+du[2], 1.0) + worldOffset,
-                                    make_float4(x[0]+du[0]+dv[0], x[1]+du[1]+dv[1], x[2]+du[2]+dv[2], 1.0) + worldOffset,
-                                    make_float4(x[0]+dv[0], x[1]+dv[1], x[2]+dv[2], 1.0) + worldOffset,
-                                };
-                                
-                                // ordering to ensure CCW direction
-                                static int order[6][4] = {
-                                    {0,3,2,1}, // front-back
-                                    {3,2,1,0}, // top-bottom
-                                    {1,0,3,2}, // left-right
-                                    
-                                    {3,0,1,2}, // front-back (backface)
-                                    {0,1,2,3}, // top-bottom (backface)
-                                    {0,1,2,3}, // left-right (backface)
-                                };
-                                
-                                Quad newQuad;
-                                newQuad.vxType = voxelType;
-                                
-                                if(mask[n].isBackface) {
-                                    newQuad.positions[0] = verts[order[d+3][0]];
-                                    newQuad.positions[1] = verts[order[d+3][1]];
-                                    newQuad.positions[2] = verts[order[d+3][2]];
-                                    newQuad.positions[3] = verts[order[d+3][3]];
-                                }
-                                else{
-                                    newQuad.positions[0] = verts[order[d][0]];
-                                    newQuad.positions[1] = verts[order[d][1]];
-                                    newQuad.positions[2] = verts[order[d][2]];
-                                    newQuad.positions[3] = verts[order[d][3]];
-                                }
-                                
-                                // BUG: width/height reversed in certain directions???
-                                newQuad.width = d == 0? h : w;
-                                newQuad.height = d == 0? w : h;
-                                
-                                if(d == 0) {
-                                    newQuad.normal = make_float3(-1.0,0,0);
-                                }
-                                else if(d == 1) {
-                                    // algo goes bottom to top
-                                    newQuad.normal = make_float3(0,-1.0,0);
-                                }
-                                else if(d == 2) {
-                                    newQuad.normal = make_float3(0,0,-1.0f);
-                                }
-                                
-                                if(mask[n].isBackface) {
-                                    newQuad.normal = -1 * newQuad.normal;
-                                }
-                                
-                                // TODO: we can add quads to 3 separate arrays (when d=0,1,2)
-                                // so we can assume normals when constructing the vertex buffer
-                                if(voxelType == EVoxelType::Water) {
-                                    waterQuads.push_back(newQuad);
-                                }
-                                else {
-                                    quads.push_back(newQuad);
-                                }
-                                
-                                for(int l=0; l<h; l++) {
-                                    for(k=0; k<w; k++) {
-                                        // reset
-                                        mask[n+k+l*dims[u]] = MaskData();
-                                    }
-                                }
-                                
-                                i += w; n += w;
-                            }
-                            else {
-                                i++;
-                                n++;
-                            }
-                        }
-                    }
+        if(chunkVertexLayout == EChunkVertexLayout::IndexedQuads) {
+            // each face of the template is a quad's corners in quadIndexPattern order
+            for(int face = 0; face < (int) cubeVertTemplate.size(); face += 6) {
+                for(int corner : {0, 1, 2, 4}) {
+                    addVertex(cubeVertTemplate[face + corner]);
                 }
             }
         }
+        else {
+            for(const VertexData& templateVertex : cubeVertTemplate) {
+                addVertex(templateVertex);
+            }
+        }
+    }
+    
+    // one face direction after the other, so the renderer can skip the directions facing away from the camera
+    const size_t numVerticesPerQuad = chunkVertexLayout == EChunkVertexLayout::IndexedQuads? 4 : 6;
+    outChunkVertices.reserve(outChunkVertices.size() + quads.opaque.size() * numVerticesPerQuad + lampVertices.size());
+    outTransparentVertices.reserve(outTransparentVertices.size() + quads.water.size() * numVerticesPerQuad);
+    for(int direction = 0; direction < numChunkFaceDirections; direction++) {
+        outChunkRanges.offsets[direction] = (int) outChunkVertices.size();
+        outTransparentRanges.offsets[direction] = (int) outTransparentVertices.size();
         
-        const float3 defaultColorScale {0,0,0};
+        ChunkMesher::writeVerticesFacing(quads.opaque, direction, voxelTypeAtlasIndexMap, chunkVertexLayout, outChunkVertices);
+        ChunkMesher::writeVerticesFacing(quads.water, direction, voxelTypeAtlasIndexMap, chunkVertexLayout, outTransparentVertices);
         
-        for(int i=0; i<quads.size(); i++) {
-            const Quad& q = quads[i];
-            
-            if(!voxelTypeAtlasIndexMap.contains(q.vxType)) {
-                continue;
-            }
-            
-            // rely on correct vertex-ordering for texture orientation,
-            // as we treat these uv coords as a front-face for all faces.
-            
-            const VoxelAtlasEntry& atlasEntry = voxelTypeAtlasIndexMap[q.vxType];
-            int atlasIndex = -1;
-            
-            EAxis collisionAxis = EAxis::X;
-            
-            if(q.normal.x == 1.0f) {
-                atlasIndex = atlasEntry.right;
-                collisionAxis = EAxis::X;
-            }
-            else if(q.normal.x == -1.0f) {
-                atlasIndex = atlasEntry.left;
-                collisionAxis = EAxis::X;
-            }
-            else if(q.normal.y == 1.0f) {
-                atlasIndex = atlasEntry.top;
-                collisionAxis = EAxis::Y;
-            }
-            else if(q.normal.y == -1.0f) {
-                atlasIndex = atlasEntry.bottom;
-                collisionAxis = EAxis::Y;
+        for(size_t face = 0; face < lampVertices.size(); face += numLampVerticesPerFace) {
+            if(packedNormalIndex(lampVertices[face].normal) == direction) {
+                outChunkVertices.insert(outChunkVertices.end(), lampVertices.begin() + face, lampVertices.begin() + face + numLampVerticesPerFace);
             }
-            else if(q.normal.z == 1.0f) {
-                atlasIndex = atlasEntry.front;
-                collisionAxis = EAxis::Z;
-            }
-            else if(q.normal.z == -1.0f) {
-                atlasIndex = atlasEntry.back;
-                collisionAxis = EAxis::Z;
-            }
-            
-            
-            chunkVertices.push_back({q.positions[0], {0.0, 0.0}, q.normal, atlasIndex, defaultColorScale });
-            chunkVertices.push_back({q.positions[1], {q.width, 0.0}, q.normal, atlasIndex, defaultColorScale });
-            chunkVertices.push_back({q.positions[2], {q.width, q.height}, q.normal, atlasIndex, defaultColorScale });
-            
-            chunkVertices.push_back({q.positions[2], {q.width, q.height}, q.normal, atlasIndex, defaultColorScale });
-            chunkVertices.push_back({q.positions[3], {0.0, q.height}, q.normal, atlasIndex, defaultColorScale });
-            chunkVertices.push_back({q.positions[0], {0.0, 0.0}, q.normal, atlasIndex, defaultColorScale });
-            
-            std::array<simd::float3, 4> quadPosLS;
-            for(int i = 0; i < q.positions.size(); i++) {
-                quadPosLS[i] = q.positions[i].xyz - chunk->getPositionAsFloat3();
-            }
-            
-            chunk->addCollisionRect(quadPosLS, q.normal);
         }
+    }
+    outChunkRanges.offsets[numChunkFaceDirections] = (int) outChunkVertices.size();
+    outTransparentRanges.offsets[numChunkFaceDirections] = (int) outTransparentVertices.size();
+}
+
+// the vertex buffers of a chunk's lower level of detail mesh
+static size_t getLODBytes(const ChunkLODRenderData& lodRD) {
+    return sizeof(VertexData) * (lodRD.opaque.numVertices + lodRD.transparent.numVertices);
+}
+
+ChunkRenderData MTLEngine::createChunkRenderData(const std::vector<VertexData>& vertices, const ChunkFaceRanges& faceRanges) {
+    ChunkRenderData rd;
+    rd.buffer = vertices.size() > 0? metalDevice->newBuffer(vertices.data(), sizeof(VertexData) * vertices.size(), MTL::ResourceStorageModeShared) : nullptr;
+    rd.numVertices = (int) vertices.size();
+    rd.faceRanges = faceRanges;
+    
+    // indexed buffers are drawn with the shared quad index buffer, 6 indices per 4 vertices
+    if(chunkVertexLayout == EChunkVertexLayout::IndexedQuads) {
+        assert(vertices.size() % 4 == 0);
+        assert(vertices.size() / 4 <= ChunkRenderer::quadIndexBufferNumQuads);
+        rd.numIndices = (int) (vertices.size() / 4 * ChunkMesher::quadIndexPattern.size());
+    }
+    return rd;
+}
+
+void MTLEngine::storeChunkRenderData(const Int3D& chunkIndex, Chunk& chunk,
+                                     const std::vector<VertexData>& chunkVertices, const std::vector<VertexData>& transparentVertices,
+                                     const ChunkFaceRanges& chunkRanges, const ChunkFaceRanges& transparentRanges,
+                                     uint32_t editGeneration, std::vector<std::unique_ptr<CollisionRect>>* collisionRects,
+                                     size_t meshPlanesBytes) {
+    ChunkRenderData rd = createChunkRenderData(chunkVertices, chunkRanges);
+    ChunkRenderData rdt = createChunkRenderData(transparentVertices, transparentRanges);
+    const int numVerticesPerQuad = chunkVertexLayout == EChunkVertexLayout::IndexedQuads? 4 : 6;
+    std::vector<float3>& transparentCentroids = ChunkMesher::getThreadScratch().transparentCentroids;
+    TransparentQuadSorter::findQuadCentroids(transparentVertices, numVerticesPerQuad, transparentCentroids);
+    {
+        std::lock_guard<std::mutex> guard(cachedChunkRDMutex);
         
-        for(int i=0; i<waterQuads.size(); i++) {
-            const Quad& q = waterQuads[i];
-            
-            if(!voxelTypeAtlasIndexMap.contains(q.vxType)) {
-                continue;
-            }
-            
-            // rely on correct vertex-ordering for texture orientation,
-            // as we treat these uv coords as a front-face for all faces.
-            
-            const VoxelAtlasEntry& atlasEntry = voxelTypeAtlasIndexMap[q.vxType];
-            int atlasIndex = -1;
-            
-            if(q.normal.x == 1.0f) {
-                atlasIndex = atlasEntry.right;
-            }
-            else if(q.normal.x == -1.0f) {
-                atlasIndex = atlasEntry.left;
+        // unloaded while we were meshing it, unloadChunk has already cleaned up after it. Or edited: the mesh
+        // editVoxel stored (or the full mesh the chunk is still queued for) is newer than this one
+        if(!loadedChunks.contains(chunkIndex) || getChunkEditGeneration(chunkIndex) != editGeneration) {
+            if(rd.buffer) {
+                rd.buffer->release();
             }
-            else if(q.normal.y == 1.0f) {
-                atlasIndex = atlasEntry.top;
+            if(rdt.buffer) {
+                rdt.buffer->release();
             }
-            else if(q.normal.y == -1.0f) {
-                atlasIndex = atlasEntry.bottom;
-            }
-            else if(q.normal.z == 1.0f) {
-                atlasIndex = atlasEntry.front;
+            return;
+        }
+        
+        // replaces the chunk's previous buffers, if it was meshed before (e.g. re-meshed after an edit)
+        auto replaceCached = [&chunkIndex](std::map<Int3D, ChunkRenderData>& cache, const ChunkRenderData& renderData) {
+            auto it = cache.find(chunkIndex);
+            if(it != cache.end()) {
+                if(it->second.buffer) {
+                    it->second.buffer->release();
+                }
+                cache.erase(it);
             }
-            else if(q.normal.z == -1.0f) {
-                atlasIndex = atlasEntry.back;
+            if(renderData.buffer) {
+                cache.insert({chunkIndex, renderData});
             }
-            
-            
-            transparentVertices.push_back({q.positions[0], {0.0, 0.0}, q.normal, atlasIndex, defaultColorScale });
-            transparentVertices.push_back({q.positions[1], {q.width, 0.0}, q.normal, atlasIndex, defaultColorScale });
-            transparentVertices.push_back({q.positions[2], {q.width, q.height}, q.normal, atlasIndex, defaultColorScale });
-            
-            transparentVertices.push_back({q.positions[2], {q.width, q.height}, q.normal, atlasIndex, defaultColorScale });
-            transparentVertices.push_back({q.positions[3], {0.0, q.height}, q.normal, atlasIndex, defaultColorScale });
-            transparentVertices.push_back({q.positions[0], {0.0, 0.0}, q.normal, atlasIndex, defaultColorScale });
-        }
-        
-        // invidiual voxels (voxels that shouldn't be merged, e.g. light blocks)
-        // essentially non-terrain voxels, or more complex voxels that have their own attributes
-        
-        // Cube for use in a right-handed coordinate system with triangle faces
-        // specified with a Counter-Clockwise winding order.
-        
-        const float3 fwd {0,0,1};
-        const float3 top {0,1,0};
-        const float3 right {1,0,0};
-        std::vector<VertexData> cubeVertTemplate = {
-            // Front face
-            {{-0.5, -0.5, 0.5, 1.0}, {0.0, 0.0}, fwd},
-            {{0.5, -0.5, 0.5, 1.0}, {1.0, 0.0}, fwd},
-            {{0.5, 0.5, 0.5, 1.0}, {1.0, 1.0}, fwd},
-            {{0.5, 0.5, 0.5, 1.0}, {1.0, 1.0}, fwd},
-            {{-0.5, 0.5, 0.5, 1.0}, {0.0, 1.0}, fwd},
-            {{-0.5, -0.5, 0.5, 1.0}, {0.0, 0.0}, fwd},
-
-            // Back face
-            {{0.5, -0.5, -0.5, 1.0}, {0.0, 0.0}, -fwd},
-            {{-0.5, -0.5, -0.5, 1.0}, {1.0, 0.0}, -fwd},
-            {{-0.5, 0.5, -0.5, 1.0}, {1.0, 1.0}, -fwd},
-            {{-0.5, 0.5, -0.5, 1.0}, {1.0, 1.0}, -fwd},
-            {{0.5, 0.5, -0.5, 1.0}, {0.0, 1.0}, -fwd},
-            {{0.5, -0.5, -0.5, 1.0}, {0.0, 0.0}, -fwd},
-
-            // Top face
-            {{-0.5, 0.5, 0.5, 1.0}, {0.0, 0.0}, top},
-            {{0.5, 0.5, 0.5, 1.0}, {1.0, 0.0}, top},
-            {{0.5, 0.5, -0.5, 1.0}, {1.0, 1.0}, top},
-            {{0.5, 0.5, -0.5, 1.0}, {1.0, 1.0}, top},
-            {{-0.5, 0.5, -0.5, 1.0}, {0.0, 1.0}, top},
-            {{-0.5, 0.5, 0.5, 1.0}, {0.0, 0.0}, top},
-
-            // Bottom face
-            {{-0.5, -0.5, -0.5, 1.0}, {0.0, 0.0}, -top},
-            {{0.5, -0.5, -0.5, 1.0}, {1.0, 0.0}, -top},
-            {{0.5, -0.5, 0.5, 1.0}, {1.0, 1.0}, -top},
-            {{0.5, -0.5, 0.5, 1.0}, {1.0, 1.0}, -top},
-            {{-0.5, -0.5, 0.5, 1.0}, {0.0, 1.0}, -top},
-            {{-0.5, -0.5, -0.5, 1.0}, {0.0, 0.0}, -top},
-
-            // Left face
-            {{-0.5, -0.5, -0.5, 1.0}, {0.0, 0.0}, -right},
-            {{-0.5, -0.5, 0.5, 1.0}, {1.0, 0.0}, -right},
-            {{-0.5, 0.5, 0.5, 1.0}, {1.0, 1.0}, -right},
-            {{-0.5, 0.5, 0.5, 1.0}, {1.0, 1.0}, -right},
-            {{-0.5, 0.5, -0.5, 1.0}, {0.0, 1.0}, -right},
-            {{-0.5, -0.5, -0.5, 1.0}, {0.0, 0.0}, -right},
-
-            // Right face
-            {{0.5, -0.5, 0.5, 1.0}, {0.0, 0.0}, right},
-            {{0.5, -0.5, -0.5, 1.0}, {1.0, 0.0}, right},
-            {{0.5, 0.5, -0.5, 1.0}, {1.0, 1.0}, right},
-            {{0.5, 0.5, -0.5, 1.0}, {1.0, 1.0}, right},
-            {{0.5, 0.5, 0.5, 1.0}, {0.0, 1.0}, right},
-            {{0.5, -0.5, 0.5, 1.0}, {0.0, 0.0}, right},
         };
+        replaceCached(ChunkRenderer::cachedChunkBuffers, rd);
+        replaceCached(ChunkRenderer::cachedTransparentChunkBuffers, rdt);
         
-        const VoxelAtlasEntry& lampEntry = voxelTypeAtlasIndexMap[EVoxelType::Lamp];
-        for(auto [coord, color] : chunk->getVoxelLightColorMap()) {
-            std::vector<VertexData> voxelVerts = cubeVertTemplate;
-            
-            float3 localOffset = coord.to_float3() + make_float3(0.5, 0.5, 0.5);
-            
-            float4 offset = chunk->getPositionAsFloat4() + make_float4(localOffset.x, localOffset.y, localOffset.z, 0.0f);
-            for(auto& vd : voxelVerts) {
-                // to WS position
-                vd.position = matrix4x4_translation(offset.x, offset.y, offset.z) * vd.position;
-                vd.atlasIndex = lampEntry.right; // all the same, anyway
-                vd.colorScale = color;
+        size_t chunkBytes = 0;
+        {
+            // (swapped in with the buffers, so no edit lands in between. The main thread edits the voxels
+            // and rects meanwhile, they're read under their locks)
+            std::lock_guard<std::mutex> collisionGuard(chunkCollisionMutex);
+            if(collisionRects != nullptr) {
+                chunk.setCollisionRects(std::move(*collisionRects));
             }
-            
-            chunkVertices.insert(chunkVertices.end(), voxelVerts.begin(), voxelVerts.end());
+            std::shared_lock<std::shared_mutex> voxelsLock(chunk.getVoxelsMutex());
+            chunkBytes = chunk.getMemoryUsage().getTotal() + meshPlanesBytes
+                       + sizeof(VertexData) * (chunkVertices.size() + transparentVertices.size());
         }
         
+        const float3 aabbMin = chunk.getPositionAsFloat3();
+        transparentQuadSorter.setChunkQuads(chunkIndex, aabbMin, aabbMin + chunk.getDimensions().to_float3(), transparentCentroids);
         
+        // (its lower level of detail mesh, if any, is replaced separately by meshChunkLOD)
+        auto lodIt = ChunkRenderer::cachedChunkLODBuffers.find(chunkIndex);
+        const size_t lodBytes = lodIt != ChunkRenderer::cachedChunkLODBuffers.end()? getLODBytes(lodIt->second) : 0;
+        if(size_t* bytes = chunkMemoryUsage.find(chunkIndex)) {
+            *bytes = chunkBytes + lodBytes;
+        }
+        else {
+            chunkMemoryUsage.insert(chunkIndex, chunkBytes + lodBytes);
+        }
     }
+}
 
+uint32_t MTLEngine::getChunkEditGeneration(const Int3D& chunkIndex) const {
+    const uint32_t* generation = chunkEditGenerations.find(chunkIndex);
+    return generation != nullptr? *generation : 0;
+}
+
+int MTLEngine::getChunkLOD(const Int3D& chunkIndex) const {
+    const int distance = ChunkEvictionPolicy::chunkDistance(curChunk, chunkIndex);
+    int lod = 0;
+    while(lod < ChunkMesher::maxLOD && distance >= chunkLODDistances[lod]) {
+        lod++;
+    }
+    return lod;
+}
+
+void MTLEngine::meshChunkLOD(const Int3D& chunkIndex, const Chunk& chunk, const ChunkMeshNeighbors& neighbors, int lod,
+                             uint32_t editGeneration) {
+    if(lod == 0) {
+        return;
+    }
     
-    ChunkRenderData rd;
-    rd.buffer = chunkVertices.size() > 0? metalDevice->newBuffer(chunkVertices.data(), sizeof(VertexData) * chunkVertices.size(), MTL::ResourceStorageModeShared) : 0;
-    rd.numVertices = (int) chunkVertices.size();
+    // (any full detail mesh of this thread is stored by now, its scratch buffers are free)
+    ChunkMeshScratch& scratch = ChunkMesher::getThreadScratch();
+    ChunkMeshQuads& quads = scratch.quads;
+    quads.clear();
+    {
+        ChunkMeshVoxelLocks voxelLocks = lockMeshVoxels(chunk, neighbors);
+        ChunkMesher::meshLOD(chunk, neighbors, lod, quads);
+    }
+    
+    // grouped by face direction, like buildChunkVertices (the lamps are too small to be seen that far)
+    std::vector<VertexData>& vertices = scratch.chunkVertices;
+    std::vector<VertexData>& transparentVertices = scratch.transparentVertices;
+    vertices.clear();
+    transparentVertices.clear();
+    ChunkFaceRanges ranges;
+    ChunkFaceRanges transparentRanges;
+    for(int direction = 0; direction < numChunkFaceDirections; direction++) {
+        ranges.offsets[direction] = (int) vertices.size();
+        transparentRanges.offsets[direction] = (int) transparentVertices.size();
+        ChunkMesher::writeVerticesFacing(quads.opaque, direction, voxelTypeAtlasIndexMap, chunkVertexLayout, vertices);
+        ChunkMesher::writeVerticesFacing(quads.water, direction, voxelTypeAtlasIndexMap, chunkVertexLayout, transparentVertices);
+    }
+    ranges.offsets[numChunkFaceDirections] = (int) vertices.size();
+    transparentRanges.offsets[numChunkFaceDirections] = (int) transparentVertices.size();
+    
+    ChunkLODRenderData lodRD;
+    lodRD.lod = lod;
+    lodRD.opaque = createChunkRenderData(vertices, ranges);
+    lodRD.transparent = createChunkRenderData(transparentVertices, transparentRanges);
+    
+    std::lock_guard<std::mutex> guard(cachedChunkRDMutex);
+    
+    // unloaded while we were meshing it
+    if(!loadedChunks.contains(chunkIndex)) {
+        lodRD.releaseBuffers();
+        return;
+    }
+    
+    // edited while we were meshing it, editVoxel rebuilt the lod it's drawn with. One that's still requested
+    // is built again from the edited voxels
+    if(getChunkEditGeneration(chunkIndex) != editGeneration) {
+        lodRD.releaseBuffers();
+        if(requestedChunkLODs.contains(chunkIndex)) {
+            chunksToMeshLOD.enqueue(chunkIndex);
+        }
+        return;
+    }
+    
+    if(const int* requested = requestedChunkLODs.find(chunkIndex)) {
+        // the chunk moved to another ring while we were meshing it, it's built again at the new lod
+        // (requestChunkLOD doesn't queue a chunk that's still requested)
+        if(*requested != lod) {
+            lodRD.releaseBuffers();
+            chunksToMeshLOD.enqueue(chunkIndex);
+            return;
+        }
+        requestedChunkLODs.erase(chunkIndex);
+    }
+    
+    size_t replacedBytes = 0;
+    auto it = ChunkRenderer::cachedChunkLODBuffers.find(chunkIndex);
+    if(it != ChunkRenderer::cachedChunkLODBuffers.end()) {
+        replacedBytes = getLODBytes(it->second);
+        it->second.releaseBuffers();
+        it->second = lodRD;
+    }
+    else {
+        ChunkRenderer::cachedChunkLODBuffers.insert({chunkIndex, lodRD});
+    }
+    
+    if(size_t* bytes = chunkMemoryUsage.find(chunkIndex)) {
+        *bytes = *bytes - replacedBytes + getLODBytes(lodRD);
+    }
+}
+
+void MTLEngine::meshRequestedChunkLOD(const Int3D& chunkIndex) {
+    int lod = 0;
+    uint32_t editGeneration = 0;
+    {
+        // (not requested anymore if it was built along with a full mesh, or unloaded, since it was queued)
+        std::lock_guard<std::mutex> guard(cachedChunkRDMutex);
+        const int* requested = requestedChunkLODs.find(chunkIndex);
+        if(requested == nullptr) {
+            return;
+        }
+        lod = *requested;
+        editGeneration = getChunkEditGeneration(chunkIndex);
+    }
+    
+    ChunkHandle chunkHandle = loadedChunks.find(chunkIndex);
+    if(chunkHandle == nullptr) {
+        return;
+    }
+    std::array<ChunkHandle, 6> neighborHandles;
+    const ChunkMeshNeighbors neighbors = findMeshNeighbors(chunkIndex, neighborHandles);
+    meshChunkLOD(chunkIndex, *chunkHandle, neighbors, lod, editGeneration);
+}
+
+void MTLEngine::requestChunkLOD(const Int3D& chunkIndex, int lod) {
+    if(int* requested = requestedChunkLODs.find(chunkIndex)) {
+        // still queued, or the worker meshing it at the previous lod queues it again
+        *requested = lod;
+        return;
+    }
+    requestedChunkLODs.insert(chunkIndex, lod);
+    chunksToMeshLOD.enqueue(chunkIndex);
+}
+
+void MTLEngine::releaseChunkLOD(const Int3D& chunkIndex) {
+    requestedChunkLODs.erase(chunkIndex);
     
-    ChunkRenderData rdt;
-    rdt.buffer = transparentVertices.size() > 0? metalDevice->newBuffer(transparentVertices.data(), sizeof(VertexData) * transparentVertices.size(), MTL::ResourceStorageModeShared) : nullptr;
-    rdt.numVertices = (int) transparentVertices.size();
+    auto it = ChunkRenderer::cachedChunkLODBuffers.find(chunkIndex);
+    if(it == ChunkRenderer::cachedChunkLODBuffers.end()) {
+        return;
+    }
+    if(size_t* bytes = chunkMemoryUsage.find(chunkIndex)) {
+        *bytes -= getLODBytes(it->second);
+    }
+    it->second.releaseBuffers();
+    ChunkRenderer::cachedChunkLODBuffers.erase(it);
+}
+
+bool MTLEngine::editVoxel(const Int3D& chunkIndex, const Int3D& coords, EVoxelType type) {
+    ChunkHandle chunk = loadedChunks.find(chunkIndex);
+    if(chunk == nullptr) {
+        return false;
+    }
+    // (only this thread writes the voxels of loaded chunks, it reads them without locking)
+    if(chunk->getVoxel(coords) == type) {
+        return true;
+    }
+    {
+        // waits only for the meshers reading this chunk's voxels right now
+        std::unique_lock<std::shared_mutex> voxelsLock(chunk->getVoxelsMutex());
+        chunk->setVoxel(coords, type);
+    }
+    
+    ChunkMeshDirtyPlanes dirtyPlanes;
+    std::array<ChunkMeshDirtyPlanes, 6> neighborDirtyPlanes;
+    ChunkMeshDirtyPlanes::markVoxelEdit(chunk->getDimensions(), coords, dirtyPlanes, neighborDirtyPlanes,
+                                        chunkMesher == EChunkMesher::BakedAO);
+    
+    const auto neighborInds = chunkIndex.getAllNeighbors();
     {
+        // bumped after the voxel is set: a mesher that read the generation before this may have read the voxels
+        // before the edit, its mesh is dropped when it's stored. One that reads it after sees the edit
         std::lock_guard<std::mutex> guard(cachedChunkRDMutex);
-        if(chunkVertices.size() > 0) {
-            ChunkRenderer::cachedChunkBuffers.insert({chunkIndex, rd});
+        auto bumpEditGeneration = [this](const Int3D& index) {
+            if(uint32_t* generation = chunkEditGenerations.find(index)) {
+                (*generation)++;
+            }
+            else {
+                chunkEditGenerations.insert(index, 1);
+            }
+        };
+        bumpEditGeneration(chunkIndex);
+        for(int i = 0; i < (int) neighborInds.size(); i++) {
+            if(neighborDirtyPlanes[i].isDirty()) {
+                bumpEditGeneration(neighborInds[i]);
+            }
         }
-        if(transparentVertices.size() > 0) {
-            ChunkRenderer::cachedTransparentChunkBuffers.insert({chunkIndex, rdt});
+    }
+    
+    remeshEditedChunk(chunkIndex, dirtyPlanes);
+    
+    for(int i = 0; i < (int) neighborInds.size(); i++) {
+        if(neighborDirtyPlanes[i].isDirty()) {
+            remeshEditedChunk(neighborInds[i], neighborDirtyPlanes[i]);
         }
-        
     }
+    return true;
 }
 
+void MTLEngine::remeshEditedChunk(const Int3D& chunkIndex, const ChunkMeshDirtyPlanes& dirtyPlanes) {
+    ChunkHandle chunkHandle = loadedChunks.find(chunkIndex);
+    if(chunkHandle == nullptr) {
+        return;
+    }
+    
+    // (a full mesh a worker starts meanwhile erases the planes from editedChunkMeshes, our handle keeps them
+    // alive until we're done with them)
+    std::shared_ptr<ChunkMeshPlanes> planes;
+    bool isFirstEdit = false;
+    int lod = 0;
+    uint32_t editGeneration = 0;
+    {
+        std::lock_guard<std::mutex> guard(cachedChunkRDMutex);
+        // not meshed yet, its queued full mesh will pick up the edit. A chunk a worker is meshing is meshed
+        // here as well: the worker's mesh is dropped if it read the voxels before the edit
+        if(!meshedChunks.contains(chunkIndex)) {
+            return;
+        }
+        std::shared_ptr<ChunkMeshPlanes>& editedPlanes = editedChunkMeshes[chunkIndex];
+        isFirstEdit = editedPlanes == nullptr;
+        if(isFirstEdit) {
+            editedPlanes = std::make_shared<ChunkMeshPlanes>();
+        }
+        planes = editedPlanes;
+        
+        auto lodIt = ChunkRenderer::cachedChunkLODBuffers.find(chunkIndex);
+        lod = lodIt != ChunkRenderer::cachedChunkLODBuffers.end()? lodIt->second.lod : 0;
+        
+        // (only this thread bumps it, the mesh stored below is never dropped)
+        editGeneration = getChunkEditGeneration(chunkIndex);
+    }
+    
+    Chunk& chunk = *chunkHandle;
+    std::array<ChunkHandle, 6> neighborHandles;
+    const ChunkMeshNeighbors neighbors = findMeshNeighbors(chunkIndex, neighborHandles);
+    
+    if(isFirstEdit) {
+        // first edit since the chunk was meshed: split its whole mesh into planes once (the chunk's
+        // collision rects are rebuilt to match), later edits only re-mesh the planes they touch
+        ChunkMesher::meshPlanes(chunk, neighbors, *planes, chunkMesher == EChunkMesher::BakedAO);
+        
+        std::vector<std::unique_ptr<CollisionRect>> collisionRects;
+        for(const std::vector<ChunkMeshQuads>& axisPlanes : planes->planes) {
+            for(const ChunkMeshQuads& plane : axisPlanes) {
+                addCollisionRects(chunk, plane.opaque, collisionRects);
+            }
+        }
+        std::lock_guard<std::mutex> collisionGuard(chunkCollisionMutex);
+        chunk.setCollisionRects(std::move(collisionRects));
+    }
+    else {
+        ChunkMesher::remeshDirtyPlanes(chunk, neighbors, dirtyPlanes, *planes, chunkMesher == EChunkMesher::BakedAO);
+        
+        const EAxis axes[3] = {EAxis::X, EAxis::Y, EAxis::Z};
+        std::vector<std::unique_ptr<CollisionRect>> collisionRects;
+        for(int d = 0; d < 3; d++) {
+            for(int p = 0; p < (int) planes->planes[d].size(); p++) {
+                if(dirtyPlanes.isPlaneDirty(d, p)) {
+                    addCollisionRects(chunk, planes->planes[d][p].opaque, collisionRects);
+                }
+            }
+        }
+        std::lock_guard<std::mutex> collisionGuard(chunkCollisionMutex);
+        for(int d = 0; d < 3; d++) {
+            for(int p = 0; p < (int) planes->planes[d].size(); p++) {
+                if(dirtyPlanes.isPlaneDirty(d, p)) {
+                    chunk.removeCollisionRectsOnPlane(axes[d], p);
+                }
+            }
+        }
+        for(std::unique_ptr<CollisionRect>& rect : collisionRects) {
+            chunk.addCollisionRect(std::move(rect));
+        }
+    }
+    
+    // the vertex buffers are rebuilt from the spliced quads
+    ChunkMeshScratch& scratch = ChunkMesher::getThreadScratch();
+    ChunkMeshQuads& quads = scratch.quads;
+    quads.clear();
+    planes->gatherQuads(quads);
+    
+    std::vector<VertexData>& chunkVertices = scratch.chunkVertices;
+    std::vector<VertexData>& transparentVertices = scratch.transparentVertices;
+    chunkVertices.clear();
+    transparentVertices.clear();
+    ChunkFaceRanges chunkRanges;
+    ChunkFaceRanges transparentRanges;
+    buildChunkVertices(chunk, quads, chunkVertices, transparentVertices, chunkRanges, transparentRanges);
+    storeChunkRenderData(chunkIndex, chunk, chunkVertices, transparentVertices, chunkRanges, transparentRanges,
+                         editGeneration, nullptr, sizeof(ChunkMeshQuad) * (quads.opaque.size() + quads.water.size()));
+    meshChunkLOD(chunkIndex, chunk, neighbors, lod, editGeneration);
+}
+
+void MTLEngine::digVoxelInView() {
+    const float3 origin = camera.getPosition();
+    const float3 direction = camera.getForwardVector();
+    const float step = 0.1f;
+    for(float t = 0.0f; t <= digReach; t += step) {
+        const float3 p = origin + t * direction;
+        const Int3D voxel((int) std::floor(p.x), (int) std::floor(p.y), (int) std::floor(p.z));
+        const Int3D chunkIndex((int) std::floor(float(voxel.x) / chunkDims.x),
+                               (int) std::floor(float(voxel.y) / chunkDims.y),
+                               (int) std::floor(float(voxel.z) / chunkDims.z));
+        ChunkHandle chunk = loadedChunks.find(chunkIndex);
+        if(chunk == nullptr) {
+            return;
+        }
+        
+        const Int3D coords = voxel - chunkIndex * chunkDims;
+        const EVoxelType type = chunk->getVoxel(coords);
+        if(type == EVoxelType::None || type == EVoxelType::Water) {
+            continue;
+        }
+        // (a lamp's light isn't removed with its voxel)
+        if(type != EVoxelType::Lamp) {
+            editVoxel(chunkIndex, coords, EVoxelType::None);
+        }
+        return;
+    }
+}
 
 void MTLEngine::initChunkRenderers() {
     // chunkRenderers is a 2D array, with each dimension == (2 * renderDistance + 1)
     // (imagine renderDistance as a radius, radiating from the chunk the player is currently inside)
     //
-    // Currently, render distance only applies to the XZ plane (because world generation only happens in the
-    // XZ plane chunk-wise) In the future, Y may be included
-    
-    chunkRenderers.clear();
+    // Each column holds a renderer for every level of the world, so moving up or down never
+    // touches the grid, only which levels are drawn (verticalRenderDistance)
     
     // TODO: depends on player's start position
-    const int2 startXZ = {0,0};
+    const int numChunkLevels = worldMaxChunkY - worldMinChunkY + 1;
+    chunkRenderers = ToroidalGrid<std::vector<std::shared_ptr<ChunkRenderer>>>(renderDistance);
+    chunkRenderers.forEach([numChunkLevels](const Int3D& index, std::vector<std::shared_ptr<ChunkRenderer>>& renderers) {
+        renderers.clear();
+        for(int i = 0; i < numChunkLevels; i++) {
+            renderers.push_back(std::make_shared<ChunkRenderer>());
+        }
+    });
     
+    // the visible chunks are always the same box around curChunk, so sort it by distance once
+    sortedVisibleChunkOffsets.clear();
     for(int x = -renderDistance; x <= renderDistance; x++) {
-        for(int z = -renderDistance; z <= renderDistance; z++) {
-            std::shared_ptr<ChunkRenderer> cr = std::make_shared<ChunkRenderer>();
-            
-            Int3D key(x, 0, z);
-            chunkRenderers.insert({key, cr});
+        for(int y = -verticalRenderDistance; y <= verticalRenderDistance; y++) {
+            for(int z = -renderDistance; z <= renderDistance; z++) {
+                sortedVisibleChunkOffsets.push_back(Int3D(x, y, z));
+            }
         }
     }
+    
+    const float3 origin = make_float3(0, 0, 0);
+    std::sort(sortedVisibleChunkOffsets.begin(), sortedVisibleChunkOffsets.end(), [&origin](const Int3D& a, const Int3D& b) {
+        return distance(origin, a.to_float3()) > distance(origin, b.to_float3());
+    });
 }
 
 void MTLEngine::initCascadingShadowMaps() {
@@ -2046,6 +2281,10 @@ void MTLEngine::createBuffers() {
     
     renderStateUB = metalDevice->newBuffer(sizeof(RenderState), MTL::ResourceStorageModeShared);
     
+    // shared by every IndexedQuads chunk buffer. A chunk can't have more quads than 6 per voxel
+    // (lamps are 6 quads per voxel, terrain faces at most one per side)
+    ChunkRenderer::createQuadIndexBuffer(metalDevice, 6 * chunkDims.x * chunkDims.y * chunkDims.z);
+    
     // uniform for each shadow map transform
     for(int i = 0; i < shadowLayerInfos.size(); i++) {
         shadowCameraUBs.push_back(
@@ -2549,7 +2788,7 @@ void MTLEngine::draw() {
         rce->setFragmentTexture(atlasTexture->texture, 0);
         rce->setVertexBuffer(cameraUB, 0, 1);
         
-        drawChunkGeometry(rce);
+        drawChunkGeometry(rce, true);
     
         rce->endEncoding();
     }
@@ -2829,6 +3068,23 @@ void MTLEngine::draw() {
             
             ImGui::Text("Chunks left to mesh: %d", (int) chunksToMesh.size_approx());
             ImGui::Text("Chunks left to generate: %d", (int) chunksToGenerate.size_approx());
+            if(terrainGenerator == ETerrainGenerator::CoarseLattice && measureTerrainLatticeError) {
+                std::lock_guard<std::mutex> guard(terrainLatticeErrorMutex);
+                const TerrainLatticeError& error = terrainLatticeError;
+                ImGui::Text("Lattice noise error: mean %.4f, max %.4f, voxels differing %.3f%%",
+                            error.numVoxels > 0? error.sumNoiseError / error.numVoxels : 0.0, error.maxNoiseError,
+                            error.numVoxels > 0? 100.0 * error.numDifferingVoxels / error.numVoxels : 0.0);
+            }
+            {
+                size_t loadedChunkBytes = 0;
+                {
+                    std::lock_guard<std::mutex> guard(cachedChunkRDMutex);
+                    chunkMemoryUsage.forEach([&loadedChunkBytes](const Int3D& index, size_t bytes) {
+                        loadedChunkBytes += bytes;
+                    });
+                }
+                ImGui::Text("Loaded chunks: %d (%.1f MB)", (int) loadedChunks.size(), loadedChunkBytes / (1024.0 * 1024.0));
+            }
 
             ImGui::Text("Collisions: %d", numCollisions);
             ImGui::Text("Visible Lines: %d", (int) visibleLines.size());
@@ -2881,38 +3137,80 @@ void MTLEngine::draw() {
     imguiRenderPassDescriptor->release();
 }
 
-void MTLEngine::drawChunkGeometry(MTL::RenderCommandEncoder* renderCommandEncoder) {
-    std::lock_guard<std::mutex> lcGuard(loadedChunksMutex);
+void MTLEngine::drawChunkGeometry(MTL::RenderCommandEncoder* renderCommandEncoder, bool cullFaceDirections) {
+    // grab handles to every visible chunk up front, the chunk table isn't locked while drawing
+    // (chunks that aren't loaded yet, e.g. a level the player just moved to, are skipped)
+    std::vector<ChunkHandle> visibleChunks;
+    visibleChunks.reserve(sortedVisibleChunks.size());
     for(const Int3D& xyz : sortedVisibleChunks) {
-	if(!loadedChunks.contains(xyz)) {
-	    return;
-	}
+        ChunkHandle chunk = loadedChunks.find(xyz);
+        if(chunk != nullptr) {
+            chunk->markAccessed(frameIndex);
+        }
+        visibleChunks.push_back(std::move(chunk));
     }
+    
+    auto rendererAt = [this](const Int3D& xyz)->ChunkRenderer& {
+        return *chunkRenderers.at(xyz)[xyz.y - worldMinChunkY];
+    };
+    
+    auto visibleDirectionsOf = [this, cullFaceDirections](const Chunk& chunk) {
+        if(!cullFaceDirections) {
+            return allChunkFaceDirections;
+        }
+        const float3 aabbMin = chunk.getPositionAsFloat3();
+        return findVisibleFaceDirections(camera.getPosition(), aabbMin, aabbMin + chunkDims.to_float3());
+    };
 
-    for(const Int3D& xyz : sortedVisibleChunks) {
-	if(!loadedChunks.contains(xyz)) {
-	    return;
-	}
-
-        if(!ChunkRenderer::cachedChunkBuffers.contains(xyz)) {
+    for(int i = 0; i < (int) sortedVisibleChunks.size(); i++) {
+        const Int3D& xyz = sortedVisibleChunks[i];
+        // (the buffer caches are written by the meshing threads, they're only read under the lock)
+        std::lock_guard<std::mutex> rdGuard(cachedChunkRDMutex);
+        if(visibleChunks[i] == nullptr || !ChunkRenderer::cachedChunkBuffers.contains(xyz)) {
             // std::cout << fmt::format("render has no loaded chunk at: {}", DebugUtils::stringify_tupleInt3(xyz)) << std::endl;
             continue;
         }
-        const Chunk& chunk = loadedChunks.at(xyz);
+        const Chunk& chunk = *visibleChunks[i];
         // std::cout << fmt::format("rendering: {},{},{}", get<0>(xyz), get<1>(xyz), get<2>(xyz)) << std::endl;
-        std::lock_guard<std::mutex> rdGuard(cachedChunkRDMutex);
-        chunkRenderers[xyz]->render(chunk, renderCommandEncoder, metalDevice, 0);
+        // far chunks are drawn with their lower level of detail mesh, once it's built for their ring
+        // (until then at full detail). Chunks back within the first ring drop theirs
+        const int lod = getChunkLOD(xyz);
+        if(lod > 0 && ChunkRenderer::renderLOD(xyz, renderCommandEncoder, lod, false, visibleDirectionsOf(chunk))) {
+            continue;
+        }
+        if(lod > 0) {
+            requestChunkLOD(xyz, lod);
+        }
+        else {
+            releaseChunkLOD(xyz);
+        }
+        rendererAt(xyz).render(chunk, renderCommandEncoder, metalDevice, 0, visibleDirectionsOf(chunk));
     }
      
-    for (const Int3D& xyz : sortedVisibleChunks) {
-        if(!ChunkRenderer::cachedChunkBuffers.contains(xyz)) {
+    for(int i = 0; i < (int) sortedVisibleChunks.size(); i++) {
+        const Int3D& xyz = sortedVisibleChunks[i];
+        std::lock_guard<std::mutex> rdGuard(cachedChunkRDMutex);
+        // (gated on the transparent buffers alone, a chunk with nothing but water has no opaque ones)
+        if(visibleChunks[i] == nullptr || !ChunkRenderer::cachedTransparentChunkBuffers.contains(xyz)) {
             // std::cout << fmt::format("render has no loaded chunk at: {}", DebugUtils::stringify_tupleInt3(xyz)) << std::endl;
             continue;
         }
-        const Chunk& chunk = loadedChunks.at(xyz);
+        const Chunk& chunk = *visibleChunks[i];
         // std::cout << fmt::format("rendering: {},{},{}", get<0>(xyz), get<1>(xyz), get<2>(xyz)) << std::endl;
-        std::lock_guard<std::mutex> rdGuard(cachedChunkRDMutex);
-        chunkRenderers[xyz]->renderTransparent(chunk, renderCommandEncoder);
+        const int lod = getChunkLOD(xyz);
+        if(lod > 0 && ChunkRenderer::renderLOD(xyz, renderCommandEncoder, lod, true, visibleDirectionsOf(chunk))) {
+            continue;
+        }
+        
+        // the chunk's own quads back to front too, only re-sorted when the camera changed region around it (or it was re-meshed)
+        if(transparentQuadSorter.sortChunk(xyz, camera.getPosition())) {
+            sortedTransparentIndices.clear();
+            ChunkMesher::writeSortedQuadIndices(*transparentQuadSorter.getSortedQuads(xyz), chunkVertexLayout, sortedTransparentIndices);
+            ChunkRenderer::writeSortedTransparentIndices(metalDevice, xyz, sortedTransparentIndices);
+        }
+        auto sortedIt = ChunkRenderer::sortedTransparentIndices.find(xyz);
+        const ChunkSortedIndices* sortedIndices = sortedIt != ChunkRenderer::sortedTransparentIndices.end()? &sortedIt->second : nullptr;
+        rendererAt(xyz).renderTransparent(chunk, renderCommandEncoder, visibleDirectionsOf(chunk), sortedIndices);
     }
 }
 
@@ -3030,6 +3328,12 @@ void MTLEngine::keyTick(const float deltaTime) {
         spaceWasDown = false;
     }
     
+    // one voxel per press
+    if(isKeyDown(EKey::Down) && !digWasDown) {
+        digVoxelInView();
+    }
+    digWasDown = isKeyDown(EKey::Down);
+    
     if(isKeyDown(EKey::Escape) && captureMouse) {
         glfwSetInputMode(glfwWindow, GLFW_CURSOR, GLFW_CURSOR_NORMAL);
         captureMouse = false;
@@ -3078,6 +3382,8 @@ void MTLEngine::mouseTick(const float deltaTime) {
 }
 
 void MTLEngine::engineTick(const float deltaTime) {
+    frameIndex++;
+    
     keyTick(deltaTime);
     mouseTick(deltaTime);
     
@@ -3098,6 +3404,10 @@ void MTLEngine::engineTick(const float deltaTime) {
         resolveChunkGeneration();
     }
     
+    if(prevChunk != curChunk || frameIndex % chunkEvictionInterval == 0) {
+        evictChunks();
+    }
+    
     if(enableShadowMap) {
         float zStart = 0.0f;
         for(int i = 0; i < shadowLayerInfos.size(); i++) {
@@ -3134,21 +3444,28 @@ void MTLEngine::engineTick(const float deltaTime) {
 }
 
 void MTLEngine::physicsTick(const float deltaTime) {
-    if(!loadedChunks.contains(curChunk)) {
+    ChunkHandle curChunkHandle = loadedChunks.find(curChunk);
+    if(curChunkHandle == nullptr) {
         return;
     }
     
     const AABB& playerCollision = player->getCollision();
     bool collides = false;
     
+    // the handles keep the queried chunks alive for the rest of the tick
+    std::vector<ChunkHandle> chunkHandles;
     std::vector<Chunk*> chunksToQuery;
-    std::array<Int3D, 4> neighbors = curChunk.getNeighbors();
+    std::array<Int3D, 6> neighbors = curChunk.getAllNeighbors();
     
-    chunksToQuery.push_back(&loadedChunks.at(curChunk));
+    chunkHandles.push_back(curChunkHandle);
+    chunksToQuery.push_back(curChunkHandle.get());
+    curChunkHandle->markAccessed(frameIndex);
     
     for(const Int3D& n : neighbors) {
-        if(loadedChunks.contains(n)) {
-            chunksToQuery.push_back(&loadedChunks.at(n));
+        if(ChunkHandle neighbor = loadedChunks.find(n)) {
+            neighbor->markAccessed(frameIndex);
+            chunksToQuery.push_back(neighbor.get());
+            chunkHandles.push_back(std::move(neighbor));
         }
     }
     
@@ -3161,6 +3478,8 @@ void MTLEngine::physicsTick(const float deltaTime) {
     
     std::vector<CollisionData> entitiesCollidedWith;
     
+    // the mesh workers replace the rects of re-meshed chunks, keep them from doing it while we're using them
+    std::lock_guard<std::mutex> collisionGuard(chunkCollisionMutex);
     for(Chunk* chunk : chunksToQuery) {
         std::vector<CollisionEntity*> collisionEntities;
         chunk->resetLineColors();
@@ -3369,116 +3688,118 @@ void MTLEngine::updateUniforms() {
 
 void MTLEngine::updateVisibleChunkIndices() {
     // std::cout << fmt::format("curChunk: {}", DebugUtils::stringify_int3(curChunk)) << std::endl;
-    const auto oldChunkRenderersSize = chunkRenderers.size();
     
-    std::vector<std::shared_ptr<ChunkRenderer>> unseenChunkRenderers;
-    std::vector<Int3D> unseenChunks;
-    for(const auto[xyz, renderer]: chunkRenderers) {
-        // std::cout << fmt::format("xyz: {}", DebugUtils::stringify_tupleInt3(xyz)) << std::endl;
-        int x = xyz.x;
-        int z = xyz.z;
-        if(x < curChunk.x - renderDistance || x > curChunk.x + renderDistance ||
-           z < curChunk.z - renderDistance || z > curChunk.z + renderDistance
-           ) {
-            unseenChunkRenderers.push_back(renderer);
-            unseenChunks.push_back(xyz);
-        }
-    }
+    // the renderers of chunks that left render distance are reused for the chunks that entered it
+    // (they look their chunk's buffers up on every draw, there's nothing to reset)
+    chunkRenderers.recenter(curChunk, [](const Int3D& oldIndex, const Int3D& newIndex, std::vector<std::shared_ptr<ChunkRenderer>>& renderers) {
+    });
     
-    /* debug
-     
-    std::vector<std::tuple<int,int,int>> newlySeenChunks;
-    for(int x = curChunk.x - renderDistance ; x <= curChunk.x + renderDistance; x++) {
-        for(int z = curChunk.z - renderDistance; z <= curChunk.z + renderDistance; z++) {
-            std::tuple<int, int, int> xyz = std::make_tuple(x, 0, z);
-            
-            if(!chunkRenderers.contains(xyz)) {
-                newlySeenChunks.push_back(xyz);
-            }
+    // sort by dist (furthers -> nearest), levels outside the world have no chunks
+    sortedVisibleChunks.clear();
+    for(const Int3D& offset : sortedVisibleChunkOffsets) {
+        const Int3D index = curChunk + offset;
+        if(isChunkLevelInWorld(index.y)) {
+            sortedVisibleChunks.push_back(index);
         }
     }
+}
+
+void MTLEngine::evictChunks() {
+    // Nothing within the load area is evicted for the memory budget: resolveChunkGeneration would just
+    // queue it again, and the chunk would be evicted and regenerated over and over. The budget only trims
+    // the ring past loadDistance kept around for hysteresis, the load distances are what bound the memory
+    const ChunkEvictionPolicy policy(unloadDistance, verticalUnloadDistance,
+                                     loadDistance, verticalLoadDistance,
+                                     chunkMemoryBudget);
     
-    for(auto c: unseenChunks) {
-        std::cout << fmt::format("unseen: {}", DebugUtils::stringify_tupleInt3(c)) << std::endl;
+    std::vector<ChunkEvictionCandidate> candidates;
+    {
+        std::lock_guard<std::mutex> guard(cachedChunkRDMutex);
+        loadedChunks.forEach([&](const Int3D& index, const ChunkHandle& chunk) {
+            const size_t* bytes = chunkMemoryUsage.find(index);
+            candidates.push_back({index, chunk->getLastAccessFrame(), bytes != nullptr? *bytes : 0});
+        });
     }
     
-    for(auto c: newlySeenChunks) {
-        std::cout << fmt::format("newly seen: {}", DebugUtils::stringify_tupleInt3(c)) << std::endl;
+    for(const Int3D& index : policy.selectChunksToEvict(curChunk, candidates)) {
+        unloadChunk(index);
+    }
+}
+
+void MTLEngine::unloadChunk(const Int3D& chunkIndex) {
+    ChunkHandle chunk = loadedChunks.erase(chunkIndex);
+    if(chunk == nullptr) {
+        return;
     }
     
-    assert(unseenChunks.size() == newlySeenChunks.size());
-     
-    */
-    
-    // for all seen chunks,
-    int curUnseenIndex = 0;
-    for(int x = curChunk.x - renderDistance ; x <= curChunk.x + renderDistance; x++) {
-        for(int z = curChunk.z - renderDistance; z <= curChunk.z + renderDistance; z++) {
-            Int3D xyz(x, 0, z);
-            
-            if(!chunkRenderers.contains(xyz)) {
-                assert(curUnseenIndex >= 0 && curUnseenIndex < (int) unseenChunkRenderers.size());
-                chunkRenderers.insert({xyz, unseenChunkRenderers[curUnseenIndex]});
-                chunkRenderers[xyz]->markDirty();
-                curUnseenIndex++;
+    {
+        std::lock_guard<std::mutex> guard(cachedChunkRDMutex);
+        
+        auto releaseCached = [&chunkIndex](std::map<Int3D, ChunkRenderData>& cache) {
+            auto it = cache.find(chunkIndex);
+            if(it != cache.end()) {
+                if(it->second.buffer) {
+                    it->second.buffer->release();
+                }
+                cache.erase(it);
             }
-        }
+        };
+        releaseCached(ChunkRenderer::cachedChunkBuffers);
+        releaseCached(ChunkRenderer::cachedTransparentChunkBuffers);
+        ChunkRenderer::releaseSortedTransparentIndices(chunkIndex);
+        transparentQuadSorter.removeChunk(chunkIndex);
+        
+        releaseChunkLOD(chunkIndex);
+        
+        chunkMemoryUsage.erase(chunkIndex);
+        meshedChunks.erase(chunkIndex);
+        editedChunkMeshes.erase(chunkIndex);
+        chunkEditGenerations.erase(chunkIndex);
     }
     
-    for(const auto c : unseenChunks) {
-        chunkRenderers.erase(c);
+    for(int lightId : chunk->getPointLightIds()) {
+        removePointLight(lightId);
     }
     
-    assert(chunkRenderers.size() == oldChunkRenderersSize);
-    
-    
-    // sort by dist (furthers -> nearest)
-    sortedVisibleChunks.clear();
-    
-    struct Local {
-        Int3D pos;
-        float dist;
-    };
-    
-    std::vector<Local> allVisibleChunks;
-    float3 cc = curChunk.to_float3();
-    
-    for(const auto [key, val] : chunkRenderers) {
-        Local l;
-        l.pos = key;
-        l.dist = distance(cc, key.to_float3());
-        allVisibleChunks.push_back(l);
-    }
-    
-    struct
     {
-        bool operator()(Local a, Local b) const { return a.dist > b.dist; }
-    }
-    furthestFromCurChunk;
-    
-    std::sort(allVisibleChunks.begin(), allVisibleChunks.end(), furthestFromCurChunk);
-    
-    for(const auto l : allVisibleChunks) {
-        sortedVisibleChunks.push_back(l.pos);
+        // if its column is still within the window (i.e. unloaded vertically, or for the memory budget past
+        // loadDistance), un-queue the level so it's generated again once it's back within the load area
+        std::lock_guard<std::mutex> guard(chunkColumnsMutex);
+        if(ChunkColumn* column = chunkColumns.find(chunkIndex)) {
+            column->queuedLevels &= ~(uint64_t(1) << (chunkIndex.y - worldMinChunkY));
+        }
     }
     
+    // the voxels and collision rects are freed with the chunk, once the last handle to it
+    // (this one, or a mesh worker's) goes away
 }
 
 Int3D MTLEngine::calculateCurrentChunk(const float3 pos) const {
     // return make_int3((int) pos.x / (int) chunkDims.x, (int) pos.y / (int) chunkDims.y, (int) pos.z / (int) chunkDims.z);
     int x = (int) pos.x / (int) chunkDims.x;
-    int y = 0;
+    int y = (int) pos.y / (int) chunkDims.y;
     int z = (int) pos.z / (int) chunkDims.z;
     
     if(pos.x < 0) {
         --x;
     }
+    if(pos.y < 0) {
+        --y;
+    }
     if(pos.z < 0) {
         --z;
     }
+    
+    // above/below the world, the closest level is loaded
+    y = std::clamp(y, worldMinChunkY, worldMaxChunkY);
+    
     return Int3D(x,y,z);
 }
 
+bool MTLEngine::isChunkLevelInWorld(int y) {
+    return y >= worldMinChunkY && y <= worldMaxChunkY;
+}
+
 void MTLEngine::frameBufferSizeCallback(GLFWwindow* window, int width, int height) {
     MTLEngine* engine = (MTLEngine*)glfwGetWindowUserPointer(window);
     engine->resizeFrameBuffer(width, height);
@@ -3682,12 +4003,20 @@ void MTLEngine::commitLines() {
     memcpy(lineDataUB->contents(), visibleLines.data(), visibleLines.size() * sizeof(LineData));
 }
 
-void MTLEngine::addPointLight(float3 posWS, float3 color) {
-    if(curPointLightIndex >= pointLights.size()) {
-        return;
-    }
+int MTLEngine::addPointLight(float3 posWS, float3 color) {
     std::lock_guard<std::mutex> guard(pointLightArrMutex);
-    int index = curPointLightIndex++;
+    
+    int index;
+    if(!freePointLightIndices.empty()) {
+        index = freePointLightIndices.back();
+        freePointLightIndices.pop_back();
+    }
+    else if(curPointLightIndex < (int) pointLights.size()) {
+        index = curPointLightIndex++;
+    }
+    else {
+        return -1;
+    }
     
     
     float constant  = 1.0;
@@ -3708,4 +4037,20 @@ void MTLEngine::addPointLight(float3 posWS, float3 color) {
     pointLights[index] = newLight;
 
     memcpy(lightVolumeInstanceUB->contents(), pointLights.data(), pointLights.size() * sizeof(LightVolumeData));
+    
+    return index;
+}
+
+void MTLEngine::removePointLight(int id) {
+    std::lock_guard<std::mutex> guard(pointLightArrMutex);
+    assert(id >= 0 && id < curPointLightIndex);
+    
+    // every slot is drawn, so a removed light becomes a zero-radius black sphere until the slot is reused
+    LightVolumeData emptyLight;
+    emptyLight.localToWorld = matrix4x4_scale(0.0f, 0.0f, 0.0f);
+    emptyLight.color = make_float4(0.0f, 0.0f, 0.0f, 1.0f);
+    pointLights[id] = emptyLight;
+    freePointLightIndices.push_back(id);
+    
+    memcpy(lightVolumeInstanceUB->contents(), pointLights.data(), pointLights.size() * sizeof(LightVolumeData));
 }
@@ -27,6 +27,7 @@ struct VertexOut {
     float4 positionWS;
     float4 posNDC;
     float3 colorScale;
+    float occlusion;
 };
 
 struct LightingPassVertexOut {
@@ -392,6 +393,7 @@ vertex VertexOut geometryPassVS(uint vertexID [[vertex_id]],
     out.positionWS = vertexData[vertexID].position;
     out.posNDC = out.position;
     out.colorScale = vertexData[vertexID].colorScale;
+    out.occlusion = vertexData[vertexID].occlusion;
 
     return out;
 }
@@ -454,6 +456,9 @@ fragment GeometryFragmentOut geometryPassFS(VertexOut in [[stage_in]], texture2d
     float3 colorScale = emitsLight? in.colorScale : float3(1.f);
     out.albedoSpec = colorSample * float4(colorScale, 1.f);
     
+    // baked per-vertex ambient occlusion (contact shadows that don't need the SSAO pass)
+    out.albedoSpec.rgb *= 1.f - in.occlusion;
+    
     out.emission = emitsLight? out.albedoSpec : float4(0.0, 0.0, 0.0, 1.f);
     
     out.positionWS = in.positionWS; // in.position;
@@ -0,0 +1,99 @@
+#pragma once
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <cstddef>
+
+// Thread-safe free list of fixed-size blocks.
+//
+// acquire() hands out a block wrapped in a unique_ptr whose deleter puts it back in the pool, so
+// blocks go back automatically when their owner is destroyed. Up to maxFreeBlocks released blocks
+// are kept for reuse, the rest are deleted.
+//
+// A recycled block keeps its old contents, unless the pool was given a reset function (which runs
+// on release, e.g. to clear containers without giving up their capacity).
+template<typename Block>
+class BlockPool {
+public:
+    struct Releaser {
+        BlockPool* pool;
+        void operator()(Block* block) const { pool->release(block); }
+    };
+    typedef std::unique_ptr<Block, Releaser> Handle;
+
+    typedef void (*ResetFunc)(Block&);
+
+    struct Stats {
+        size_t numAllocated = 0;
+        size_t numReused = 0;
+        size_t numFree = 0;
+    };
+
+    BlockPool(size_t maxFreeBlocks, ResetFunc resetFunc = nullptr)
+    : maxFreeBlocks(maxFreeBlocks), resetFunc(resetFunc)
+    {}
+
+    ~BlockPool() {
+        for(Block* block : freeBlocks) {
+            delete block;
+        }
+    }
+
+    BlockPool(const BlockPool&) = delete;
+    BlockPool& operator=(const BlockPool&) = delete;
+
+    Handle acquire() {
+        {
+            std::lock_guard<std::mutex> guard(mutex);
+            if(!freeBlocks.empty()) {
+                Block* block = freeBlocks.back();
+                freeBlocks.pop_back();
+                stats.numReused++;
+                return Handle(block, Releaser{this});
+            }
+            stats.numAllocated++;
+        }
+
+        return Handle(new Block(), Releaser{this});
+    }
+
+    Stats getStats() const {
+        std::lock_guard<std::mutex> guard(mutex);
+        Stats out = stats;
+        out.numFree = freeBlocks.size();
+        return out;
+    }
+
+    // deletes every free block
+    void trim() {
+        std::lock_guard<std::mutex> guard(mutex);
+        for(Block* block : freeBlocks) {
+            delete block;
+        }
+        freeBlocks.clear();
+    }
+
+private:
+    void release(Block* block) {
+        if(resetFunc) {
+            resetFunc(*block);
+        }
+
+        {
+            std::lock_guard<std::mutex> guard(mutex);
+            if(freeBlocks.size() < maxFreeBlocks) {
+                freeBlocks.push_back(block);
+                return;
+            }
+        }
+
+        delete block;
+    }
+
+    size_t maxFreeBlocks;
+    ResetFunc resetFunc;
+
+    mutable std::mutex mutex;
+    std::vector<Block*> freeBlocks;
+    Stats stats;
+};
@@ -0,0 +1,182 @@
+#pragma once
+#include <vector>
+#include <functional>
+#include <cstdint>
+#include <cassert>
+
+// Hash map with open addressing (linear probing) over a single flat array of slots.
+//
+// Compared to std::unordered_map there is no per-entry node allocation and a lookup is usually one or two
+// adjacent slots, but the hash must be well mixed in its low bits (see std::hash<Int3D>).
+// Erased entries leave a tombstone which is cleared on the next rehash.
+//
+// Not thread-safe, see ChunkTable for the sharded/locked version used for loaded chunks.
+template<typename K, typename V, typename Hash = std::hash<K>>
+class OpenAddressingMap {
+public:
+    OpenAddressingMap(size_t initialNumSlots = 16)
+    : slots(roundUpToPowerOf2(initialNumSlots)), numOccupied(0), numTombstones(0)
+    {}
+
+    // returns false (and leaves the map untouched) if key is already present
+    bool insert(const K& key, V value) {
+        const size_t hash = Hash()(key);
+        if(findSlot(key, hash) != -1) {
+            return false;
+        }
+
+        // keep the load factor (including tombstones) under 3/4
+        if((numOccupied + numTombstones + 1) * 4 > slots.size() * 3) {
+            // only grow if live entries need the room, otherwise rehashing just clears the tombstones
+            const bool grow = (numOccupied + 1) * 2 > slots.size();
+            rehash(grow? slots.size() * 2 : slots.size());
+        }
+
+        const size_t mask = slots.size() - 1;
+        for(size_t i = hash & mask;; i = (i + 1) & mask) {
+            Slot& slot = slots[i];
+            if(slot.state != ESlotState::Occupied) {
+                if(slot.state == ESlotState::Tombstone) {
+                    numTombstones--;
+                }
+
+                slot.key = key;
+                slot.value = std::move(value);
+                slot.state = ESlotState::Occupied;
+                numOccupied++;
+                return true;
+            }
+        }
+    }
+
+    // returns nullptr if key isn't present
+    V* find(const K& key) {
+        const int i = findSlot(key, Hash()(key));
+        return i == -1? nullptr : &slots[i].value;
+    }
+
+    const V* find(const K& key) const {
+        const int i = findSlot(key, Hash()(key));
+        return i == -1? nullptr : &slots[i].value;
+    }
+
+    bool contains(const K& key) const {
+        return findSlot(key, Hash()(key)) != -1;
+    }
+
+    // returns false if key wasn't present. If outValue is given, the erased value is moved into it
+    bool erase(const K& key, V* outValue = nullptr) {
+        const int i = findSlot(key, Hash()(key));
+        if(i == -1) {
+            return false;
+        }
+
+        Slot& slot = slots[i];
+        if(outValue != nullptr) {
+            *outValue = std::move(slot.value);
+        }
+        slot.value = V();
+        slot.state = ESlotState::Tombstone;
+        numOccupied--;
+        numTombstones++;
+
+        return true;
+    }
+
+    void clear() {
+        for(Slot& slot : slots) {
+            slot = Slot();
+        }
+        numOccupied = 0;
+        numTombstones = 0;
+    }
+
+    // makes room for numEntries without any further rehashing
+    void reserve(size_t numEntries) {
+        const size_t requiredSlots = roundUpToPowerOf2(numEntries * 4 / 3 + 1);
+        if(requiredSlots > slots.size()) {
+            rehash(requiredSlots);
+        }
+    }
+
+    size_t size() const { return numOccupied; }
+
+    // calls func(const K&, V&) for every entry, in slot order.
+    // func must not insert into or erase from the map
+    template<typename Func>
+    void forEach(Func func) {
+        for(Slot& slot : slots) {
+            if(slot.state == ESlotState::Occupied) {
+                func(slot.key, slot.value);
+            }
+        }
+    }
+
+    template<typename Func>
+    void forEach(Func func) const {
+        for(const Slot& slot : slots) {
+            if(slot.state == ESlotState::Occupied) {
+                func(slot.key, slot.value);
+            }
+        }
+    }
+
+private:
+    enum class ESlotState : uint8_t {
+        Empty,
+        Occupied,
+        Tombstone,
+    };
+
+    struct Slot {
+        K key;
+        V value;
+        ESlotState state = ESlotState::Empty;
+    };
+
+    static size_t roundUpToPowerOf2(size_t n) {
+        size_t out = 1;
+        while(out < n) {
+            out <<= 1;
+        }
+        return out;
+    }
+
+    int findSlot(const K& key, size_t hash) const {
+        const size_t mask = slots.size() - 1;
+        for(size_t i = hash & mask;; i = (i + 1) & mask) {
+            const Slot& slot = slots[i];
+            if(slot.state == ESlotState::Empty) {
+                return -1;
+            }
+            if(slot.state == ESlotState::Occupied && slot.key == key) {
+                return (int) i;
+            }
+        }
+    }
+
+    void rehash(size_t newNumSlots) {
+        assert((newNumSlots & (newNumSlots - 1)) == 0);
+
+        std::vector<Slot> oldSlots = std::move(slots);
+        slots = std::vector<Slot>(newNumSlots);
+        numTombstones = 0;
+
+        const size_t mask = newNumSlots - 1;
+        for(Slot& oldSlot : oldSlots) {
+            if(oldSlot.state != ESlotState::Occupied) {
+                continue;
+            }
+
+            size_t i = Hash()(oldSlot.key) & mask;
+            while(slots[i].state == ESlotState::Occupied) {
+                i = (i + 1) & mask;
+            }
+            slots[i] = std::move(oldSlot);
+        }
+    }
+
+    std::vector<Slot> slots;
+    size_t numOccupied;
+    size_t numTombstones;
+};
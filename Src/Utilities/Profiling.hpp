@@ -22,6 +22,12 @@ public:
         return duration.count();
     }
     
+    // higher resolution than getDuration(), for micro-benchmarks
+    double getDurationMicroseconds() const {
+        auto end = std::chrono::high_resolution_clock::now();
+        return std::chrono::duration<double, std::micro>(end - start).count();
+    }
+    
     ~Timer() {
         if(!shouldAutoPrint)
             return;
@@ -8,6 +8,8 @@ struct VertexData {
     simd::float2 textureCoordinates;
     simd::float3 normal;
     int atlasIndex;
+    // baked ambient occlusion, from 0 (none) to 1 (black), see EChunkMesher::BakedAO
+    float occlusion;
     simd::float3 colorScale;
 };
 
@@ -0,0 +1,103 @@
+#pragma once
+#include <vector>
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#import "Voxel/VoxelTypes.hpp"
+
+// what the eviction policy needs to know about a loaded chunk
+struct ChunkEvictionCandidate {
+    Int3D index;
+    // engine frame the chunk was last drawn or collided with
+    uint64_t lastAccessFrame;
+    // voxels + collision + mesh buffers
+    size_t bytes;
+};
+
+// Decides which loaded chunks to unload.
+//
+//  - every chunk further than unloadDistance (or more than verticalUnloadDistance levels above/below)
+//    from the center chunk is unloaded
+//  - then, while the remaining chunks use more than memoryBudget bytes, chunks are unloaded in
+//    least-recently-used order (the furthest first when last access ties). Chunks within
+//    keepDistance and verticalKeepDistance are never unloaded for the budget. These should cover every
+//    chunk the caller would load again right away (i.e. its load distances), or evicted chunks are just
+//    regenerated.
+//
+// Distances are Chebyshev distances in the XZ plane, matching the square load/render areas, vertical
+// distances are counted separately since columns are much shorter than the load area is wide.
+class ChunkEvictionPolicy {
+public:
+    ChunkEvictionPolicy(int unloadDistance, int verticalUnloadDistance,
+                        int keepDistance, int verticalKeepDistance,
+                        size_t memoryBudget)
+    : unloadDistance(unloadDistance), verticalUnloadDistance(verticalUnloadDistance),
+      keepDistance(keepDistance), verticalKeepDistance(verticalKeepDistance),
+      memoryBudget(memoryBudget)
+    {}
+
+    static int chunkDistance(const Int3D& a, const Int3D& b) {
+        return std::max(std::abs(a.x - b.x), std::abs(a.z - b.z));
+    }
+
+    static int verticalChunkDistance(const Int3D& a, const Int3D& b) {
+        return std::abs(a.y - b.y);
+    }
+
+    // returns the chunks to unload, in the order they should be unloaded
+    std::vector<Int3D> selectChunksToEvict(const Int3D& center, std::vector<ChunkEvictionCandidate> candidates) const {
+        std::vector<Int3D> toEvict;
+        std::vector<ChunkEvictionCandidate> budgetCandidates;
+        size_t totalBytes = 0;
+
+        for(const ChunkEvictionCandidate& c : candidates) {
+            const int dist = chunkDistance(center, c.index);
+            const int verticalDist = verticalChunkDistance(center, c.index);
+            if(dist > unloadDistance || verticalDist > verticalUnloadDistance) {
+                toEvict.push_back(c.index);
+                continue;
+            }
+
+            totalBytes += c.bytes;
+            if(dist > keepDistance || verticalDist > verticalKeepDistance) {
+                budgetCandidates.push_back(c);
+            }
+        }
+
+        if(totalBytes <= memoryBudget) {
+            return toEvict;
+        }
+
+        std::sort(budgetCandidates.begin(), budgetCandidates.end(), [&center](const ChunkEvictionCandidate& a, const ChunkEvictionCandidate& b) {
+            if(a.lastAccessFrame != b.lastAccessFrame) {
+                return a.lastAccessFrame < b.lastAccessFrame;
+            }
+            const int distA = chunkDistance(center, a.index) + verticalChunkDistance(center, a.index);
+            const int distB = chunkDistance(center, b.index) + verticalChunkDistance(center, b.index);
+            return distA > distB;
+        });
+
+        for(const ChunkEvictionCandidate& c : budgetCandidates) {
+            if(totalBytes <= memoryBudget) {
+                break;
+            }
+            toEvict.push_back(c.index);
+            totalBytes -= c.bytes;
+        }
+
+        return toEvict;
+    }
+
+    int getUnloadDistance() const { return unloadDistance; }
+    int getVerticalUnloadDistance() const { return verticalUnloadDistance; }
+    int getKeepDistance() const { return keepDistance; }
+    int getVerticalKeepDistance() const { return verticalKeepDistance; }
+    size_t getMemoryBudget() const { return memoryBudget; }
+
+private:
+    int unloadDistance;
+    int verticalUnloadDistance;
+    int keepDistance;
+    int verticalKeepDistance;
+    size_t memoryBudget;
+};
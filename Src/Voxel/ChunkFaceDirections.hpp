@@ -0,0 +1,38 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <simd/simd.h>
+
+// Face directions are in Int3D::getAllNeighbors order, +x, -x, +z, -z, -y, +y (the same as
+// packedNormalIndex).
+static const int numChunkFaceDirections = 6;
+
+// one bit per face direction
+typedef uint8_t ChunkFaceDirectionMask;
+static const ChunkFaceDirectionMask allChunkFaceDirections = 0x3F;
+
+// A vertex buffer whose faces are grouped by direction: the faces facing direction i are the
+// vertices [offsets[i], offsets[i+1]).
+struct ChunkFaceRanges {
+    std::array<int, numChunkFaceDirections + 1> offsets = {0, 0, 0, 0, 0, 0, 0};
+
+    int getNumVertices(int direction) const { return offsets[direction + 1] - offsets[direction]; }
+    int getTotalNumVertices() const { return offsets[numChunkFaceDirections]; }
+};
+
+// The directions whose faces inside the box [aabbMin, aabbMax] can be front-facing to a camera at
+// cameraPosition. A face facing +x on the plane x = p only faces the camera if cameraPosition.x > p,
+// so when the camera isn't past aabbMin.x, none of the box's +x faces can be seen (and likewise for
+// the other directions). Both directions of an axis are only kept while the camera is between the
+// box's sides along that axis.
+inline ChunkFaceDirectionMask findVisibleFaceDirections(const simd::float3& cameraPosition,
+                                                        const simd::float3& aabbMin, const simd::float3& aabbMax) {
+    ChunkFaceDirectionMask mask = 0;
+    mask |= (cameraPosition.x > aabbMin.x) << 0;
+    mask |= (cameraPosition.x < aabbMax.x) << 1;
+    mask |= (cameraPosition.z > aabbMin.z) << 2;
+    mask |= (cameraPosition.z < aabbMax.z) << 3;
+    mask |= (cameraPosition.y < aabbMax.y) << 4;
+    mask |= (cameraPosition.y > aabbMin.y) << 5;
+    return mask;
+}
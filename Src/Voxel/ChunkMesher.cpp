@@ -0,0 +1,1191 @@
+#include "Voxel/ChunkMesher.hpp"
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <cassert>
+
+const std::array<EVoxelType, 4> ChunkMesher::meshedVoxelTypes = {EVoxelType::Grass, EVoxelType::Dirt, EVoxelType::Stone, EVoxelType::Water};
+
+const std::array<uint32_t, 6> ChunkMesher::quadIndexPattern = {0, 1, 2, 2, 3, 0};
+
+ChunkMeshScratch& ChunkMesher::getThreadScratch() {
+    static thread_local ChunkMeshScratch scratch;
+    return scratch;
+}
+
+void ChunkMesher::mesh(EChunkMesher mesher, const Chunk& chunk, const ChunkMeshNeighbors& neighbors, ChunkMeshQuads& outQuads) {
+    switch(mesher) {
+        case EChunkMesher::Scalar:
+            meshScalar(chunk, neighbors, outQuads);
+            break;
+        case EChunkMesher::Bitmask:
+            meshBitmask(chunk, neighbors, outQuads);
+            break;
+        case EChunkMesher::SinglePass:
+            meshSinglePass(chunk, neighbors, outQuads);
+            break;
+        case EChunkMesher::BakedAO:
+            meshBakedAO(chunk, neighbors, outQuads);
+            break;
+    }
+}
+
+void ChunkMesher::findTypesToMesh(const Chunk& chunk, const ChunkMeshNeighbors& neighbors, std::vector<EVoxelType>& outTypes) {
+    const Int3D dimsU = chunk.getDimensions();
+    const std::array<int, 3> dims = {dimsU.x, dimsU.y, dimsU.z};
+
+    std::array<bool, numVoxelTypes> typeIsPresent = {};
+    for(const EVoxelType type : meshedVoxelTypes) {
+        typeIsPresent[(int) type] = chunk.containsVoxelType(type);
+    }
+
+    // scans the neighbor's face at index border along axis d
+    auto addBorderTypes = [&](const Chunk* neighbor, int d, int border) {
+        if(neighbor == nullptr) {
+            return;
+        }
+
+        // the per-type counts tell us if scanning the face could find anything new
+        bool mayAddType = false;
+        for(const EVoxelType type : meshedVoxelTypes) {
+            mayAddType |= !typeIsPresent[(int) type] && neighbor->containsVoxelType(type);
+        }
+        if(!mayAddType) {
+            return;
+        }
+
+        const int u = (d+1)%3;
+        const int v = (d+2)%3;
+        std::array<int, 3> coords;
+        coords[d] = border;
+        for(coords[v] = 0; coords[v] < dims[v]; coords[v]++) {
+            for(coords[u] = 0; coords[u] < dims[u]; coords[u]++) {
+                typeIsPresent[(int) neighbor->getVoxel({coords[0], coords[1], coords[2]})] = true;
+            }
+        }
+    };
+    addBorderTypes(neighbors[0], 0, 0);
+    addBorderTypes(neighbors[1], 0, dims[0] - 1);
+    addBorderTypes(neighbors[2], 2, 0);
+    addBorderTypes(neighbors[3], 2, dims[2] - 1);
+    addBorderTypes(neighbors[4], 1, dims[1] - 1);
+    addBorderTypes(neighbors[5], 1, 0);
+
+    outTypes.clear();
+    for(const EVoxelType type : meshedVoxelTypes) {
+        if(typeIsPresent[(int) type]) {
+            outTypes.push_back(type);
+        }
+    }
+}
+
+bool ChunkMesher::findSweepRange(const Chunk& chunk, const ChunkMeshNeighbors& neighbors,
+                                 std::array<int, 3>& outSweepMin, std::array<int, 3>& outSweepMax) {
+    const Int3D dimsU = chunk.getDimensions();
+    const std::array<int, 3> dims = {dimsU.x, dimsU.y, dimsU.z};
+
+    // Sections that are all air (in this chunk and its neighbors, whose border voxels are also
+    // compared against) can't produce any faces, so only the rows of y in between are swept.
+    outSweepMin = {0, dims[1], 0};
+    outSweepMax = {dims[0], 0, dims[2]};
+
+    const std::array<const Chunk*, 5> sweptChunks = {&chunk, neighbors[0], neighbors[1], neighbors[2], neighbors[3]};
+    for(const Chunk* c : sweptChunks) {
+        int minY, maxY;
+        if(c != nullptr && c->getNonEmptyYRange(minY, maxY)) {
+            outSweepMin[1] = std::min(outSweepMin[1], minY);
+            outSweepMax[1] = std::max(outSweepMax[1], maxY);
+        }
+    }
+
+    // the Y neighbors only matter through the row touching this chunk, which extends the
+    // top-bottom sweep to the boundary with them (sweepMin == sweepMax then only sweeps the boundary)
+    int minY, maxY;
+    if(neighbors[4] != nullptr && neighbors[4]->getNonEmptyYRange(minY, maxY) && maxY == dims[1]) {
+        outSweepMin[1] = 0;
+        outSweepMax[1] = std::max(outSweepMax[1], 0);
+    }
+    if(neighbors[5] != nullptr && neighbors[5]->getNonEmptyYRange(minY, maxY) && minY == 0) {
+        outSweepMin[1] = std::min(outSweepMin[1], dims[1]);
+        outSweepMax[1] = dims[1];
+    }
+
+    // everything is air
+    return outSweepMin[1] <= outSweepMax[1];
+}
+
+uint8_t ChunkMesher::classifyFace(EVoxelType a, EVoxelType b) {
+    // same rules as meshScalar: opaque types show against air and water, water only against air
+    auto isOpenTo = [](EVoxelType type, EVoxelType other) {
+        return other == EVoxelType::None || (type != EVoxelType::Water && other == EVoxelType::Water);
+    };
+
+    for(const EVoxelType type : meshedVoxelTypes) {
+        if(b == type && isOpenTo(type, a)) {
+            return 1 + ((int) type << 1);
+        }
+        if(a == type && isOpenTo(type, b)) {
+            return 1 + ((int) type << 1 | 1);
+        }
+    }
+    return 0;
+}
+
+const ChunkMesher::FaceTable& ChunkMesher::getFaceTable() {
+    static const FaceTable faceTable = [] {
+        FaceTable table;
+        for(int a = 0; a < numVoxelTypes; a++) {
+            for(int b = 0; b < numVoxelTypes; b++) {
+                table[a][b] = classifyFace((EVoxelType) a, (EVoxelType) b);
+            }
+        }
+        return table;
+    }();
+    return faceTable;
+}
+
+void ChunkMesher::addQuad(const Chunk& chunk, int d, const std::array<int, 3>& x, int w, int h,
+                          bool isBackface, EVoxelType voxelType, ChunkMeshQuads& outQuads,
+                          const std::array<uint8_t, 4>& aoLevels) {
+    const int u = (d+1)%3;
+    const int v = (d+2)%3;
+
+    std::array<int, 3> du = {0, 0, 0};
+    std::array<int, 3> dv = {0, 0, 0};
+    du[u] = w;
+    dv[v] = h;
+
+    const simd::float4 worldOffset = chunk.getPositionAsFloat4();
+
+    // coords in counter-clockwise (CCW)
+    std::array<simd::float4, 4> verts = {
+        simd::make_float4(x[0], x[1], x[2], 1.0) + worldOffset,
+        simd::make_float4(x[0]+du[0], x[1]+du[1], x[2]+du[2], 1.0) + worldOffset,
+        simd::make_float4(x[0]+du[0]+dv[0], x[1]+du[1]+dv[1], x[2]+du[2]+dv[2], 1.0) + worldOffset,
+        simd::make_float4(x[0]+dv[0], x[1]+dv[1], x[2]+dv[2], 1.0) + worldOffset,
+    };
+
+    // ordering to ensure CCW direction
+    static const int order[6][4] = {
+        {0,3,2,1}, // front-back
+        {3,2,1,0}, // top-bottom
+        {1,0,3,2}, // left-right
+
+        {3,0,1,2}, // front-back (backface)
+        {0,1,2,3}, // top-bottom (backface)
+        {0,1,2,3}, // left-right (backface)
+    };
+
+    ChunkMeshQuad newQuad;
+    newQuad.vxType = voxelType;
+
+    const int orderIndex = isBackface? d+3 : d;
+    for(int i = 0; i < 4; i++) {
+        newQuad.positions[i] = verts[order[orderIndex][i]];
+        newQuad.aoLevels[i] = aoLevels[order[orderIndex][i]];
+    }
+
+    // BUG: width/height reversed in certain directions???
+    newQuad.width = d == 0? h : w;
+    newQuad.height = d == 0? w : h;
+
+    if(d == 0) {
+        newQuad.normal = simd::make_float3(-1.0,0,0);
+    }
+    else if(d == 1) {
+        // algo goes bottom to top
+        newQuad.normal = simd::make_float3(0,-1.0,0);
+    }
+    else {
+        newQuad.normal = simd::make_float3(0,0,-1.0f);
+    }
+
+    if(isBackface) {
+        newQuad.normal = -1 * newQuad.normal;
+    }
+
+    // TODO: we can add quads to 3 separate arrays (when d=0,1,2)
+    // so we can assume normals when constructing the vertex buffer
+    if(voxelType == EVoxelType::Water) {
+        outQuads.water.push_back(newQuad);
+    }
+    else {
+        outQuads.opaque.push_back(newQuad);
+    }
+}
+
+void ChunkMesher::meshScalar(const Chunk& chunk, const ChunkMeshNeighbors& neighbors, ChunkMeshQuads& outQuads) {
+    Int3D dimsU = chunk.getDimensions();
+    std::array<int, 3> dims = { (int) dimsU.x, (int) dimsU.y, (int) dimsU.z};
+
+    ChunkMeshScratch& scratch = getThreadScratch();
+    const std::vector<EVoxelType>& voxelTypesToCheck = scratch.voxelTypes;
+    findTypesToMesh(chunk, neighbors, scratch.voxelTypes);
+
+    std::array<int, 3> sweepMin;
+    std::array<int, 3> sweepMax;
+    if(!findSweepRange(chunk, neighbors, sweepMin, sweepMax)) {
+        return;
+    }
+
+    typedef ChunkMeshScratch::ScalarMaskData MaskData;
+
+    // this currently costs: O(n * dims^3) where n is number of voxel types present
+    // (an all-air chunk, or one without water, skips those sweeps entirely)
+    for(const EVoxelType& voxelType : voxelTypesToCheck) {
+        for(int d=0; d<3; d++) {
+            int u = (d+1)%3;
+            int v = (d+2)%3;
+            std::array<int, 3> x = {0,0,0};
+            std::array<int, 3> q = {0,0,0}; // delta
+
+            std::vector<MaskData>& mask = scratch.scalarMask;
+            mask.assign(dims[u] * dims[v], MaskData());
+
+            q[d] = 1;
+
+            // d==0 front-back
+            // d==1 top-bottom
+            // d==2 left-right
+            const Chunk* beforeChunk = nullptr;
+            const Chunk* afterChunk = nullptr;
+            if(d==0) {
+                beforeChunk = neighbors[1];
+                afterChunk = neighbors[0];
+            }
+            else if(d==1) {
+                beforeChunk = neighbors[4];
+                afterChunk = neighbors[5];
+            }
+            else if(d==2) {
+                beforeChunk = neighbors[3];
+                afterChunk = neighbors[2];
+            }
+
+            // mask entries outside of the swept rows are never written, and stay non-incident
+            for(x[d]=sweepMin[d]-1; x[d]<sweepMax[d]; ) {
+                int n = 0;
+
+                for(x[v]=sweepMin[v]; x[v]<sweepMax[v]; x[v]++) {
+                    for(x[u]=sweepMin[u]; x[u]<sweepMax[u]; x[u]++) {
+                        n = x[u] + x[v] * dims[u];
+
+                        const bool xInRangeLeft = x[d] >= 0; // only invalid when x[d]==-1 on first iteration
+                        const bool xInRangeRight = x[d] < dims[d] - 1;
+
+                        EVoxelType xValType = EVoxelType::None;
+                        EVoxelType xDeltaValType = EVoxelType::None;
+
+                        if(xInRangeLeft) {
+                            xValType = chunk.getVoxel({(int) x[0], (int) x[1], (int) x[2]});
+                        }
+                        else if(beforeChunk != nullptr) {
+                            std::array<int, 3> b = x;
+                            b[d] = dims[d] - 1;
+                            xValType = beforeChunk->getVoxel({b[0], b[1], b[2]});
+                        }
+
+                        if(xInRangeRight) {
+                            xDeltaValType = chunk.getVoxel({(int) x[0] + q[0], (int) x[1]+q[1], (int) x[2]+q[2]});
+                        }
+                        else if(afterChunk != nullptr) {
+                            std::array<int, 3> a = x;
+                            a[d] = 0;
+                            xDeltaValType = afterChunk->getVoxel({a[0], a[1], a[2]});
+                        }
+
+                        //
+                        // depending which is seen determines the normal (and quad orientation)
+                        //
+                        // Say X is a non-empty voxel:
+                        //
+                        // [ |X| ] =>  - when x==0  =>  normal is <-
+                        // [0|1|2]     - when x==1  =>  normal is ->
+                        //
+
+                        bool incident = false;
+                        bool isBackface = false;
+
+                        if(voxelType != EVoxelType::Water) {
+                            if(xValType == voxelType && (xDeltaValType == EVoxelType::None || xDeltaValType == EVoxelType::Water)) {
+                                incident = true;
+                                isBackface = true;
+                            }
+
+                            if(xDeltaValType == voxelType && (xValType == EVoxelType::None || xValType == EVoxelType::Water)) {
+                                incident = true;
+                                isBackface = false;
+                            }
+                        }
+                        else {
+                            if(xValType == voxelType && (xDeltaValType == EVoxelType::None)) {
+                                incident = true;
+                                isBackface = true;
+                            }
+
+                            if(xDeltaValType == voxelType && (xValType == EVoxelType::None)) {
+                                incident = true;
+                                isBackface = false;
+                            }
+                        }
+
+                        mask[n] = MaskData(incident, isBackface);
+                    }
+                }
+
+                x[d]++;
+                n = 0;
+
+                for(int j=0; j<dims[v]; j++) {
+                    for(int i=0; i<dims[u]; ) {
+                        if(mask[n].incident) {
+                            int w;
+                            for(w=1; i+w<dims[u] && mask[n+w].incident ; w++) {
+                            }
+
+                            bool done = false;
+                            int h;
+                            int k;
+                            for(h=1; j+h<dims[v]; h++) {
+                                for(k=0; k<w; k++) {
+                                    if(!mask[n+k+h*dims[u]].incident) {
+                                        done = true;
+                                        break;
+                                    }
+                                }
+                                if(done) {
+                                    break;
+                                }
+                            }
+
+                            x[u] = i; x[v] = j;
+                            addQuad(chunk, d, x, w, h, mask[n].isBackface, voxelType, outQuads);
+
+                            for(int l=0; l<h; l++) {
+                                for(k=0; k<w; k++) {
+                                    // reset
+                                    mask[n+k+l*dims[u]] = MaskData();
+                                }
+                            }
+
+                            i += w; n += w;
+                        }
+                        else {
+                            i++;
+                            n++;
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
+
+void ChunkMesher::meshBitmask(const Chunk& chunk, const ChunkMeshNeighbors& neighbors, ChunkMeshQuads& outQuads) {
+    const Int3D dimsU = chunk.getDimensions();
+    const std::array<int, 3> dims = {dimsU.x, dimsU.y, dimsU.z};
+
+    ChunkMeshScratch& scratch = getThreadScratch();
+    const std::vector<EVoxelType>& voxelTypesToCheck = scratch.voxelTypes;
+    findTypesToMesh(chunk, neighbors, scratch.voxelTypes);
+
+    std::array<int, 3> sweepMin;
+    std::array<int, 3> sweepMax;
+    if(voxelTypesToCheck.empty() || !findSweepRange(chunk, neighbors, sweepMin, sweepMax)) {
+        return;
+    }
+
+    // For every axis d there's one 64-bit column per (u, v) position (index u + v * dims[u], like the
+    // scalar mask), with bit x[d] + 1 set if the voxel there is of the column's kind. Bit 0 is the
+    // before-neighbor's border voxel and bit dims[d] + 1 the after-neighbor's.
+    for(int d = 0; d < 3; d++) {
+        assert(dims[d] + 2 <= 64);
+    }
+
+    auto columnIndex = [&dims](int d, const std::array<int, 3>& c) {
+        const int u = (d+1)%3;
+        const int v = (d+2)%3;
+        return c[u] + c[v] * dims[u];
+    };
+
+    // per axis: occupancy per voxel type (only allocated for the meshed types and water), and air
+    std::array<std::array<std::vector<uint64_t>, numVoxelTypes>, 3>& occupancy = scratch.occupancy;
+    std::array<std::vector<uint64_t>, 3>& air = scratch.air;
+
+    std::array<bool, numVoxelTypes> isTracked = {};
+    for(const EVoxelType type : voxelTypesToCheck) {
+        isTracked[(int) type] = true;
+    }
+    // water is always tracked, it's "air" to the opaque types
+    isTracked[(int) EVoxelType::Water] = true;
+
+    for(int d = 0; d < 3; d++) {
+        const int numColumns = dims[(d+1)%3] * dims[(d+2)%3];
+        const uint64_t allBits = (uint64_t(1) << (dims[d] + 2)) - 1;
+
+        air[d].assign(numColumns, allBits);
+        for(int t = 0; t < numVoxelTypes; t++) {
+            if(isTracked[t]) {
+                occupancy[d][t].assign(numColumns, 0);
+            }
+        }
+    }
+
+    auto addVoxel = [&](int d, int column, int bit, EVoxelType type) {
+        if(type == EVoxelType::None) {
+            return;
+        }
+        air[d][column] &= ~(uint64_t(1) << bit);
+        if(isTracked[(int) type]) {
+            occupancy[d][(int) type][column] |= uint64_t(1) << bit;
+        }
+    };
+
+    // every voxel is read once (all-air sections not even that, the columns start out as air)
+    chunk.forEachNonEmptySectionVoxel([&](const Int3D& coords, EVoxelType type) {
+        if(type == EVoxelType::None) {
+            return;
+        }
+        const std::array<int, 3> c = {coords.x, coords.y, coords.z};
+        for(int d = 0; d < 3; d++) {
+            addVoxel(d, columnIndex(d, c), c[d] + 1, type);
+        }
+    });
+
+    // the neighbors' border voxels
+    {
+        // before/after neighbor per axis
+        const std::array<const Chunk*, 3> beforeChunks = {neighbors[1], neighbors[4], neighbors[3]};
+        const std::array<const Chunk*, 3> afterChunks = {neighbors[0], neighbors[5], neighbors[2]};
+
+        for(int d = 0; d < 3; d++) {
+            const int u = (d+1)%3;
+            const int v = (d+2)%3;
+
+            std::array<int, 3> c;
+            for(c[v] = 0; c[v] < dims[v]; c[v]++) {
+                for(c[u] = 0; c[u] < dims[u]; c[u]++) {
+                    const int column = columnIndex(d, c);
+                    if(beforeChunks[d] != nullptr) {
+                        c[d] = dims[d] - 1;
+                        addVoxel(d, column, 0, beforeChunks[d]->getVoxel({c[0], c[1], c[2]}));
+                    }
+                    if(afterChunks[d] != nullptr) {
+                        c[d] = 0;
+                        addVoxel(d, column, dims[d] + 1, afterChunks[d]->getVoxel({c[0], c[1], c[2]}));
+                    }
+                }
+            }
+        }
+    }
+
+    // slice masks, one 64-bit row per v with bit u set if the face at (u, v) is incident
+    std::vector<uint64_t>& incidentRows = scratch.incidentRows;
+    std::vector<uint64_t>& backfaceRows = scratch.backfaceRows;
+
+    for(const EVoxelType voxelType : voxelTypesToCheck) {
+        for(int d = 0; d < 3; d++) {
+            const int u = (d+1)%3;
+            const int v = (d+2)%3;
+            const int numSlices = dims[d] + 1;
+
+            incidentRows.assign(numSlices * dims[v], 0);
+            backfaceRows.assign(numSlices * dims[v], 0);
+
+            // slice e is the face between bits e and e + 1 of a column (x[d] == e - 1 and e)
+            const uint64_t sliceBits = (uint64_t(1) << numSlices) - 1;
+
+            const std::vector<uint64_t>& typeColumns = occupancy[d][(int) voxelType];
+            const std::vector<uint64_t>& waterColumns = occupancy[d][(int) EVoxelType::Water];
+
+            for(int j = 0; j < dims[v]; j++) {
+                for(int i = 0; i < dims[u]; i++) {
+                    const int column = i + j * dims[u];
+
+                    // opaque types show against air and water, water only against air
+                    const uint64_t occupied = typeColumns[column];
+                    const uint64_t open = voxelType == EVoxelType::Water? air[d][column] : (air[d][column] | waterColumns[column]);
+
+                    const uint64_t backfaces = occupied & (open >> 1) & sliceBits;
+                    const uint64_t frontfaces = (occupied >> 1) & open & sliceBits;
+
+                    // scatter the column's faces into the slices' rows
+                    for(uint64_t faces = backfaces | frontfaces; faces != 0; faces &= faces - 1) {
+                        const int e = std::countr_zero(faces);
+                        incidentRows[e * dims[v] + j] |= uint64_t(1) << i;
+                        // (a face can't be both, the voxel on one side would have to be the type and open)
+                        if(!((frontfaces >> e) & 1)) {
+                            backfaceRows[e * dims[v] + j] |= uint64_t(1) << i;
+                        }
+                    }
+                }
+            }
+
+            for(int e = 0; e < numSlices; e++) {
+                uint64_t* rows = &incidentRows[e * dims[v]];
+                const uint64_t* backRows = &backfaceRows[e * dims[v]];
+
+                for(int j = 0; j < dims[v]; j++) {
+                    while(rows[j] != 0) {
+                        const int i = std::countr_zero(rows[j]);
+                        const int w = std::countr_one(rows[j] >> i);
+                        const uint64_t run = (w == 64? ~uint64_t(0) : ((uint64_t(1) << w) - 1)) << i;
+
+                        int h = 1;
+                        while(j + h < dims[v] && (rows[j + h] & run) == run) {
+                            h++;
+                        }
+
+                        for(int l = 0; l < h; l++) {
+                            rows[j + l] &= ~run;
+                        }
+
+                        std::array<int, 3> x;
+                        x[d] = e;
+                        x[u] = i;
+                        x[v] = j;
+                        // like the scalar mesher, the whole quad takes its first face's orientation
+                        addQuad(chunk, d, x, w, h, (backRows[j] >> i) & 1, voxelType, outQuads);
+                    }
+                }
+            }
+        }
+    }
+}
+
+void ChunkMesher::meshSinglePass(const Chunk& chunk, const ChunkMeshNeighbors& neighbors, ChunkMeshQuads& outQuads) {
+    const Int3D dimsU = chunk.getDimensions();
+    const std::array<int, 3> dims = {dimsU.x, dimsU.y, dimsU.z};
+
+    std::array<int, 3> sweepMin;
+    std::array<int, 3> sweepMax;
+    if(!findSweepRange(chunk, neighbors, sweepMin, sweepMax)) {
+        return;
+    }
+
+    const FaceTable& faceTable = getFaceTable();
+
+    // The chunk's voxels padded by one on every side with the neighbors' border voxels (air where
+    // there's no neighbor), so both voxels of a face are read from the same array without branches.
+    const std::array<int, 3> paddedDims = {dims[0] + 2, dims[1] + 2, dims[2] + 2};
+    const std::array<int, 3> strides = {1, paddedDims[0] * paddedDims[2], paddedDims[0]};
+    auto paddedIndex = [&](int x, int y, int z) {
+        return (x + 1) * strides[0] + (y + 1) * strides[1] + (z + 1) * strides[2];
+    };
+
+    ChunkMeshScratch& scratch = getThreadScratch();
+    std::vector<EVoxelType>& voxels = scratch.paddedVoxels;
+    voxels.assign(paddedDims[0] * paddedDims[1] * paddedDims[2], EVoxelType::None);
+    chunk.forEachNonEmptySectionVoxel([&](const Int3D& coords, EVoxelType type) {
+        voxels[paddedIndex(coords.x, coords.y, coords.z)] = type;
+    });
+
+    {
+        // before/after neighbor per axis
+        const std::array<const Chunk*, 3> beforeChunks = {neighbors[1], neighbors[4], neighbors[3]};
+        const std::array<const Chunk*, 3> afterChunks = {neighbors[0], neighbors[5], neighbors[2]};
+
+        for(int d = 0; d < 3; d++) {
+            const int u = (d+1)%3;
+            const int v = (d+2)%3;
+
+            std::array<int, 3> c;
+            for(c[v] = 0; c[v] < dims[v]; c[v]++) {
+                for(c[u] = 0; c[u] < dims[u]; c[u]++) {
+                    if(beforeChunks[d] != nullptr) {
+                        c[d] = dims[d] - 1;
+                        const EVoxelType type = beforeChunks[d]->getVoxel({c[0], c[1], c[2]});
+                        c[d] = -1;
+                        voxels[paddedIndex(c[0], c[1], c[2])] = type;
+                    }
+                    if(afterChunks[d] != nullptr) {
+                        c[d] = 0;
+                        const EVoxelType type = afterChunks[d]->getVoxel({c[0], c[1], c[2]});
+                        c[d] = dims[d];
+                        voxels[paddedIndex(c[0], c[1], c[2])] = type;
+                    }
+                }
+            }
+        }
+    }
+
+    std::vector<uint8_t>& mask = scratch.faceMask;
+
+    for(int d = 0; d < 3; d++) {
+        const int u = (d+1)%3;
+        const int v = (d+2)%3;
+
+        mask.assign(dims[u] * dims[v], 0);
+
+        std::array<int, 3> x = {0, 0, 0};
+        for(x[d] = sweepMin[d] - 1; x[d] < sweepMax[d]; ) {
+            // one lookup per face, for every type at once
+            // (mask entries outside of the swept rows are never written, and stay 0)
+            for(x[v] = sweepMin[v]; x[v] < sweepMax[v]; x[v]++) {
+                for(x[u] = sweepMin[u]; x[u] < sweepMax[u]; x[u]++) {
+                    const int a = paddedIndex(x[0], x[1], x[2]);
+                    mask[x[u] + x[v] * dims[u]] = faceTable[(int) voxels[a]][(int) voxels[a + strides[d]]];
+                }
+            }
+
+            x[d]++;
+
+            // merge runs of equal codes, i.e. same type and facing
+            int n = 0;
+            for(int j = 0; j < dims[v]; j++) {
+                for(int i = 0; i < dims[u]; ) {
+                    const uint8_t code = mask[n];
+                    if(code == 0) {
+                        i++;
+                        n++;
+                        continue;
+                    }
+
+                    int w = 1;
+                    while(i + w < dims[u] && mask[n + w] == code) {
+                        w++;
+                    }
+
+                    int h = 1;
+                    for(; j + h < dims[v]; h++) {
+                        const uint8_t* row = &mask[n + h * dims[u]];
+                        if(std::any_of(row, row + w, [code](uint8_t c) { return c != code; })) {
+                            break;
+                        }
+                    }
+
+                    for(int l = 0; l < h; l++) {
+                        std::fill_n(&mask[n + l * dims[u]], w, 0);
+                    }
+
+                    x[u] = i;
+                    x[v] = j;
+                    addQuad(chunk, d, x, w, h, (code - 1) & 1, (EVoxelType) ((code - 1) >> 1), outQuads);
+
+                    i += w;
+                    n += w;
+                }
+            }
+        }
+    }
+}
+
+void ChunkMesher::meshPlane(const Chunk& chunk, const ChunkMeshNeighbors& neighbors, int d, int plane, ChunkMeshQuads& outQuads) {
+    const Int3D dimsU = chunk.getDimensions();
+    const std::array<int, 3> dims = {dimsU.x, dimsU.y, dimsU.z};
+    const int u = (d+1)%3;
+    const int v = (d+2)%3;
+    assert(plane >= 0 && plane <= dims[d]);
+
+    // the layers on either side of the plane, from the neighbors on the borders (air if there's none)
+    const int beforeNeighbor[3] = {1, 4, 3};
+    const int afterNeighbor[3] = {0, 5, 2};
+    const Chunk* beforeChunk = plane > 0? &chunk : neighbors[beforeNeighbor[d]];
+    const Chunk* afterChunk = plane < dims[d]? &chunk : neighbors[afterNeighbor[d]];
+    const int beforeLayer = plane > 0? plane - 1 : dims[d] - 1;
+    const int afterLayer = plane < dims[d]? plane : 0;
+
+    // the face on every (u, v) position of the plane, as classifyFace codes (same rules as meshScalar)
+    const FaceTable& faceTable = getFaceTable();
+    assert(dims[u] * dims[v] <= maxPlaneArea);
+    std::array<uint8_t, maxPlaneArea> mask;
+    // bit c set if some face has code c
+    static_assert(2 * numVoxelTypes + 1 <= 64);
+    uint64_t codesPresent = 0;
+    std::array<int, 3> x;
+    for(x[v] = 0; x[v] < dims[v]; x[v]++) {
+        for(x[u] = 0; x[u] < dims[u]; x[u]++) {
+            x[d] = beforeLayer;
+            const EVoxelType before = beforeChunk? beforeChunk->getVoxel({x[0], x[1], x[2]}) : EVoxelType::None;
+            x[d] = afterLayer;
+            const EVoxelType after = afterChunk? afterChunk->getVoxel({x[0], x[1], x[2]}) : EVoxelType::None;
+
+            const uint8_t code = faceTable[(int) before][(int) after];
+            mask[x[u] + x[v] * dims[u]] = code;
+            codesPresent |= uint64_t(1) << code;
+        }
+    }
+
+    // meshScalar's greedy merge, one type at a time: faces of the type merge whatever their facing
+    x[d] = plane;
+    for(const EVoxelType voxelType : meshedVoxelTypes) {
+        // the type's faces are frontCode, and frontCode + 1 when backfacing
+        const uint8_t frontCode = 1 + ((int) voxelType << 1);
+        if(((codesPresent >> frontCode) & 3) == 0) {
+            continue;
+        }
+
+        auto isIncident = [&mask, frontCode](int n) {
+            // (no face is code 0, which wraps around past the range)
+            return (uint8_t) (mask[n] - frontCode) <= 1;
+        };
+
+        int n = 0;
+        for(int j = 0; j < dims[v]; j++) {
+            for(int i = 0; i < dims[u]; ) {
+                if(!isIncident(n)) {
+                    i++;
+                    n++;
+                    continue;
+                }
+
+                int w;
+                for(w = 1; i + w < dims[u] && isIncident(n + w); w++) {
+                }
+
+                int h;
+                bool done = false;
+                for(h = 1; j + h < dims[v]; h++) {
+                    for(int k = 0; k < w; k++) {
+                        if(!isIncident(n + k + h * dims[u])) {
+                            done = true;
+                            break;
+                        }
+                    }
+                    if(done) {
+                        break;
+                    }
+                }
+
+                x[u] = i;
+                x[v] = j;
+                addQuad(chunk, d, x, w, h, (mask[n] - 1) & 1, voxelType, outQuads);
+
+                for(int l = 0; l < h; l++) {
+                    std::fill_n(&mask[n + l * dims[u]], w, 0);
+                }
+
+                i += w;
+                n += w;
+            }
+        }
+    }
+}
+
+void ChunkMesher::readPaddedLayer(const Chunk& chunk, const ChunkMeshNeighbors& neighbors, int d, int layer, PaddedLayer& outLayer) {
+    const Int3D dimsU = chunk.getDimensions();
+    const std::array<int, 3> dims = {dimsU.x, dimsU.y, dimsU.z};
+    const int u = (d+1)%3;
+    const int v = (d+2)%3;
+    assert(layer >= -1 && layer <= dims[d]);
+    assert((dims[u] + 2) * (dims[v] + 2) <= (int) outLayer.size());
+
+    const int beforeNeighbor[3] = {1, 4, 3};
+    const int afterNeighbor[3] = {0, 5, 2};
+    const int stride = dims[u] + 2;
+    std::fill_n(outLayer.begin(), stride * (dims[v] + 2), EVoxelType::None);
+
+    // the voxels at (u, v) of layer in the chunk or a neighbor, written to the padded (u, v)
+    auto readRect = [&](const Chunk* source, int sourceLayer, int uBegin, int uEnd, int vBegin, int vEnd, int uOffset, int vOffset) {
+        if(source == nullptr) {
+            return;
+        }
+        std::array<int, 3> x;
+        x[d] = sourceLayer;
+        for(x[v] = vBegin; x[v] < vEnd; x[v]++) {
+            for(x[u] = uBegin; x[u] < uEnd; x[u]++) {
+                outLayer[(x[u] + uOffset + 1) + (x[v] + vOffset + 1) * stride] = source->getVoxel({x[0], x[1], x[2]});
+            }
+        }
+    };
+
+    if(layer < 0 || layer == dims[d]) {
+        // a neighbor's layer, whose ring would be in the diagonal chunks: left as air
+        const Chunk* source = layer < 0? neighbors[beforeNeighbor[d]] : neighbors[afterNeighbor[d]];
+        readRect(source, layer < 0? dims[d] - 1 : 0, 0, dims[u], 0, dims[v], 0, 0);
+        return;
+    }
+
+    readRect(&chunk, layer, 0, dims[u], 0, dims[v], 0, 0);
+    // the ring, from the neighbors along u and v (the corners are air)
+    readRect(neighbors[beforeNeighbor[u]], layer, dims[u] - 1, dims[u], 0, dims[v], -dims[u], 0);
+    readRect(neighbors[afterNeighbor[u]], layer, 0, 1, 0, dims[v], dims[u], 0);
+    readRect(neighbors[beforeNeighbor[v]], layer, 0, dims[u], dims[v] - 1, dims[v], 0, -dims[v]);
+    readRect(neighbors[afterNeighbor[v]], layer, 0, dims[u], 0, 1, 0, dims[v]);
+}
+
+void ChunkMesher::meshPlaneAOBetween(const Chunk& chunk, int d, int plane, const PaddedLayer& before, const PaddedLayer& after,
+                                     ChunkMeshQuads& outQuads) {
+    const Int3D dimsU = chunk.getDimensions();
+    const std::array<int, 3> dims = {dimsU.x, dimsU.y, dimsU.z};
+    const int u = (d+1)%3;
+    const int v = (d+2)%3;
+    const int stride = dims[u] + 2;
+
+    auto isOccluder = [](EVoxelType type) {
+        return type != EVoxelType::None && type != EVoxelType::Water;
+    };
+
+    // Every face of the plane as its classifyFace code, with the occlusion level of its 4 corners (2 bits
+    // each, corners in addQuad's x, x + w, x + w + h, x + h order) in the high byte, so that faces only
+    // merge when they'd be shaded the same.
+    const FaceTable& faceTable = getFaceTable();
+    assert(dims[u] * dims[v] <= maxPlaneArea);
+    std::array<uint16_t, maxPlaneArea> mask;
+    // direction of each corner from the face's center, along u and v
+    static const int cornerU[4] = {-1, 1, 1, -1};
+    static const int cornerV[4] = {-1, -1, 1, 1};
+    for(int j = 0; j < dims[v]; j++) {
+        for(int i = 0; i < dims[u]; i++) {
+            const int pi = (i + 1) + (j + 1) * stride;
+            const uint8_t code = faceTable[(int) before[pi]][(int) after[pi]];
+            uint16_t value = code;
+            if(code != 0 && (EVoxelType) ((code - 1) >> 1) != EVoxelType::Water) {
+                // the voxels in front of the face (a backface is open towards the layer after the plane)
+                const PaddedLayer& open = (code - 1) & 1? after : before;
+                for(int k = 0; k < 4; k++) {
+                    const int side1 = isOccluder(open[pi + cornerU[k]]);
+                    const int side2 = isOccluder(open[pi + cornerV[k] * stride]);
+                    const int corner = isOccluder(open[pi + cornerU[k] + cornerV[k] * stride]);
+                    // two sides hide the corner voxel entirely
+                    const int level = side1 && side2? 0 : 3 - (side1 + side2 + corner);
+                    value |= level << (8 + 2 * k);
+                }
+            }
+            else if(code != 0) {
+                // water isn't occluded
+                value |= 0xFF << 8;
+            }
+            mask[i + j * dims[u]] = value;
+        }
+    }
+
+    // greedy merge of identical faces, in SinglePass order
+    std::array<int, 3> x;
+    x[d] = plane;
+    int n = 0;
+    for(int j = 0; j < dims[v]; j++) {
+        for(int i = 0; i < dims[u]; ) {
+            const uint16_t value = mask[n];
+            if(value == 0) {
+                i++;
+                n++;
+                continue;
+            }
+
+            int w;
+            for(w = 1; i + w < dims[u] && mask[n + w] == value; w++) {
+            }
+
+            int h;
+            bool done = false;
+            for(h = 1; j + h < dims[v]; h++) {
+                for(int k = 0; k < w; k++) {
+                    if(mask[n + k + h * dims[u]] != value) {
+                        done = true;
+                        break;
+                    }
+                }
+                if(done) {
+                    break;
+                }
+            }
+
+            const uint8_t code = value & 0xFF;
+            std::array<uint8_t, 4> aoLevels;
+            for(int k = 0; k < 4; k++) {
+                aoLevels[k] = (value >> (8 + 2 * k)) & 3;
+            }
+            x[u] = i;
+            x[v] = j;
+            addQuad(chunk, d, x, w, h, (code - 1) & 1, (EVoxelType) ((code - 1) >> 1), outQuads, aoLevels);
+
+            for(int l = 0; l < h; l++) {
+                std::fill_n(&mask[n + l * dims[u]], w, 0);
+            }
+
+            i += w;
+            n += w;
+        }
+    }
+}
+
+void ChunkMesher::meshPlaneAO(const Chunk& chunk, const ChunkMeshNeighbors& neighbors, int d, int plane, ChunkMeshQuads& outQuads) {
+    PaddedLayer before;
+    PaddedLayer after;
+    readPaddedLayer(chunk, neighbors, d, plane - 1, before);
+    readPaddedLayer(chunk, neighbors, d, plane, after);
+    meshPlaneAOBetween(chunk, d, plane, before, after, outQuads);
+}
+
+void ChunkMesher::meshBakedAO(const Chunk& chunk, const ChunkMeshNeighbors& neighbors, ChunkMeshQuads& outQuads) {
+    std::array<int, 3> sweepMin;
+    std::array<int, 3> sweepMax;
+    if(!findSweepRange(chunk, neighbors, sweepMin, sweepMax)) {
+        return;
+    }
+
+    // every layer is read once, the one after a plane is the one before the next. Only the planes in
+    // the sweep range can have faces
+    PaddedLayer layers[2];
+    for(int d = 0; d < 3; d++) {
+        int cur = 0;
+        readPaddedLayer(chunk, neighbors, d, sweepMin[d] - 1, layers[cur]);
+        for(int p = sweepMin[d]; p <= sweepMax[d]; p++) {
+            readPaddedLayer(chunk, neighbors, d, p, layers[cur ^ 1]);
+            meshPlaneAOBetween(chunk, d, p, layers[cur], layers[cur ^ 1], outQuads);
+            cur ^= 1;
+        }
+    }
+}
+
+void ChunkMesher::meshPlanes(const Chunk& chunk, const ChunkMeshNeighbors& neighbors, ChunkMeshPlanes& outPlanes, bool bakeAO) {
+    outPlanes.init(chunk.getDimensions());
+    for(int d = 0; d < 3; d++) {
+        for(int p = 0; p < (int) outPlanes.planes[d].size(); p++) {
+            if(bakeAO) {
+                meshPlaneAO(chunk, neighbors, d, p, outPlanes.planes[d][p]);
+            }
+            else {
+                meshPlane(chunk, neighbors, d, p, outPlanes.planes[d][p]);
+            }
+        }
+    }
+}
+
+void ChunkMesher::remeshDirtyPlanes(const Chunk& chunk, const ChunkMeshNeighbors& neighbors,
+                                    const ChunkMeshDirtyPlanes& dirtyPlanes, ChunkMeshPlanes& inOutPlanes, bool bakeAO) {
+    for(int d = 0; d < 3; d++) {
+        uint64_t bits = dirtyPlanes.planeBits[d];
+        while(bits != 0) {
+            const int p = std::countr_zero(bits);
+            bits &= bits - 1;
+
+            assert(p < (int) inOutPlanes.planes[d].size());
+            ChunkMeshQuads& plane = inOutPlanes.planes[d][p];
+            plane.clear();
+            if(bakeAO) {
+                meshPlaneAO(chunk, neighbors, d, p, plane);
+            }
+            else {
+                meshPlane(chunk, neighbors, d, p, plane);
+            }
+        }
+    }
+}
+
+EVoxelType ChunkMesher::sampleLODCell(const Chunk& chunk, int cellSize, const std::array<int, 3>& origin) {
+    bool hasWater = false;
+    for(int y = origin[1] + cellSize - 1; y >= origin[1]; y--) {
+        for(int x = origin[0]; x < origin[0] + cellSize; x++) {
+            for(int z = origin[2]; z < origin[2] + cellSize; z++) {
+                const EVoxelType type = chunk.getVoxel({x, y, z});
+                if(type == EVoxelType::Water) {
+                    hasWater = true;
+                }
+                else if(type != EVoxelType::None) {
+                    // (solid types that aren't greedy-meshed, e.g. lamps, would leave a hole)
+                    const bool isMeshed = std::find(meshedVoxelTypes.begin(), meshedVoxelTypes.end(), type) != meshedVoxelTypes.end();
+                    return isMeshed? type : EVoxelType::Stone;
+                }
+            }
+        }
+    }
+    return hasWater? EVoxelType::Water : EVoxelType::None;
+}
+
+void ChunkMesher::meshLOD(const Chunk& chunk, const ChunkMeshNeighbors& neighbors, int lod, ChunkMeshQuads& outQuads) {
+    assert(lod >= 1 && lod <= maxLOD);
+    const int cellSize = 1 << lod;
+    const Int3D dimsU = chunk.getDimensions();
+    const std::array<int, 3> dims = {dimsU.x / cellSize, dimsU.y / cellSize, dimsU.z / cellSize};
+    assert(dims[0] * cellSize == dimsU.x && dims[1] * cellSize == dimsU.y && dims[2] * cellSize == dimsU.z);
+
+    // the chunk's cells, plus the layers of cells of the chunks below and above bordering it (y = -1 and dims[1])
+    const int paddedHeight = dims[1] + 2;
+    ChunkMeshScratch& scratch = getThreadScratch();
+    std::vector<EVoxelType>& cells = scratch.paddedVoxels;
+    cells.assign(dims[0] * paddedHeight * dims[2], EVoxelType::None);
+    auto cellIndex = [&](int x, int y, int z) { return (x * paddedHeight + y + 1) * dims[2] + z; };
+
+    for(int x = 0; x < dims[0]; x++) {
+        for(int z = 0; z < dims[2]; z++) {
+            for(int y = 0; y < dims[1]; y++) {
+                cells[cellIndex(x, y, z)] = sampleLODCell(chunk, cellSize, {x * cellSize, y * cellSize, z * cellSize});
+            }
+            if(neighbors[4]) {
+                cells[cellIndex(x, -1, z)] = sampleLODCell(*neighbors[4], cellSize, {x * cellSize, dimsU.y - cellSize, z * cellSize});
+            }
+            if(neighbors[5]) {
+                cells[cellIndex(x, dims[1], z)] = sampleLODCell(*neighbors[5], cellSize, {x * cellSize, 0, z * cellSize});
+            }
+        }
+    }
+
+    // cells past the -x/+x/-z/+z borders are air
+    auto cellAt = [&](const std::array<int, 3>& x) {
+        if(x[0] < 0 || x[0] >= dims[0] || x[2] < 0 || x[2] >= dims[2]) {
+            return EVoxelType::None;
+        }
+        return cells[cellIndex(x[0], x[1], x[2])];
+    };
+
+    const FaceTable& faceTable = getFaceTable();
+    std::vector<uint8_t>& mask = scratch.faceMask;
+    for(int d = 0; d < 3; d++) {
+        const int u = (d+1)%3;
+        const int v = (d+2)%3;
+        mask.resize(dims[u] * dims[v]);
+
+        std::array<int, 3> x;
+        for(int plane = 0; plane <= dims[d]; plane++) {
+            for(x[v] = 0; x[v] < dims[v]; x[v]++) {
+                for(x[u] = 0; x[u] < dims[u]; x[u]++) {
+                    x[d] = plane - 1;
+                    const EVoxelType before = cellAt(x);
+                    x[d] = plane;
+                    const EVoxelType after = cellAt(x);
+                    mask[x[u] + x[v] * dims[u]] = faceTable[(int) before][(int) after];
+                }
+            }
+
+            // greedy merge of the faces with the same code, i.e. type and facing
+            int n = 0;
+            for(int j = 0; j < dims[v]; j++) {
+                for(int i = 0; i < dims[u]; ) {
+                    const uint8_t code = mask[n];
+                    if(code == 0) {
+                        i++;
+                        n++;
+                        continue;
+                    }
+
+                    int w;
+                    for(w = 1; i + w < dims[u] && mask[n + w] == code; w++) {
+                    }
+
+                    int h;
+                    bool done = false;
+                    for(h = 1; j + h < dims[v]; h++) {
+                        for(int k = 0; k < w; k++) {
+                            if(mask[n + k + h * dims[u]] != code) {
+                                done = true;
+                                break;
+                            }
+                        }
+                        if(done) {
+                            break;
+                        }
+                    }
+
+                    // in the chunk's voxel units
+                    std::array<int, 3> origin;
+                    origin[d] = plane * cellSize;
+                    origin[u] = i * cellSize;
+                    origin[v] = j * cellSize;
+                    addQuad(chunk, d, origin, w * cellSize, h * cellSize, (code - 1) & 1, (EVoxelType) ((code - 1) >> 1), outQuads);
+
+                    for(int l = 0; l < h; l++) {
+                        std::fill_n(&mask[n + l * dims[u]], w, 0);
+                    }
+
+                    i += w;
+                    n += w;
+                }
+            }
+        }
+    }
+}
+
+void ChunkMesher::writeVertices(const std::vector<ChunkMeshQuad>& quads, const std::map<EVoxelType, VoxelAtlasEntry>& atlas,
+                                EChunkVertexLayout layout, std::vector<VertexData>& outVertices) {
+    appendVertices(quads, atlas, layout, -1, outVertices);
+}
+
+void ChunkMesher::writeVerticesFacing(const std::vector<ChunkMeshQuad>& quads, int direction, const std::map<EVoxelType, VoxelAtlasEntry>& atlas,
+                                      EChunkVertexLayout layout, std::vector<VertexData>& outVertices) {
+    assert(direction >= 0 && direction < numChunkFaceDirections);
+    appendVertices(quads, atlas, layout, direction, outVertices);
+}
+
+void ChunkMesher::appendVertices(const std::vector<ChunkMeshQuad>& quads, const std::map<EVoxelType, VoxelAtlasEntry>& atlas,
+                                 EChunkVertexLayout layout, int direction, std::vector<VertexData>& outVertices) {
+    const simd::float3 defaultColorScale {0,0,0};
+    if(direction < 0) {
+        outVertices.reserve(outVertices.size() + quads.size() * (layout == EChunkVertexLayout::IndexedQuads? 4 : 6));
+    }
+
+    for(const ChunkMeshQuad& q : quads) {
+        const int normalIndex = packedNormalIndex(q.normal);
+        if(direction >= 0 && normalIndex != direction) {
+            continue;
+        }
+        const auto entry = atlas.find(q.vxType);
+        if(entry == atlas.end()) {
+            continue;
+        }
+
+        // rely on correct vertex-ordering for texture orientation,
+        // as we treat these uv coords as a front-face for all faces.
+        const int atlasIndex = atlasIndexForNormal(entry->second, normalIndex);
+
+        const simd::float2 uvs[4] = {{0.0, 0.0}, {q.width, 0.0}, {q.width, q.height}, {0.0, q.height}};
+        const int first = flipsDiagonal(q)? 1 : 0;
+        std::array<VertexData, 4> corners;
+        for(int i = 0; i < 4; i++) {
+            const int c = (first + i) % 4;
+            corners[i] = VertexData{q.positions[c], uvs[c], q.normal, atlasIndex, voxelOcclusionOfLevel[q.aoLevels[c]], defaultColorScale};
+        }
+        appendQuadCorners(corners, layout, outVertices);
+    }
+}
+
+void ChunkMesher::writePackedVertices(const Chunk& chunk, const std::vector<ChunkMeshQuad>& quads,
+                                      const std::map<EVoxelType, VoxelAtlasEntry>& atlas, int paletteIndex,
+                                      EChunkVertexLayout layout, std::vector<PackedVoxelVertex>& outVertices) {
+    const simd::float4 chunkPosition = chunk.getPositionAsFloat4();
+    outVertices.reserve(outVertices.size() + quads.size() * (layout == EChunkVertexLayout::IndexedQuads? 4 : 6));
+
+    for(const ChunkMeshQuad& q : quads) {
+        const auto entry = atlas.find(q.vxType);
+        if(entry == atlas.end()) {
+            continue;
+        }
+
+        const int normalIndex = packedNormalIndex(q.normal);
+        const int atlasIndex = atlasIndexForNormal(entry->second, normalIndex);
+        const int width = packedVoxelCoord(q.width);
+        const int height = packedVoxelCoord(q.height);
+
+        std::array<PackedVoxelVertex, 4> corners;
+        const int uvs[4][2] = {{0, 0}, {width, 0}, {width, height}, {0, height}};
+        const int first = flipsDiagonal(q)? 1 : 0;
+        for(int i = 0; i < 4; i++) {
+            const int c = (first + i) % 4;
+            const simd::float4 local = q.positions[c] - chunkPosition;
+            corners[i] = encodePackedVoxelVertex({packedVoxelCoord(local.x), packedVoxelCoord(local.y), packedVoxelCoord(local.z),
+                                                  uvs[c][0], uvs[c][1], normalIndex, atlasIndex, paletteIndex, q.aoLevels[c]});
+        }
+        appendQuadCorners(corners, layout, outVertices);
+    }
+}
+
+bool ChunkMesher::flipsDiagonal(const ChunkMeshQuad& quad) {
+    // split along the darker diagonal, so a single occluded corner darkens both triangles alike
+    return quad.aoLevels[0] + quad.aoLevels[2] > quad.aoLevels[1] + quad.aoLevels[3];
+}
+
+void ChunkMesher::writeQuadIndices(size_t numQuads, std::vector<uint32_t>& outIndices) {
+    outIndices.reserve(outIndices.size() + numQuads * quadIndexPattern.size());
+    for(size_t q = 0; q < numQuads; q++) {
+        for(const uint32_t i : quadIndexPattern) {
+            outIndices.push_back((uint32_t) (q * 4) + i);
+        }
+    }
+}
+
+void ChunkMesher::writeSortedQuadIndices(const std::vector<uint32_t>& quadOrder, EChunkVertexLayout layout, std::vector<uint32_t>& outIndices) {
+    outIndices.reserve(outIndices.size() + quadOrder.size() * quadIndexPattern.size());
+    for(const uint32_t q : quadOrder) {
+        if(layout == EChunkVertexLayout::IndexedQuads) {
+            for(const uint32_t i : quadIndexPattern) {
+                outIndices.push_back(q * 4 + i);
+            }
+        }
+        else {
+            for(uint32_t i = 0; i < 6; i++) {
+                outIndices.push_back(q * 6 + i);
+            }
+        }
+    }
+}
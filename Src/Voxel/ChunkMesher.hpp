@@ -0,0 +1,353 @@
+#pragma once
+#include <array>
+#include <vector>
+#include <map>
+#include <cstdint>
+#include <cassert>
+#include <simd/simd.h>
+#import "Voxel/VoxelTypes.hpp"
+#import "Voxel/PackedVoxelVertex.hpp"
+#import "Voxel/ChunkFaceDirections.hpp"
+
+// a greedy-merged face, covering width x height voxel faces of one type
+struct ChunkMeshQuad {
+    std::array<simd::float4, 4> positions; // world-space positions, counter-clockwise
+    simd::float3 normal;
+    float width;
+    float height;
+    EVoxelType vxType;
+    // ambient occlusion level of each corner (0, the most occluded, to 3, none), only baked by EChunkMesher::BakedAO
+    std::array<uint8_t, 4> aoLevels = {3, 3, 3, 3};
+};
+
+struct ChunkMeshQuads {
+    std::vector<ChunkMeshQuad> opaque;
+    std::vector<ChunkMeshQuad> water;
+
+    void clear() {
+        opaque.clear();
+        water.clear();
+    }
+};
+
+// A chunk's quads, split by the plane they lie on. Plane p of axis d holds the faces between the
+// voxel layers p-1 and p along d, so planes 0 and dims[d] are the borders with the neighbors.
+// Kept for chunks being edited, so an edit only re-meshes the planes it touches (see ChunkMeshDirtyPlanes).
+struct ChunkMeshPlanes {
+    // planes[d][p], p in [0, dims[d]]
+    std::array<std::vector<ChunkMeshQuads>, 3> planes;
+
+    void init(const Int3D& dims) {
+        const std::array<int, 3> size = {dims.x, dims.y, dims.z};
+        for(int d = 0; d < 3; d++) {
+            planes[d].assign(size[d] + 1, ChunkMeshQuads());
+        }
+    }
+
+    // appends every plane's quads, by axis then plane
+    void gatherQuads(ChunkMeshQuads& outQuads) const {
+        for(const std::vector<ChunkMeshQuads>& axisPlanes : planes) {
+            for(const ChunkMeshQuads& plane : axisPlanes) {
+                outQuads.opaque.insert(outQuads.opaque.end(), plane.opaque.begin(), plane.opaque.end());
+                outQuads.water.insert(outQuads.water.end(), plane.water.begin(), plane.water.end());
+            }
+        }
+    }
+
+    size_t getNumQuads() const {
+        size_t num = 0;
+        for(const std::vector<ChunkMeshQuads>& axisPlanes : planes) {
+            for(const ChunkMeshQuads& plane : axisPlanes) {
+                num += plane.opaque.size() + plane.water.size();
+            }
+        }
+        return num;
+    }
+};
+
+// the ChunkMeshPlanes that voxel edits made stale, one bit per plane of each axis
+struct ChunkMeshDirtyPlanes {
+    std::array<uint64_t, 3> planeBits = {0, 0, 0};
+
+    void markPlane(int d, int plane) {
+        assert(plane >= 0 && plane < 64);
+        planeBits[d] |= uint64_t(1) << plane;
+    }
+    bool isPlaneDirty(int d, int plane) const { return (planeBits[d] >> plane) & 1; }
+    bool isDirty() const { return (planeBits[0] | planeBits[1] | planeBits[2]) != 0; }
+    void clear() { planeBits = {0, 0, 0}; }
+
+    // Marks the planes that an edit of the voxel at coords (in a chunk of size dims) changes: the two
+    // on either side of it along every axis. The border planes are also meshed by the neighbor on that
+    // side, so voxels on a border mark the neighbor's plane too (neighborPlanes is in
+    // Int3D::getAllNeighbors order, +x, -x, +z, -z, -y, +y).
+    // With bakeAO, the voxel also occludes the corners of the neighbors' faces along the border, so a
+    // voxel on a border marks the neighbor's planes along the other two axes as well.
+    static void markVoxelEdit(const Int3D& dims, const Int3D& coords,
+                              ChunkMeshDirtyPlanes& chunkPlanes, std::array<ChunkMeshDirtyPlanes, 6>& neighborPlanes,
+                              bool bakeAO = false) {
+        const std::array<int, 3> size = {dims.x, dims.y, dims.z};
+        const std::array<int, 3> c = {coords.x, coords.y, coords.z};
+        // the neighbors before/after the chunk along each axis
+        const int beforeNeighbor[3] = {1, 4, 3};
+        const int afterNeighbor[3] = {0, 5, 2};
+
+        for(int d = 0; d < 3; d++) {
+            chunkPlanes.markPlane(d, c[d]);
+            chunkPlanes.markPlane(d, c[d] + 1);
+
+            if(c[d] == 0) {
+                neighborPlanes[beforeNeighbor[d]].markPlane(d, size[d]);
+            }
+            if(c[d] == size[d] - 1) {
+                neighborPlanes[afterNeighbor[d]].markPlane(d, 0);
+            }
+        }
+
+        if(!bakeAO) {
+            return;
+        }
+        for(int a = 0; a < 3; a++) {
+            if(c[a] != 0 && c[a] != size[a] - 1) {
+                continue;
+            }
+            for(int d = 0; d < 3; d++) {
+                if(d == a) {
+                    continue;
+                }
+                if(c[a] == 0) {
+                    neighborPlanes[beforeNeighbor[a]].markPlane(d, c[d]);
+                    neighborPlanes[beforeNeighbor[a]].markPlane(d, c[d] + 1);
+                }
+                if(c[a] == size[a] - 1) {
+                    neighborPlanes[afterNeighbor[a]].markPlane(d, c[d]);
+                    neighborPlanes[afterNeighbor[a]].markPlane(d, c[d] + 1);
+                }
+            }
+        }
+    }
+};
+
+// the chunks around the one being meshed, in Int3D::getAllNeighbors order (+x, -x, +z, -z, -y, +y).
+// nullptr is meshed against as air (e.g. the levels above/below the world)
+typedef std::array<const Chunk*, 6> ChunkMeshNeighbors;
+
+enum class EChunkMesher {
+    // builds a mask per slice one voxel pair at a time, with a full sweep per voxel type
+    Scalar,
+    // reads each voxel once into per-type occupancy bit columns, derives the faces with shifts and
+    // ANDs, and merges quads with bit scans
+    Bitmask,
+    // classifies every face once (its voxel type and facing) in a single sweep per axis, whatever the
+    // number of voxel types, and only merges faces of the same type and facing
+    SinglePass,
+    // meshes plane by plane like ChunkMesher::meshPlane, classifying faces like SinglePass, and bakes the
+    // ambient occlusion of every corner from the 3 voxels around it on the face's open side (the
+    // voxels of the diagonal chunks, which the mesher doesn't have, count as air). Faces are only
+    // merged with faces of the same type, facing and corner occlusion
+    BakedAO,
+};
+
+// how the vertex writers lay out a quad's vertices
+enum class EChunkVertexLayout {
+    // 6 vertices per quad (two triangles, corners 0 and 2 repeated), drawn as is
+    Triangles,
+    // the 4 corners per quad, drawn with an index buffer repeating ChunkMesher::quadIndexPattern
+    // (offset by 4 per quad), which every chunk shares
+    IndexedQuads,
+};
+
+// Reusable buffers for meshing chunks: the temporaries of the meshers, and the quads, vertices etc.
+// the engine builds from their output. Users clear the buffers they use, which keeps their capacity, so
+// once a thread has meshed its largest chunk (the high-water mark) meshing stops allocating.
+// One per thread, see ChunkMesher::getThreadScratch.
+struct ChunkMeshScratch {
+    // a face of meshScalar's mask
+    struct ScalarMaskData {
+        ScalarMaskData() = default;
+        ScalarMaskData(bool incident, bool isBackface)
+        : incident(incident), isBackface(isBackface) {};
+
+        bool incident = false;
+        bool isBackface = false;
+    };
+
+    // mesher temporaries
+    std::vector<EVoxelType> voxelTypes;
+    std::vector<ScalarMaskData> scalarMask;
+    std::array<std::array<std::vector<uint64_t>, numVoxelTypes>, 3> occupancy;
+    std::array<std::vector<uint64_t>, 3> air;
+    std::vector<uint64_t> incidentRows;
+    std::vector<uint64_t> backfaceRows;
+    std::vector<EVoxelType> paddedVoxels;
+    std::vector<uint8_t> faceMask;
+
+    // for the engine
+    ChunkMeshQuads quads;
+    std::vector<VertexData> chunkVertices;
+    std::vector<VertexData> transparentVertices;
+    std::vector<VertexData> lampVertices;
+    std::vector<simd::float3> transparentCentroids;
+
+    // calls f(buffer) with each of the buffers above, e.g. to see which ones had to grow
+    template<typename F>
+    void forEachBuffer(F&& f) const {
+        f(voxelTypes);
+        f(scalarMask);
+        for(const auto& axisOccupancy : occupancy) {
+            for(const std::vector<uint64_t>& typeOccupancy : axisOccupancy) {
+                f(typeOccupancy);
+            }
+        }
+        for(const std::vector<uint64_t>& axisAir : air) {
+            f(axisAir);
+        }
+        f(incidentRows);
+        f(backfaceRows);
+        f(paddedVoxels);
+        f(faceMask);
+        f(quads.opaque);
+        f(quads.water);
+        f(chunkVertices);
+        f(transparentVertices);
+        f(lampVertices);
+        f(transparentCentroids);
+    }
+};
+
+// Greedy meshing of a chunk's terrain voxels (lamps etc. are meshed by the engine).
+//
+// Scalar and Bitmask output exactly the same quads in the same order: by type (meshedVoxelTypes order),
+// then axis, then slice along the axis, then row, then column. Their quads can merge faces of opposite
+// facing (the quad takes its first face's).
+//
+// SinglePass covers the same faces with the same visibility rules, but never merges faces of different
+// facing, and outputs quads by axis, then slice, then row, then column (so all types interleaved).
+// BakedAO outputs quads in the same order as SinglePass, split further where the occlusion changes.
+//
+// The meshers' temporaries are the calling thread's ChunkMeshScratch buffers.
+class ChunkMesher {
+public:
+    // the calling thread's scratch buffers (the meshers use them too, see ChunkMeshScratch for which)
+    static ChunkMeshScratch& getThreadScratch();
+
+    // the voxel types that are greedy-meshed, in the order their quads are output
+    static const std::array<EVoxelType, 4> meshedVoxelTypes;
+
+    // the triangles of a quad, as indices into its corners
+    static const std::array<uint32_t, 6> quadIndexPattern;
+
+    // the coarsest level of detail meshLOD builds (cells of 4x4x4 voxels)
+    static constexpr int maxLOD = 2;
+
+    static void mesh(EChunkMesher mesher, const Chunk& chunk, const ChunkMeshNeighbors& neighbors, ChunkMeshQuads& outQuads);
+
+    static void meshScalar(const Chunk& chunk, const ChunkMeshNeighbors& neighbors, ChunkMeshQuads& outQuads);
+    static void meshBitmask(const Chunk& chunk, const ChunkMeshNeighbors& neighbors, ChunkMeshQuads& outQuads);
+    static void meshSinglePass(const Chunk& chunk, const ChunkMeshNeighbors& neighbors, ChunkMeshQuads& outQuads);
+    static void meshBakedAO(const Chunk& chunk, const ChunkMeshNeighbors& neighbors, ChunkMeshQuads& outQuads);
+
+    // Meshes plane p of axis d alone (see ChunkMeshPlanes), appending exactly the quads that
+    // meshScalar/meshBitmask output on that plane, in the same order.
+    static void meshPlane(const Chunk& chunk, const ChunkMeshNeighbors& neighbors, int d, int plane, ChunkMeshQuads& outQuads);
+
+    // meshPlane, with exactly the quads meshBakedAO outputs on that plane
+    static void meshPlaneAO(const Chunk& chunk, const ChunkMeshNeighbors& neighbors, int d, int plane, ChunkMeshQuads& outQuads);
+
+    // (re-)meshes every plane of the chunk into outPlanes, with meshPlaneAO if bakeAO
+    static void meshPlanes(const Chunk& chunk, const ChunkMeshNeighbors& neighbors, ChunkMeshPlanes& outPlanes, bool bakeAO = false);
+
+    // re-meshes only the dirty planes of inOutPlanes, replacing their quads
+    static void remeshDirtyPlanes(const Chunk& chunk, const ChunkMeshNeighbors& neighbors,
+                                  const ChunkMeshDirtyPlanes& dirtyPlanes, ChunkMeshPlanes& inOutPlanes, bool bakeAO = false);
+
+    // Meshes the chunk at level of detail lod (1 to maxLOD), i.e. as a grid of cells of 2^lod voxels per
+    // side, with quads in the chunk's voxel units. A cell is the top-most solid voxel in it (water if it
+    // only has water and air), so the cells always cover the chunk's solid voxels. The cells along the
+    // -x/+x/-z/+z borders are meshed against air: those walls close the seams with neighbors drawn at
+    // another lod, whatever their lod. The chunks below/above are sampled the same way.
+    // Faces are only merged with faces of the same type and facing, like meshSinglePass.
+    static void meshLOD(const Chunk& chunk, const ChunkMeshNeighbors& neighbors, int lod, ChunkMeshQuads& outQuads);
+
+    // Appends the quads as VertexData (world-space, with no colour scale). Quads whose type isn't in
+    // atlas are skipped.
+    static void writeVertices(const std::vector<ChunkMeshQuad>& quads, const std::map<EVoxelType, VoxelAtlasEntry>& atlas,
+                              EChunkVertexLayout layout, std::vector<VertexData>& outVertices);
+
+    // writeVertices for the quads facing direction (see ChunkFaceDirections.hpp) only, so a buffer can be
+    // built one direction after the other, see ChunkFaceRanges
+    static void writeVerticesFacing(const std::vector<ChunkMeshQuad>& quads, int direction, const std::map<EVoxelType, VoxelAtlasEntry>& atlas,
+                                    EChunkVertexLayout layout, std::vector<VertexData>& outVertices);
+
+    // Appends the chunk's quads as PackedVoxelVertex, with the same corners and order as writeVertices
+    static void writePackedVertices(const Chunk& chunk, const std::vector<ChunkMeshQuad>& quads,
+                                    const std::map<EVoxelType, VoxelAtlasEntry>& atlas, int paletteIndex,
+                                    EChunkVertexLayout layout, std::vector<PackedVoxelVertex>& outVertices);
+
+    // appends quadIndexPattern for quads [0, numQuads) of an IndexedQuads vertex buffer
+    static void writeQuadIndices(size_t numQuads, std::vector<uint32_t>& outIndices);
+
+    // appends the indices that draw the quads of a vertex buffer in layout in quadOrder's order (6 per
+    // quad in both layouts), e.g. back to front (see TransparentQuadSorter)
+    static void writeSortedQuadIndices(const std::vector<uint32_t>& quadOrder, EChunkVertexLayout layout, std::vector<uint32_t>& outIndices);
+
+private:
+    // meshedVoxelTypes that are in the chunk, or on the neighbor faces bordering it (their voxels
+    // are compared against this chunk's border voxels), i.e. the only types that can produce quads
+    static void findTypesToMesh(const Chunk& chunk, const ChunkMeshNeighbors& neighbors, std::vector<EVoxelType>& outTypes);
+
+    // the range of rows that can have faces, see meshScalar. Returns false if there can't be any
+    static bool findSweepRange(const Chunk& chunk, const ChunkMeshNeighbors& neighbors,
+                               std::array<int, 3>& outSweepMin, std::array<int, 3>& outSweepMax);
+
+    // The face between voxel a and the voxel b after it along an axis, as 0 (no face) or
+    // 1 + (type << 1 | isBackface). At most one of the meshed types can have a face there.
+    static uint8_t classifyFace(EVoxelType a, EVoxelType b);
+
+    // classifyFace for every pair of types, so classifying a face is a single lookup
+    typedef std::array<std::array<uint8_t, numVoxelTypes>, numVoxelTypes> FaceTable;
+    static const FaceTable& getFaceTable();
+
+    // the largest plane meshPlane handles (ChunkMeshDirtyPlanes limits chunks to 63 voxels per axis)
+    static constexpr int maxPlaneArea = 63 * 63;
+
+    // A layer of voxels along an axis d, with the ring of voxels around it along the other two axes u and
+    // v (from the neighbors, air at the corners or when the layer is a neighbor's), i.e. the voxels
+    // meshPlaneAO reads for the occlusion. (u, v) is at (u + 1) + (v + 1) * (dims[u] + 2)
+    typedef std::array<EVoxelType, 65 * 65> PaddedLayer;
+    static void readPaddedLayer(const Chunk& chunk, const ChunkMeshNeighbors& neighbors, int d, int layer, PaddedLayer& outLayer);
+
+    // meshPlaneAO, between the layers before and after the plane
+    static void meshPlaneAOBetween(const Chunk& chunk, int d, int plane, const PaddedLayer& before, const PaddedLayer& after,
+                                   ChunkMeshQuads& outQuads);
+
+    // the cell of meshLOD with its lowest voxel at origin, cellSize voxels per side
+    static EVoxelType sampleLODCell(const Chunk& chunk, int cellSize, const std::array<int, 3>& origin);
+
+    // the quad starting at x (x[d] is the slice right after the face), spanning w along axis (d+1)%3
+    // and h along axis (d+2)%3
+    // and the ambient occlusion of the corners x, x + w, x + w + h, x + h
+    static void addQuad(const Chunk& chunk, int d, const std::array<int, 3>& x, int w, int h,
+                        bool isBackface, EVoxelType voxelType, ChunkMeshQuads& outQuads,
+                        const std::array<uint8_t, 4>& aoLevels = {3, 3, 3, 3});
+
+    // whether the quad is split along its 1-3 diagonal rather than 0-2, so the occlusion is interpolated
+    // the same way whatever the quad's orientation (its corners are then written starting at 1)
+    static bool flipsDiagonal(const ChunkMeshQuad& quad);
+
+    // writeVertices, for the quads facing direction only if it isn't -1
+    static void appendVertices(const std::vector<ChunkMeshQuad>& quads, const std::map<EVoxelType, VoxelAtlasEntry>& atlas,
+                               EChunkVertexLayout layout, int direction, std::vector<VertexData>& outVertices);
+
+    // appends a quad's 4 corners in layout
+    template<typename Vertex>
+    static void appendQuadCorners(const std::array<Vertex, 4>& corners, EChunkVertexLayout layout, std::vector<Vertex>& outVertices) {
+        if(layout == EChunkVertexLayout::IndexedQuads) {
+            outVertices.insert(outVertices.end(), corners.begin(), corners.end());
+            return;
+        }
+        for(const uint32_t i : quadIndexPattern) {
+            outVertices.push_back(corners[i]);
+        }
+    }
+};
@@ -0,0 +1,116 @@
+#pragma once
+#include <array>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <cstdint>
+#import "Voxel/VoxelTypes.hpp"
+#include "Utilities/OpenAddressingMap.hpp"
+
+// Shared handle to a loaded chunk. A handle returned by ChunkTable stays valid after the chunk is
+// erased from the table, the chunk is destroyed when the last handle goes away.
+typedef std::shared_ptr<Chunk> ChunkHandle;
+
+// Concurrent table of loaded chunks, keyed by chunk index.
+//
+// The table is split into numShards independent shards, each an OpenAddressingMap behind its own
+// reader/writer lock. A lookup only holds its shard's shared lock for the probe, and an insert only
+// blocks the one shard it lands in, so the gen/mesh workers and the render thread no longer serialize
+// on a single mutex.
+//
+// The lock only protects the table itself. Callers get a ChunkHandle back and use the chunk after the
+// lock is released.
+class ChunkTable {
+public:
+    ChunkTable() = default;
+
+    ChunkTable(const ChunkTable&) = delete;
+    ChunkTable& operator=(const ChunkTable&) = delete;
+
+    // returns false (and leaves the table untouched) if a chunk is already loaded at index
+    bool insert(const Int3D& index, ChunkHandle chunk) {
+        Shard& shard = shardFor(index);
+        std::unique_lock<std::shared_mutex> lock(shard.mutex);
+        return shard.chunks.insert(index, std::move(chunk));
+    }
+
+    // returns nullptr if no chunk is loaded at index
+    ChunkHandle find(const Int3D& index) const {
+        const Shard& shard = shardFor(index);
+        std::shared_lock<std::shared_mutex> lock(shard.mutex);
+
+        const ChunkHandle* chunk = shard.chunks.find(index);
+        return chunk == nullptr? nullptr : *chunk;
+    }
+
+    bool contains(const Int3D& index) const {
+        const Shard& shard = shardFor(index);
+        std::shared_lock<std::shared_mutex> lock(shard.mutex);
+        return shard.chunks.contains(index);
+    }
+
+    template<size_t N>
+    bool containsAll(const std::array<Int3D, N>& indices) const {
+        for(const Int3D& index : indices) {
+            if(!contains(index)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // removes the chunk at index, returning its handle (nullptr if it wasn't loaded)
+    ChunkHandle erase(const Int3D& index) {
+        Shard& shard = shardFor(index);
+        std::unique_lock<std::shared_mutex> lock(shard.mutex);
+
+        ChunkHandle chunk;
+        shard.chunks.erase(index, &chunk);
+        return chunk;
+    }
+
+    size_t size() const {
+        size_t total = 0;
+        for(const Shard& shard : shards) {
+            std::shared_lock<std::shared_mutex> lock(shard.mutex);
+            total += shard.chunks.size();
+        }
+        return total;
+    }
+
+    // calls func(const Int3D&, const ChunkHandle&) for every loaded chunk, one shard at a time.
+    // func runs under the shard's shared lock, so it must not insert into or erase from the table.
+    template<typename Func>
+    void forEach(Func func) const {
+        for(const Shard& shard : shards) {
+            std::shared_lock<std::shared_mutex> lock(shard.mutex);
+            shard.chunks.forEach(func);
+        }
+    }
+
+private:
+    // the shard is picked from the top bits of the hash, the slot within the shard from the low bits
+    static constexpr int numShardBits = 6;
+    static constexpr int numShards = 1 << numShardBits;
+
+    // each shard on its own cache line so the locks don't false-share
+    struct alignas(64) Shard {
+        mutable std::shared_mutex mutex;
+        OpenAddressingMap<Int3D, ChunkHandle> chunks{32};
+    };
+
+    static size_t shardIndex(const Int3D& index) {
+        return (size_t) (uint64_t(std::hash<Int3D>()(index)) >> (64 - numShardBits));
+    }
+
+    Shard& shardFor(const Int3D& index) {
+        return shards[shardIndex(index)];
+    }
+
+    const Shard& shardFor(const Int3D& index) const {
+        return shards[shardIndex(index)];
+    }
+
+    std::array<Shard, numShards> shards;
+};
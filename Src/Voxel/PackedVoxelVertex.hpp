@@ -0,0 +1,153 @@
+#pragma once
+#include <simd/simd.h>
+#include <cstdint>
+#include <cassert>
+#include <cmath>
+#include <vector>
+#include "VertexDataTypes.hpp"
+#import "Voxel/VoxelTypes.hpp"
+
+// 8-byte voxel vertex, the packed counterpart of VertexData (80 bytes, with simd's 16-byte float3s).
+//
+//  positionUV:  x (6 bits) | y (6) << 6 | z (6) << 12 | u (6) << 18 | v (6) << 24
+//  attributes:  atlasIndex (16 bits) | normalIndex (3) << 16 | paletteIndex (8) << 19 | aoLevel (2) << 27
+//
+// The position is relative to the chunk (voxel corners, so 0..dims inclusive), the chunk position is
+// added back when decoding. u/v are the texture coordinates, i.e. 0 or the quad's width/height in
+// voxels. The normal is an index in Int3D::getAllNeighbors order (+x, -x, +z, -z, -y, +y), and the
+// colour scale an index in a palette of colours (index 0 being "no colour", like the terrain uses).
+// An atlasIndex of -1 is kept as 0xFFFF. aoLevel is the baked ambient occlusion, from 0 (the most
+// occluded) to 3 (none).
+//
+// What it saves is memory and upload bandwidth (10x fewer bytes per vertex), not CPU time: writing packed
+// vertices runs at 0.5-0.8x the quads/s of writing VertexData, for the extra per-vertex encoding (see
+// VoxelBenchmarks::runVertexFormatBenchmark).
+struct PackedVoxelVertex {
+    uint32_t positionUV;
+    uint32_t attributes;
+};
+static_assert(sizeof(PackedVoxelVertex) == 8);
+
+// the fields of a PackedVoxelVertex, unpacked
+struct PackedVoxelVertexFields {
+    int x;
+    int y;
+    int z;
+    int u;
+    int v;
+    int normalIndex;
+    int atlasIndex;
+    int paletteIndex;
+    int aoLevel;
+};
+
+static const int packedVoxelVertexMaxCoord = 63;
+static const int packedVoxelVertexMaxPaletteIndex = 255;
+
+// VertexData::occlusion of each ambient occlusion level (0, the most occluded, to 3, none)
+static const float voxelOcclusionOfLevel[4] = {0.5f, 0.33f, 0.17f, 0.0f};
+
+// the level whose occlusion is the closest
+inline int voxelOcclusionLevel(float occlusion) {
+    int level = 3;
+    for(int l = 0; l < 3; l++) {
+        if(std::abs(occlusion - voxelOcclusionOfLevel[l]) < std::abs(occlusion - voxelOcclusionOfLevel[level])) {
+            level = l;
+        }
+    }
+    return level;
+}
+
+inline int packedNormalIndex(const simd::float3& normal) {
+    if(normal.x > 0.5f) return 0;
+    if(normal.x < -0.5f) return 1;
+    if(normal.z > 0.5f) return 2;
+    if(normal.z < -0.5f) return 3;
+    if(normal.y < -0.5f) return 4;
+    return 5;
+}
+
+inline simd::float3 packedNormal(int normalIndex) {
+    static const simd::float3 normals[6] = {
+        {1, 0, 0}, {-1, 0, 0}, {0, 0, 1}, {0, 0, -1}, {0, -1, 0}, {0, 1, 0}
+    };
+    return normals[normalIndex];
+}
+
+// the atlas index of the face of entry with the normal at normalIndex
+inline int atlasIndexForNormal(const VoxelAtlasEntry& entry, int normalIndex) {
+    switch(normalIndex) {
+        case 0: return entry.right;
+        case 1: return entry.left;
+        case 2: return entry.front;
+        case 3: return entry.back;
+        case 4: return entry.bottom;
+        default: return entry.top;
+    }
+}
+
+inline PackedVoxelVertex encodePackedVoxelVertex(const PackedVoxelVertexFields& f) {
+    assert(f.x >= 0 && f.x <= packedVoxelVertexMaxCoord);
+    assert(f.y >= 0 && f.y <= packedVoxelVertexMaxCoord);
+    assert(f.z >= 0 && f.z <= packedVoxelVertexMaxCoord);
+    assert(f.u >= 0 && f.u <= packedVoxelVertexMaxCoord);
+    assert(f.v >= 0 && f.v <= packedVoxelVertexMaxCoord);
+    assert(f.normalIndex >= 0 && f.normalIndex < 6);
+    assert(f.atlasIndex >= -1 && f.atlasIndex < 0xFFFF);
+    assert(f.paletteIndex >= 0 && f.paletteIndex <= packedVoxelVertexMaxPaletteIndex);
+    assert(f.aoLevel >= 0 && f.aoLevel <= 3);
+
+    PackedVoxelVertex out;
+    out.positionUV = (uint32_t) f.x | (uint32_t) f.y << 6 | (uint32_t) f.z << 12 | (uint32_t) f.u << 18 | (uint32_t) f.v << 24;
+    out.attributes = ((uint32_t) f.atlasIndex & 0xFFFF) | (uint32_t) f.normalIndex << 16 | (uint32_t) f.paletteIndex << 19 | (uint32_t) f.aoLevel << 27;
+    return out;
+}
+
+inline PackedVoxelVertexFields decodePackedVoxelVertex(const PackedVoxelVertex& p) {
+    PackedVoxelVertexFields f;
+    f.x = p.positionUV & 63;
+    f.y = (p.positionUV >> 6) & 63;
+    f.z = (p.positionUV >> 12) & 63;
+    f.u = (p.positionUV >> 18) & 63;
+    f.v = (p.positionUV >> 24) & 63;
+    const int atlasIndex = p.attributes & 0xFFFF;
+    f.atlasIndex = atlasIndex == 0xFFFF? -1 : atlasIndex;
+    f.normalIndex = (p.attributes >> 16) & 7;
+    f.paletteIndex = (p.attributes >> 19) & 255;
+    f.aoLevel = (p.attributes >> 27) & 3;
+    return f;
+}
+
+// a position or texture coordinate, which must be a whole number. Rounded, so a value a float error below
+// n isn't truncated to n - 1 (by adding 0.5 rather than with std::lround, a library call that halves the
+// packed writer's throughput; the coordinates are never negative)
+inline int packedVoxelCoord(float value) {
+    assert(value > -0.5f && std::abs(value - std::round(value)) < 1e-3f);
+    return (int) (value + 0.5f);
+}
+
+// packs a VertexData of the chunk at chunkPosition, whose colour is colorPalette[paletteIndex].
+// The position and texture coordinates must be whole numbers in range
+inline PackedVoxelVertex packVoxelVertex(const VertexData& vertex, const simd::float3& chunkPosition, int paletteIndex) {
+    const simd::float3 local = vertex.position.xyz - chunkPosition;
+    return encodePackedVoxelVertex({
+        packedVoxelCoord(local.x), packedVoxelCoord(local.y), packedVoxelCoord(local.z),
+        packedVoxelCoord(vertex.textureCoordinates.x), packedVoxelCoord(vertex.textureCoordinates.y),
+        packedNormalIndex(vertex.normal), vertex.atlasIndex, paletteIndex, voxelOcclusionLevel(vertex.occlusion)
+    });
+}
+
+inline VertexData unpackVoxelVertex(const PackedVoxelVertex& packed, const simd::float3& chunkPosition,
+                                    const std::vector<simd::float3>& colorPalette) {
+    const PackedVoxelVertexFields f = decodePackedVoxelVertex(packed);
+    assert(f.paletteIndex < (int) colorPalette.size());
+
+    VertexData out;
+    out.position = simd::make_float4(chunkPosition.x + f.x, chunkPosition.y + f.y, chunkPosition.z + f.z, 1.0f);
+    out.textureCoordinates = simd::make_float2(f.u, f.v);
+    out.normal = packedNormal(f.normalIndex);
+    out.atlasIndex = f.atlasIndex;
+    out.occlusion = voxelOcclusionOfLevel[f.aoLevel];
+    out.colorScale = colorPalette[f.paletteIndex];
+    return out;
+}
@@ -0,0 +1,218 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <cassert>
+#include <algorithm>
+
+// Palette-compressed voxel storage.
+//
+// Instead of one byte per voxel, a block of voxels keeps a small palette of the voxel types
+// it actually contains, and each voxel stores an index into that palette. Indices are bit-packed
+// into 64-bit words at 1, 2, 4 or 8 bits per voxel (never straddling a word), so a block that only
+// holds air/dirt/stone/grass costs 2 bits per voxel instead of 8.
+//
+// A palette with a single entry (e.g. a block of only air) needs no indices at all.
+//
+// When set() introduces a type that no longer fits in the current index width, every index is
+// re-packed at the next width. Palette entries are never removed by set(), call compact() to drop
+// types that are no longer referenced (e.g. after world generation).
+template<typename T>
+class PaletteVoxelStorage {
+public:
+    PaletteVoxelStorage()
+    : volume(0), bitsPerIndex(0)
+    {}
+
+    // all voxels are initialized to defaultValue
+    void resize(int inVolume, T defaultValue) {
+        volume = inVolume;
+        bitsPerIndex = 0;
+
+        palette.clear();
+        palette.push_back(defaultValue);
+
+        words.clear();
+    }
+
+    T get(int index) const {
+        assert(index >= 0 && index < volume);
+
+        if(bitsPerIndex == 0) {
+            return palette[0];
+        }
+
+        return palette[readIndex(index)];
+    }
+
+    void set(int index, T value) {
+        assert(index >= 0 && index < volume);
+
+        int paletteIndex = findPaletteIndex(value);
+
+        if(paletteIndex == -1) {
+            paletteIndex = (int) palette.size();
+            palette.push_back(value);
+
+            const int requiredBits = bitsForPaletteSize((int) palette.size());
+            if(requiredBits != bitsPerIndex) {
+                repack(requiredBits);
+            }
+        }
+
+        if(bitsPerIndex == 0) {
+            // single-entry palette, every voxel already has this value
+            return;
+        }
+
+        writeIndex(index, paletteIndex);
+    }
+
+    // replaces every voxel with values[0, inVolume), building the palette and packing the indices
+    // at the smallest width that fits in a single pass (no re-packing as the palette grows)
+    void assign(const T* values, int inVolume) {
+        volume = inVolume;
+        palette.clear();
+        
+        // runs of the same value are common, so remember the last lookup
+        int lastIndex = -1;
+        for(int i = 0; i < volume; i++) {
+            if(lastIndex != -1 && palette[lastIndex] == values[i]) {
+                continue;
+            }
+            lastIndex = findPaletteIndex(values[i]);
+            if(lastIndex == -1) {
+                lastIndex = (int) palette.size();
+                palette.push_back(values[i]);
+            }
+        }
+        
+        bitsPerIndex = bitsForPaletteSize((int) palette.size());
+        words.assign(numWordsFor(bitsPerIndex), 0);
+        
+        if(bitsPerIndex == 0) {
+            return;
+        }
+        
+        lastIndex = 0;
+        for(int i = 0; i < volume; i++) {
+            if(palette[lastIndex] != values[i]) {
+                lastIndex = findPaletteIndex(values[i]);
+            }
+            writeIndexTo(words, bitsPerIndex, i, lastIndex);
+        }
+    }
+
+    // fill every voxel with one value, dropping the palette down to a single entry
+    void fill(T value) {
+        resize(volume, value);
+    }
+
+    // rebuilds the palette with only the types that are still referenced,
+    // re-packing the indices to the smallest width that fits
+    void compact() {
+        if(bitsPerIndex == 0) {
+            return;
+        }
+
+        std::vector<int> useCount(palette.size(), 0);
+        for(int i = 0; i < volume; i++) {
+            useCount[readIndex(i)]++;
+        }
+
+        std::vector<int> remap(palette.size(), -1);
+        std::vector<T> newPalette;
+        for(int i = 0; i < (int) palette.size(); i++) {
+            if(useCount[i] > 0) {
+                remap[i] = (int) newPalette.size();
+                newPalette.push_back(palette[i]);
+            }
+        }
+
+        if(newPalette.size() == palette.size()) {
+            return;
+        }
+
+        const int newBits = bitsForPaletteSize((int) newPalette.size());
+        std::vector<uint64_t> newWords(numWordsFor(newBits), 0);
+
+        for(int i = 0; i < volume && newBits > 0; i++) {
+            writeIndexTo(newWords, newBits, i, remap[readIndex(i)]);
+        }
+
+        palette = std::move(newPalette);
+        words = std::move(newWords);
+        bitsPerIndex = newBits;
+    }
+
+    bool isUniform() const { return bitsPerIndex == 0; }
+    int getBitsPerIndex() const { return bitsPerIndex; }
+    int getVolume() const { return volume; }
+    const std::vector<T>& getPalette() const { return palette; }
+
+    // bytes owned by this storage (excluding sizeof(*this))
+    size_t getMemoryUsage() const {
+        return palette.capacity() * sizeof(T) + words.capacity() * sizeof(uint64_t);
+    }
+
+private:
+    static int bitsForPaletteSize(int paletteSize) {
+        if(paletteSize <= 1) return 0;
+        if(paletteSize <= 2) return 1;
+        if(paletteSize <= 4) return 2;
+        if(paletteSize <= 16) return 4;
+
+        assert(paletteSize <= 256);
+        return 8;
+    }
+
+    int numWordsFor(int bits) const {
+        return (volume * bits + 63) / 64;
+    }
+
+    int findPaletteIndex(T value) const {
+        for(int i = 0; i < (int) palette.size(); i++) {
+            if(palette[i] == value) {
+                return i;
+            }
+        }
+        return -1;
+    }
+
+    int readIndex(int index) const {
+        // bitsPerIndex is a power of 2 <= 8, so an index never straddles two words
+        const int bitOffset = index * bitsPerIndex;
+        const uint64_t mask = (uint64_t(1) << bitsPerIndex) - 1;
+        return (int) ((words[bitOffset >> 6] >> (bitOffset & 63)) & mask);
+    }
+
+    void writeIndex(int index, int paletteIndex) {
+        writeIndexTo(words, bitsPerIndex, index, paletteIndex);
+    }
+
+    static void writeIndexTo(std::vector<uint64_t>& dst, int bits, int index, int paletteIndex) {
+        const int bitOffset = index * bits;
+        const int shift = bitOffset & 63;
+        const uint64_t mask = ((uint64_t(1) << bits) - 1) << shift;
+        uint64_t& word = dst[bitOffset >> 6];
+        word = (word & ~mask) | ((uint64_t(paletteIndex) << shift) & mask);
+    }
+
+    void repack(int newBits) {
+        std::vector<uint64_t> newWords(numWordsFor(newBits), 0);
+
+        // when going from 0 bits every index is 0, which newWords already holds
+        if(bitsPerIndex > 0) {
+            for(int i = 0; i < volume; i++) {
+                writeIndexTo(newWords, newBits, i, readIndex(i));
+            }
+        }
+
+        words = std::move(newWords);
+        bitsPerIndex = newBits;
+    }
+
+    int volume;
+    int bitsPerIndex;
+    std::vector<T> palette;
+    std::vector<uint64_t> words;
+};
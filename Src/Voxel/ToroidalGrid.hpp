@@ -0,0 +1,123 @@
+#pragma once
+#include <vector>
+#include <cassert>
+#import "Voxel/VoxelTypes.hpp"
+
+// Fixed-size 2D (XZ plane) window of chunk slots, centered on a chunk index.
+//
+// The window covers every chunk index within radius of the center (a (2*radius+1)^2 square), and
+// chunk (x, z) always lives in slot (x mod size, z mod size). When the center moves, the chunks that
+// enter the window land exactly in the slots of the chunks that left it, so recentering only touches
+// the new edge, and a lookup is a single array index.
+//
+// Every slot always holds a value, the grid doesn't track whether it's "loaded". Store a pointer or
+// std::optional in T if that's needed, and reset it from recenter's callback.
+template<typename T>
+class ToroidalGrid {
+public:
+    ToroidalGrid()
+    : ToroidalGrid(0)
+    {}
+
+    ToroidalGrid(int radius)
+    : radius(radius), size(2 * radius + 1), center(0, 0, 0), slots(size * size)
+    {
+        for(int x = -radius; x <= radius; x++) {
+            for(int z = -radius; z <= radius; z++) {
+                slotAt(x, z).index = Int3D(x, 0, z);
+            }
+        }
+    }
+
+    // moves the window to newCenter. For every chunk index that enters the window,
+    // onRecycle(const Int3D& oldIndex, const Int3D& newIndex, T& value) is called on the slot it reuses,
+    // where oldIndex is the chunk that just left the window. Slots that stay in the window aren't touched.
+    template<typename Func>
+    void recenter(const Int3D& newCenter, Func onRecycle) {
+        const int oldMinX = center.x - radius;
+        const int oldMaxX = center.x + radius;
+        const int oldMinZ = center.z - radius;
+        const int oldMaxZ = center.z + radius;
+
+        center = Int3D(newCenter.x, 0, newCenter.z);
+
+        for(int x = center.x - radius; x <= center.x + radius; x++) {
+            const bool columnWasInWindow = x >= oldMinX && x <= oldMaxX;
+
+            for(int z = center.z - radius; z <= center.z + radius; z++) {
+                if(columnWasInWindow && z >= oldMinZ && z <= oldMaxZ) {
+                    // skip over the part of the column that was already in the window
+                    z = oldMaxZ;
+                    continue;
+                }
+
+                Slot& slot = slotAt(x, z);
+                const Int3D oldIndex = slot.index;
+                slot.index = Int3D(x, 0, z);
+                onRecycle(oldIndex, slot.index, slot.value);
+            }
+        }
+    }
+
+    // whether the chunk index is within the window (only x and z are considered)
+    bool isInWindow(const Int3D& index) const {
+        return index.x >= center.x - radius && index.x <= center.x + radius &&
+               index.z >= center.z - radius && index.z <= center.z + radius;
+    }
+
+    // index must be within the window
+    T& at(const Int3D& index) {
+        assert(isInWindow(index));
+        return slotAt(index.x, index.z).value;
+    }
+
+    const T& at(const Int3D& index) const {
+        assert(isInWindow(index));
+        return slotAt(index.x, index.z).value;
+    }
+
+    // returns nullptr if index is outside the window
+    T* find(const Int3D& index) {
+        return isInWindow(index)? &slotAt(index.x, index.z).value : nullptr;
+    }
+
+    const T* find(const Int3D& index) const {
+        return isInWindow(index)? &slotAt(index.x, index.z).value : nullptr;
+    }
+
+    // calls func(const Int3D& index, T& value) for every slot, in slot order
+    template<typename Func>
+    void forEach(Func func) {
+        for(Slot& slot : slots) {
+            func(slot.index, slot.value);
+        }
+    }
+
+    const Int3D& getCenter() const { return center; }
+    int getRadius() const { return radius; }
+    int getSize() const { return size; }
+
+private:
+    struct Slot {
+        Int3D index;
+        T value;
+    };
+
+    int wrap(int v) const {
+        const int m = v % size;
+        return m < 0? m + size : m;
+    }
+
+    Slot& slotAt(int x, int z) {
+        return slots[wrap(z) * size + wrap(x)];
+    }
+
+    const Slot& slotAt(int x, int z) const {
+        return slots[wrap(z) * size + wrap(x)];
+    }
+
+    int radius;
+    int size;
+    Int3D center;
+    std::vector<Slot> slots;
+};
@@ -0,0 +1,175 @@
+#pragma once
+#include <simd/simd.h>
+#include <vector>
+#include <array>
+#include <cstdint>
+#include <cmath>
+#include <algorithm>
+#include "VertexDataTypes.hpp"
+#import "Voxel/VoxelTypes.hpp"
+#import "Utilities/OpenAddressingMap.hpp"
+
+// Keeps the transparent quads of every chunk in back-to-front order for the camera, so overlapping
+// water faces inside a chunk blend correctly (the chunks themselves are drawn far to near).
+//
+// Only each quad's centroid is kept. A chunk is only re-sorted when its quads changed, or when the
+// camera moved to another region relative to the chunk: along each axis, the camera is either before
+// the chunk, after it (like the octant of the camera around the chunk), or inside the chunk's slab,
+// at some voxel. Far chunks therefore keep their order until the camera crosses one of their sides,
+// while the ones around the camera are re-sorted as it moves between voxels.
+//
+// Quads are sorted by their distance to the camera, quantized to 16 bits over the chunk's range of
+// distances, with a 2-pass radix sort.
+//
+// Not thread-safe.
+class TransparentQuadSorter {
+public:
+    // the centroid of every quad of a vertex buffer of numVerticesPerQuad vertices per quad (corners 0
+    // and 2 are opposite in both EChunkVertexLayouts)
+    static void findQuadCentroids(const std::vector<VertexData>& vertices, int numVerticesPerQuad, std::vector<simd::float3>& outCentroids) {
+        outCentroids.clear();
+        for(size_t v = 0; v + numVerticesPerQuad <= vertices.size(); v += numVerticesPerQuad) {
+            const simd::float4 c = (vertices[v].position + vertices[v + 2].position) * 0.5f;
+            outCentroids.push_back(simd::make_float3(c.x, c.y, c.z));
+        }
+    }
+
+    // the camera's region around the box [aabbMin, aabbMax] (see above), as a single key
+    static uint32_t findCameraRegion(const simd::float3& cameraPosition, const simd::float3& aabbMin, const simd::float3& aabbMax) {
+        uint32_t key = 0;
+        for(int a = 0; a < 3; a++) {
+            // 0 before the chunk, 1023 after it, the voxel + 1 in between (chunks are well under 1022 voxels)
+            uint32_t region;
+            if(cameraPosition[a] < aabbMin[a]) {
+                region = 0;
+            }
+            else if(cameraPosition[a] >= aabbMax[a]) {
+                region = 1023;
+            }
+            else {
+                region = 1 + (uint32_t) (cameraPosition[a] - aabbMin[a]);
+            }
+            key |= region << (10 * a);
+        }
+        return key;
+    }
+
+    // Replaces the chunk's transparent quads (centroids in world space, in vertex buffer order) and its
+    // bounds. It's re-sorted on the next sortChunk
+    void setChunkQuads(const Int3D& chunkIndex, const simd::float3& aabbMin, const simd::float3& aabbMax,
+                       const std::vector<simd::float3>& centroids) {
+        ChunkQuads* chunk = chunks.find(chunkIndex);
+        if(chunk == nullptr) {
+            chunks.insert(chunkIndex, ChunkQuads());
+            chunk = chunks.find(chunkIndex);
+        }
+        chunk->aabbMin = aabbMin;
+        chunk->aabbMax = aabbMax;
+        chunk->centroids.assign(centroids.begin(), centroids.end());
+        chunk->order.clear();
+        chunk->isSorted = false;
+    }
+
+    void removeChunk(const Int3D& chunkIndex) {
+        chunks.erase(chunkIndex);
+    }
+
+    bool hasChunk(const Int3D& chunkIndex) const {
+        return chunks.contains(chunkIndex);
+    }
+
+    // Brings the chunk's order up to date for the camera. Returns true if it was re-sorted (i.e. the
+    // chunk's index buffer has to be rewritten), false if its order still holds or it has no quads
+    bool sortChunk(const Int3D& chunkIndex, const simd::float3& cameraPosition) {
+        ChunkQuads* chunk = chunks.find(chunkIndex);
+        if(chunk == nullptr || chunk->centroids.empty()) {
+            return false;
+        }
+
+        const uint32_t region = findCameraRegion(cameraPosition, chunk->aabbMin, chunk->aabbMax);
+        if(chunk->isSorted && chunk->cameraRegion == region) {
+            return false;
+        }
+
+        sortBackToFront(chunk->centroids, cameraPosition, chunk->order);
+        chunk->cameraRegion = region;
+        chunk->isSorted = true;
+        numSorts++;
+        return true;
+    }
+
+    // the chunk's quads, back to front as of the last sortChunk (nullptr if it has none)
+    const std::vector<uint32_t>* getSortedQuads(const Int3D& chunkIndex) const {
+        const ChunkQuads* chunk = chunks.find(chunkIndex);
+        return chunk != nullptr && chunk->isSorted? &chunk->order : nullptr;
+    }
+
+    // chunks re-sorted since the sorter was created
+    size_t getNumSorts() const { return numSorts; }
+
+    // the indices of the quads in centroids, sorted by decreasing distance to cameraPosition
+    void sortBackToFront(const std::vector<simd::float3>& centroids, const simd::float3& cameraPosition,
+                         std::vector<uint32_t>& outOrder) {
+        const size_t numQuads = centroids.size();
+        distances.resize(numQuads);
+        float minDistance = INFINITY;
+        float maxDistance = 0.0f;
+        for(size_t q = 0; q < numQuads; q++) {
+            distances[q] = simd::distance(centroids[q], cameraPosition);
+            minDistance = std::min(minDistance, distances[q]);
+            maxDistance = std::max(maxDistance, distances[q]);
+        }
+
+        // the furthest quad gets key 0
+        const float scale = maxDistance > minDistance? 65535.0f / (maxDistance - minDistance) : 0.0f;
+        keys.resize(numQuads);
+        for(size_t q = 0; q < numQuads; q++) {
+            keys[q] = (uint16_t) ((maxDistance - distances[q]) * scale);
+        }
+
+        // LSD radix sort, low byte then high byte (both passes are stable)
+        outOrder.resize(numQuads);
+        scratchOrder.resize(numQuads);
+        for(size_t q = 0; q < numQuads; q++) {
+            scratchOrder[q] = (uint32_t) q;
+        }
+        radixPass(scratchOrder, 0, outOrder);
+        radixPass(outOrder, 8, scratchOrder);
+        outOrder.swap(scratchOrder);
+    }
+
+private:
+    struct ChunkQuads {
+        simd::float3 aabbMin = {0, 0, 0};
+        simd::float3 aabbMax = {0, 0, 0};
+        std::vector<simd::float3> centroids;
+        std::vector<uint32_t> order;
+        uint32_t cameraRegion = 0;
+        bool isSorted = false;
+    };
+
+    OpenAddressingMap<Int3D, ChunkQuads> chunks;
+    size_t numSorts = 0;
+
+    // reused between sorts
+    std::vector<float> distances;
+    std::vector<uint16_t> keys;
+    std::vector<uint32_t> scratchOrder;
+
+    // stable counting sort of in by the byte of keys at shift
+    void radixPass(const std::vector<uint32_t>& in, int shift, std::vector<uint32_t>& out) const {
+        std::array<uint32_t, 256> offsets = {};
+        for(const uint32_t q : in) {
+            offsets[(keys[q] >> shift) & 0xFF]++;
+        }
+        uint32_t sum = 0;
+        for(uint32_t& offset : offsets) {
+            const uint32_t count = offset;
+            offset = sum;
+            sum += count;
+        }
+        for(const uint32_t q : in) {
+            out[offsets[(keys[q] >> shift) & 0xFF]++] = q;
+        }
+    }
+};
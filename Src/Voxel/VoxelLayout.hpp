@@ -0,0 +1,67 @@
+#pragma once
+#include <array>
+
+// Index layouts (compile-time policies) for the voxels of a 16x16x16 chunk section.
+//
+// Each layout maps local (x,y,z) coords to an index in [0, 4096) and back. The section's voxel storage
+// is laid out in index order, so iterating indices in increasing order is iterating in cache order.
+//
+//  - LinearVoxelLayout: y-major, then z, then x. Sweeps along x are contiguous, but sweeps along
+//    z stride by 16 and sweeps along y by 256.
+//  - MortonVoxelLayout: Z-order curve, the bits of x, z and y are interleaved, so neighbors
+//    along all three axes tend to be close together in memory.
+
+struct LinearVoxelLayout {
+    static constexpr int bitsPerAxis = 4;
+    static constexpr int size = 1 << bitsPerAxis;
+
+    static int index(int x, int y, int z) {
+        return (y * size + z) * size + x;
+    }
+
+    static void coords(int index, int& outX, int& outY, int& outZ) {
+        outX = index & (size - 1);
+        outZ = (index >> bitsPerAxis) & (size - 1);
+        outY = index >> (2 * bitsPerAxis);
+    }
+};
+
+struct MortonVoxelLayout {
+    static constexpr int bitsPerAxis = 4;
+    static constexpr int size = 1 << bitsPerAxis;
+
+    // bit layout of an index: y3 z3 x3 y2 z2 x2 y1 z1 x1 y0 z0 x0
+    static int index(int x, int y, int z) {
+        return spreadTable[x] | (spreadTable[z] << 1) | (spreadTable[y] << 2);
+    }
+
+    static void coords(int index, int& outX, int& outY, int& outZ) {
+        outX = compact(index);
+        outZ = compact(index >> 1);
+        outY = compact(index >> 2);
+    }
+
+private:
+    // inverse of spreadTable, reads every 3rd bit
+    static int compact(int v) {
+        int out = 0;
+        for(int i = 0; i < bitsPerAxis; i++) {
+            out |= ((v >> (3 * i)) & 1) << i;
+        }
+        return out;
+    }
+
+    // spreadTable[v] moves bit i of v to bit 3*i
+    static constexpr std::array<int, size> spreadTable = {
+        0, 1, 8, 9, 64, 65, 72, 73, 512, 513, 520, 521, 576, 577, 584, 585
+    };
+};
+
+// the layout used by Chunk (see BasicChunk)
+//
+// Linear wins for our sizes: a 16^3 section is at most 4 KB flat (less when palette-packed), so it
+// stays in L1 whatever the layout, and the meshChunk-style sweeps are dominated by the per-voxel
+// section lookup. Morton only adds the cost of the index interleaving: its sweeps measured up to ~10%
+// slower, flat or palette-packed, by an amount that varies per axis and from run to run.
+// Run the layout benchmark (--benchmark) before switching.
+using ChunkVoxelLayout = LinearVoxelLayout;
@@ -6,10 +6,17 @@
 //
 #include <simd/simd.h>
 #include <array>
+#include <algorithm>
 #include <string>
+#include <cstdint>
+#include <memory>
+#include <shared_mutex>
 #include "Gameplay/Physics/PhysicsCoreTypes.hpp"
 #include "EngineInterface.hpp"
 #include "Core/Drawables.hpp"
+#include "Voxel/PaletteVoxelStorage.hpp"
+#include "Utilities/BlockPool.hpp"
+#include "Voxel/VoxelLayout.hpp"
 #include "simd/simd.h"
 
 struct Int3D {
@@ -92,24 +99,66 @@ public:
     IndexType z;
 };
 
+// Int3D packed into a single 64-bit key, 21 bits (two's complement) per axis, so any chunk or world-space
+// voxel coordinate in [-2^20, 2^20) round-trips. Cheaper to compare and hash than the three ints.
+struct PackedInt3D {
+    static constexpr int bitsPerAxis = 21;
+    static constexpr uint64_t axisMask = (uint64_t(1) << bitsPerAxis) - 1;
+    
+    PackedInt3D()
+    : key(0) {}
+    
+    explicit PackedInt3D(const Int3D& v)
+    : key((uint64_t(uint32_t(v.x)) & axisMask)
+          | ((uint64_t(uint32_t(v.y)) & axisMask) << bitsPerAxis)
+          | ((uint64_t(uint32_t(v.z)) & axisMask) << (2 * bitsPerAxis)))
+    {}
+    
+    Int3D unpack() const {
+        return Int3D(unpackAxis(0), unpackAxis(1), unpackAxis(2));
+    }
+    
+    bool operator==(const PackedInt3D& other) const { return key == other.key; }
+    bool operator<(const PackedInt3D& other) const { return key < other.key; }
+    
+    uint64_t key;
+    
+private:
+    int unpackAxis(int axis) const {
+        const uint64_t bits = (key >> (axis * bitsPerAxis)) & axisMask;
+        // sign-extend from 21 bits
+        return (int) (int64_t(bits << (64 - bitsPerAxis)) >> (64 - bitsPerAxis));
+    }
+};
+
+// murmur3's 64-bit finalizer: every input bit affects every output bit, so the low bits (slot index)
+// and high bits (shard index) of the result are both usable on their own
+inline uint64_t mixHash64(uint64_t h) {
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+    return h;
+}
+
 template <>
-struct std::hash<Int3D>
+struct std::hash<PackedInt3D>
 {
-  std::size_t operator()(const Int3D& k) const
-  {
-    using std::size_t;
-    using std::hash;
-    using std::string;
-
-    // Compute individual hash values for first,
-    // second and third and combine them using XOR
-    // and bit shifting:
+    std::size_t operator()(const PackedInt3D& k) const
+    {
+        return (std::size_t) mixHash64(k.key);
+    }
+};
 
-    return ((hash<int>()(k.x)
-             ^ (hash<int>()(k.y) << 1)) >> 1)
-             ^ (hash<int>()(k.z) << 1);
-  }
-    
+template <>
+struct std::hash<Int3D>
+{
+    std::size_t operator()(const Int3D& k) const
+    {
+        // packing first keeps (x,0,z) and (z,0,x) apart, which XOR-combining the axes didn't
+        return std::hash<PackedInt3D>()(PackedInt3D(k));
+    }
 };
 
 enum class EVoxelType : char {
@@ -121,6 +170,9 @@ enum class EVoxelType : char {
     Lamp = 5,
 };
 
+// number of EVoxelType values, for arrays indexed by type
+constexpr int numVoxelTypes = (int) EVoxelType::Lamp + 1;
+
 struct VoxelAtlasEntry {
     
     VoxelAtlasEntry() = default;
@@ -145,13 +197,256 @@ struct VoxelAtlasEntry {
     int bottom;
 };
 
-class Chunk {
-    
+// how a Chunk stores its voxel types
+//  - Flat: one EVoxelType byte per voxel
+//  - Palette: bit-packed indices into a per-section palette (see PaletteVoxelStorage)
+enum class EVoxelStorageMode {
+    Flat,
+    Palette
+};
+
+struct ChunkMemoryUsage {
+    size_t voxelBytes = 0;
+    size_t collisionBytes = 0;
+    size_t lightBytes = 0;
+    
+    size_t getTotal() const { return voxelBytes + collisionBytes + lightBytes; }
+    
+    ChunkMemoryUsage& operator+=(const ChunkMemoryUsage& other) {
+        voxelBytes += other.voxelBytes;
+        collisionBytes += other.collisionBytes;
+        lightBytes += other.lightBytes;
+        return *this;
+    }
+};
+
+// A fixed-size (16x16x16) block of a Chunk's voxels. Chunks are split into sections stacked along Y.
+//
+// A section that holds only one voxel type (e.g. all air above the terrain, or all stone below it)
+// is "uniform": it keeps just that type, allocates no voxel array, and can be skipped entirely by
+// consumers that only care about non-empty voxels (meshing, generation passes).
+//
+// Collision cells are allocated lazily, so sections without collision rects don't pay for them either.
+//
+// The flat voxel arrays and the collision cells are fixed-size blocks taken from per-type BlockPools,
+// so chunks that are unloaded hand them over to the next chunk being generated instead of going
+// through malloc/free. In EVoxelStorageMode::Palette, voxels are written to a flat block first and
+// only packed into the palette by compact() (after generation), so generation never re-packs.
+//
+// VoxelLayout decides how local coords map to storage indices (see VoxelLayout.hpp).
+template<typename VoxelLayout>
+class BasicChunkSection {
 public:
-    Chunk(IEngine* engine)
-    : engine(engine)
+    static constexpr int size = VoxelLayout::size;
+    static constexpr int volume = size * size * size;
+    
+    typedef std::array<EVoxelType, volume> VoxelBlock;
+    typedef std::array<std::vector<CollisionEntity*>, volume> CollisionBlock;
+    
+    static BlockPool<VoxelBlock>& getVoxelBlockPool() {
+        // 4 KB each
+        static BlockPool<VoxelBlock> pool(2048);
+        return pool;
+    }
+    
+    static BlockPool<CollisionBlock>& getCollisionBlockPool() {
+        // ~100 KB each (plus whatever capacity the cells kept). Enough for the sections of a full
+        // edge of chunks unloaded in one go (a player move)
+        static BlockPool<CollisionBlock> pool(128, [](CollisionBlock& cells) {
+            // keep the capacity, so the next chunk's rects don't allocate either
+            for(auto& cell : cells) {
+                cell.clear();
+            }
+        });
+        return pool;
+    }
+    
+    BasicChunkSection()
+    : storageMode(EVoxelStorageMode::Flat), uniform(true), uniformType(EVoxelType::None), numNonEmpty(0)
     {}
     
+    void init(EVoxelStorageMode inStorageMode) {
+        storageMode = inStorageMode;
+        setUniform(EVoxelType::None);
+        clearCollisionEntities();
+    }
+    
+    // local coords must be within [0, size)
+    static int localIndex(int x, int y, int z) {
+        return VoxelLayout::index(x, y, z);
+    }
+    
+    // calls func(x, y, z, type) for every voxel, in storage (cache) order
+    template<typename Func>
+    void forEachVoxel(Func func) const {
+        int x, y, z;
+        for(int i = 0; i < volume; i++) {
+            VoxelLayout::coords(i, x, y, z);
+            func(x, y, z, get(i));
+        }
+    }
+    
+    EVoxelType get(int index) const {
+        if(uniform) {
+            return uniformType;
+        }
+        
+        if(voxels) {
+            return (*voxels)[index];
+        }
+        return paletteVoxels.get(index);
+    }
+    
+    void set(int index, EVoxelType type) {
+        const EVoxelType oldType = get(index);
+        if(oldType == type) {
+            return;
+        }
+        
+        numNonEmpty += (type != EVoxelType::None) - (oldType != EVoxelType::None);
+        
+        if(numNonEmpty == 0) {
+            // the last solid voxel was removed
+            setUniform(EVoxelType::None);
+            return;
+        }
+        
+        if(uniform) {
+            // expand into a flat block, pre-filled with the old uniform type
+            uniform = false;
+            voxels = getVoxelBlockPool().acquire();
+            voxels->fill(uniformType);
+        }
+        
+        if(voxels) {
+            (*voxels)[index] = type;
+        }
+        else {
+            paletteVoxels.set(index, type);
+        }
+    }
+    
+    // all air
+    bool isEmpty() const { return numNonEmpty == 0; }
+    // all one type (all air is uniform too)
+    bool isUniform() const { return uniform; }
+    EVoxelType getUniformType() const { return uniformType; }
+    
+    // drops the voxel array if every voxel ended up being the same type. Otherwise, in palette mode,
+    // packs the flat block into the palette (or drops unused palette entries if already packed)
+    void compact() {
+        if(uniform) {
+            return;
+        }
+        
+        const EVoxelType first = get(0);
+        bool allSame = true;
+        for(int i = 1; i < volume && allSame; i++) {
+            allSame = get(i) == first;
+        }
+        
+        if(allSame) {
+            setUniform(first);
+        }
+        else if(storageMode == EVoxelStorageMode::Palette) {
+            if(voxels) {
+                paletteVoxels.assign(voxels->data(), volume);
+                voxels.reset();
+            }
+            else {
+                paletteVoxels.compact();
+            }
+        }
+    }
+    
+    const std::vector<CollisionEntity*>& getCollisionEntities(int index) const {
+        static const std::vector<CollisionEntity*> noEntities;
+        if(!collisionCells) {
+            return noEntities;
+        }
+        return (*collisionCells)[index];
+    }
+    
+    void addCollisionEntity(int index, CollisionEntity* entity) {
+        if(!collisionCells) {
+            collisionCells = getCollisionBlockPool().acquire();
+        }
+        (*collisionCells)[index].push_back(entity);
+    }
+    
+    void removeCollisionEntity(int index, CollisionEntity* entity) {
+        if(!collisionCells) {
+            return;
+        }
+        std::vector<CollisionEntity*>& cell = (*collisionCells)[index];
+        cell.erase(std::remove(cell.begin(), cell.end(), entity), cell.end());
+    }
+    
+    void clearCollisionEntities() {
+        collisionCells.reset();
+    }
+    
+    size_t getVoxelMemoryUsage() const {
+        return (voxels? sizeof(VoxelBlock) : 0) + paletteVoxels.getMemoryUsage();
+    }
+    
+    size_t getCollisionMemoryUsage() const {
+        if(!collisionCells) {
+            return 0;
+        }
+        
+        size_t bytes = sizeof(CollisionBlock);
+        for(const auto& cell : *collisionCells) {
+            bytes += cell.capacity() * sizeof(CollisionEntity*);
+        }
+        return bytes;
+    }
+    
+private:
+    void setUniform(EVoxelType type) {
+        uniform = true;
+        uniformType = type;
+        numNonEmpty = type == EVoxelType::None? 0 : volume;
+        
+        voxels.reset();
+        paletteVoxels.resize(0, type);
+    }
+    
+    EVoxelStorageMode storageMode;
+    
+    bool uniform;
+    EVoxelType uniformType;
+    int numNonEmpty;
+    
+    // at most one of these holds voxels (neither when uniform). The flat block is used in
+    // EVoxelStorageMode::Flat, and in Palette mode until the section is compacted
+    typename BlockPool<VoxelBlock>::Handle voxels;
+    PaletteVoxelStorage<EVoxelType> paletteVoxels;
+    
+    // null, or one cell per voxel
+    typename BlockPool<CollisionBlock>::Handle collisionCells;
+};
+
+// a column of voxels, made of ChunkSections stacked along Y
+// (use the Chunk alias, the layout is only a template parameter so it can be benchmarked)
+template<typename VoxelLayout>
+class BasicChunk {
+    
+public:
+    typedef BasicChunkSection<VoxelLayout> ChunkSection;
+    
+    BasicChunk(IEngine* engine, EVoxelStorageMode storageMode = EVoxelStorageMode::Flat)
+    : storageMode(storageMode), lastAccessFrame(0), engine(engine)
+    {
+        voxelTypeCounts.fill(0);
+    }
+    
+    // move-only: the sections own pooled blocks, and copying a chunk is never what we want
+    BasicChunk(const BasicChunk&) = delete;
+    BasicChunk& operator=(const BasicChunk&) = delete;
+    BasicChunk(BasicChunk&&) = default;
+    BasicChunk& operator=(BasicChunk&&) = default;
+    
     void setPosition(Int3D inPosition) {
         position = inPosition;
     }
@@ -159,51 +454,157 @@ public:
     void setDimensions(Int3D inDims) {
         dims = {inDims.x, inDims.y, inDims.z};
         
-        const float volume = inDims.x * inDims.y * inDims.z;
+        // chunks are one section wide/deep, and a whole number of sections tall
+        assert(dims.x == ChunkSection::size && dims.z == ChunkSection::size);
+        assert(dims.y % ChunkSection::size == 0);
         
-        voxels.clear();
-        voxels.resize(volume, EVoxelType::None);
+        sections.clear();
+        sections.resize(dims.y / ChunkSection::size);
+        for(ChunkSection& section : sections) {
+            section.init(storageMode);
+        }
         
-        collisionGrid.clear();
-        collisionGrid.resize(volume, std::vector<CollisionEntity*>());
+        voxelTypeCounts.fill(0);
+        voxelTypeCounts[(int) EVoxelType::None] = dims.x * dims.y * dims.z;
     }
     
     void setIndex(Int3D inIndex) { index = inIndex; }
     void setIndex(int x, int y, int z) { index = Int3D(x,y,z); }
     
+    // coordinates outside of this chunk are treated as empty
     EVoxelType getVoxel(Int3D coords) const {
-        return voxels[coordsToRawIndex(coords)];
+        if(!isInBounds(coords)) {
+            return EVoxelType::None;
+        }
+        
+        const ChunkSection& section = sections[coords.y / ChunkSection::size];
+        return section.get(ChunkSection::localIndex(coords.x, coords.y % ChunkSection::size, coords.z));
     }
     
     void setVoxel(Int3D coords, EVoxelType inType) {
-	int rawInd = coordsToRawIndex(coords);
-	if(rawInd != -1) {
-	    voxels[coordsToRawIndex(coords)] = inType;
+	if(isInBounds(coords)) {
+            ChunkSection& section = sections[coords.y / ChunkSection::size];
+            const int localIndex = ChunkSection::localIndex(coords.x, coords.y % ChunkSection::size, coords.z);
+            
+            const EVoxelType oldType = section.get(localIndex);
+            if(oldType == inType) {
+                return;
+            }
+            
+            voxelTypeCounts[(int) oldType]--;
+            voxelTypeCounts[(int) inType]++;
+            section.set(localIndex, inType);
 	}
     }
     
+    // held shared by the mesh workers while they read the voxels, and exclusively around setVoxel once
+    // the chunk is loaded (edits are made on the main thread, which doesn't lock to read them)
+    std::shared_mutex& getVoxelsMutex() const { return *voxelsMutex; }
+    
+    // number of voxels of each type in this chunk (kept up to date by setVoxel)
+    int getVoxelTypeCount(EVoxelType type) const { return voxelTypeCounts[(int) type]; }
+    bool containsVoxelType(EVoxelType type) const { return voxelTypeCounts[(int) type] > 0; }
+    
+    // releases the arrays of sections that ended up uniform, and drops unused
+    // palette entries (e.g. once generation has finished)
+    void compactVoxelStorage() {
+        for(ChunkSection& section : sections) {
+            section.compact();
+        }
+    }
+    
+    EVoxelStorageMode getStorageMode() const { return storageMode; }
+    
+    int getNumSections() const { return (int) sections.size(); }
+    const ChunkSection& getSection(int sectionIndex) const { return sections[sectionIndex]; }
+    
+    // calls func(coords, type) for every voxel in a non-empty section, in storage (cache) order
+    template<typename Func>
+    void forEachNonEmptySectionVoxel(Func func) const {
+        for(int i = 0; i < (int) sections.size(); i++) {
+            if(sections[i].isEmpty()) {
+                continue;
+            }
+            
+            const int yOffset = i * ChunkSection::size;
+            sections[i].forEachVoxel([&](int x, int y, int z, EVoxelType type) {
+                func(Int3D(x, y + yOffset, z), type);
+            });
+        }
+    }
+    
+    bool isEmpty() const {
+        for(const ChunkSection& section : sections) {
+            if(!section.isEmpty()) {
+                return false;
+            }
+        }
+        return true;
+    }
+    
+    // [outMinY, outMaxY) covers every section that isn't all air.
+    // Returns false (and an empty range) if the whole chunk is air.
+    bool getNonEmptyYRange(int& outMinY, int& outMaxY) const {
+        outMinY = 0;
+        outMaxY = 0;
+        
+        int first = -1;
+        int last = -1;
+        for(int i = 0; i < (int) sections.size(); i++) {
+            if(!sections[i].isEmpty()) {
+                first = first == -1? i : first;
+                last = i;
+            }
+        }
+        
+        if(first == -1) {
+            return false;
+        }
+        
+        outMinY = first * ChunkSection::size;
+        outMaxY = (last + 1) * ChunkSection::size;
+        return true;
+    }
+    
+    ChunkMemoryUsage getMemoryUsage() const {
+        ChunkMemoryUsage usage;
+        
+        usage.voxelBytes = sections.capacity() * sizeof(ChunkSection);
+        for(const ChunkSection& section : sections) {
+            usage.voxelBytes += section.getVoxelMemoryUsage();
+            usage.collisionBytes += section.getCollisionMemoryUsage();
+        }
+        
+        usage.collisionBytes += collisionRects.capacity() * sizeof(std::unique_ptr<CollisionRect>) + collisionRects.size() * sizeof(CollisionRect);
+        
+        // rough estimate of a std::map node: the key/value pair plus 3 pointers and a color
+        usage.lightBytes = voxelLightColor.size() * (sizeof(std::pair<Int3D, simd::float3>) + 4 * sizeof(void*));
+        
+        return usage;
+    }
+    
     void setVoxelLightColor(Int3D coords, simd::float3 color) {
         voxelLightColor[coords] = color;
     }
 
     void clearCollisionRects() {
-        const float volume = dims.x * dims.y * dims.z;
-
+        // the cells only hold raw pointers to the rects, so clear both together
 	collisionRects.clear();
-	collisionGrid.clear();
-        collisionGrid.resize(volume, std::vector<CollisionEntity*>());
+        for(ChunkSection& section : sections) {
+            section.clearCollisionEntities();
+        }
     }
     
-    // positionsLS - positions local to this chunk
-    void addCollisionRect(std::array<simd::float3, 4> positionsLS, simd::float3 normal) {
+    // positionsLS - positions local to this chunk. The rect isn't added to the chunk yet, so meshers can
+    // build a whole set of them before swapping it in (see setCollisionRects)
+    std::unique_ptr<CollisionRect> makeCollisionRect(std::array<simd::float3, 4> positionsLS, simd::float3 normal) const {
         // create a new CollisionRect using world space positions
         std::array<simd::float3, 4> positionsWS = positionsLS;
         for(auto& p : positionsWS) {
             p += position.to_float3();
         }
         
-        CollisionRect* cRect = new CollisionRect(positionsWS, normal);
-        collisionRects.push_back(cRect);
+        std::unique_ptr<CollisionRect> cRect = std::make_unique<CollisionRect>(positionsWS, normal);
         
         cRect->setId((int) collisionIdToDebugRect.size());
         
@@ -223,42 +624,48 @@ public:
         //collisionIdToDebugRect.insert({cRect->getId(), dr});
         // dr->setVisibility(true);
         
-        // for each vertex in local space, find each voxel it's in,
-        // - add reference to CollisionRect in the collisionGrid for the area
-        //   the vertices span over
-        float maxFloat = std::numeric_limits<float>::max();
-        float minFloat = std::numeric_limits<float>::lowest();
-        
-        simd::float3 minPos { maxFloat, maxFloat, maxFloat };
-        simd::float3 maxPos { minFloat, minFloat, minFloat };
+        return cRect;
+    }
+    
+    void addCollisionRect(std::unique_ptr<CollisionRect> rect) {
+        CollisionRect* cRect = rect.get();
+        collisionRects.push_back(std::move(rect));
         
-        for(const simd::float3& p : positionsLS) {
-            minPos.x = std::min(p.x, minPos.x);
-            maxPos.x = std::max(p.x, maxPos.x);
-            minPos.y = std::min(p.y, minPos.y);
-            maxPos.y = std::max(p.y, maxPos.y);
-            minPos.z = std::min(p.z, minPos.z);
-            maxPos.z = std::max(p.z, maxPos.z);
+        // add reference to CollisionRect in the collision cells (of each section) for the area
+        // the vertices span over
+        forEachCollisionCell(cRect->minPosWS - position.to_float3(), cRect->maxPosWS - position.to_float3(), [cRect](ChunkSection& section, int localIndex) {
+            section.addCollisionEntity(localIndex, cRect);
+        });
+    }
+    
+    // replaces all of the chunk's collision rects, e.g. with the rects of a new mesh
+    void setCollisionRects(std::vector<std::unique_ptr<CollisionRect>> rects) {
+        clearCollisionRects();
+        collisionRects.reserve(rects.size());
+        for(std::unique_ptr<CollisionRect>& rect : rects) {
+            addCollisionRect(std::move(rect));
         }
+    }
+    
+    // removes the collision rects lying on the plane at planeLS (local to this chunk) along axis,
+    // e.g. before adding the rects of a re-meshed plane
+    void removeCollisionRectsOnPlane(EAxis axis, int planeLS) {
+        const float planeOffsetWS = planeLS + (axis == EAxis::X? position.x : (axis == EAxis::Y? position.y : position.z));
+        auto isOnPlane = [axis, planeOffsetWS](const std::unique_ptr<CollisionRect>& rect) {
+            return rect->normal == axis && rect->normalOffset == planeOffsetWS;
+        };
         
-        //std::cout << "addCollisionRect -- " << std::endl;
-        //std::cout << "    minPos: " << minPos.x << ", " << minPos.y << ", " << minPos.z << std::endl;
-        //std::cout << "    maxPos: " << maxPos.x << ", " << maxPos.y << ", " << maxPos.z << std::endl;
-        
-        for(int x = minPos.x; x <= maxPos.x; x++) {
-            for(int y = minPos.y; y <= maxPos.y; y++) {
-                for(int z = minPos.z; z <= maxPos.z; z++) {
-                    // clamp indices [0, dim - 1]
-                    int xInd = std::max(std::min(x, dims.x - 1), 0);
-                    int yInd = std::max(std::min(y, dims.y - 1), 0);
-                    int zInd = std::max(std::min(z, dims.z - 1), 0);
-                    
-                    int ind = coordsToRawIndex({xInd,yInd,zInd});
-                    assert(ind != -1);
-                    collisionGrid[ind].push_back(cRect);
-                }
+        for(const std::unique_ptr<CollisionRect>& rect : collisionRects) {
+            if(!isOnPlane(rect)) {
+                continue;
             }
+            CollisionRect* cRect = rect.get();
+            forEachCollisionCell(rect->minPosWS - position.to_float3(), rect->maxPosWS - position.to_float3(), [cRect](ChunkSection& section, int localIndex) {
+                section.removeCollisionEntity(localIndex, cRect);
+            });
         }
+        
+        collisionRects.erase(std::remove_if(collisionRects.begin(), collisionRects.end(), isOnPlane), collisionRects.end());
     }
     
     Int3D getDimensions() const { return dims; }
@@ -268,7 +675,15 @@ public:
     simd::float3 getPositionAsFloat3() const { return simd::make_float3(position.x, position.y, position.z); }
     simd::float4 getPositionAsFloat4() const { return simd::make_float4(position.x, position.y, position.z, 0.0f);}
     const std::map<Int3D, simd::float3>& getVoxelLightColorMap() const { return voxelLightColor; }
-    const std::vector<CollisionRect*>& getCollisionRects() const { return collisionRects; }
+    const std::vector<std::unique_ptr<CollisionRect>>& getCollisionRects() const { return collisionRects; }
+    
+    // ids of the engine point lights owned by this chunk's lamps (removed when the chunk is unloaded)
+    void addPointLightId(int id) { pointLightIds.push_back(id); }
+    const std::vector<int>& getPointLightIds() const { return pointLightIds; }
+    
+    // engine frame this chunk was last drawn or collided with, used to pick chunks to unload
+    void markAccessed(uint64_t frame) { lastAccessFrame = frame; }
+    uint64_t getLastAccessFrame() const { return lastAccessFrame; }
 
     Int3D getCoordsFromPositionWS(simd::float3 posWS) const {
         simd::float3 posLocal = posWS - getPositionAsFloat3();
@@ -291,10 +706,9 @@ public:
         for(int x = coords.x - radius; x <= coords.x + radius; x++) {
             for(int y = coords.y - radius; y <= coords.y + radius; y++) {
                 for(int z = coords.z - radius; z <= coords.z + radius; z++) {
-                    int rawInd = coordsToRawIndex({x,y,z});
-                    if(rawInd != -1) {
+                    if(isInBounds({x,y,z})) {
                         collidesWithAny = true;
-                        std::vector<CollisionEntity*> queried = collisionGrid[rawInd];
+                        const std::vector<CollisionEntity*>& queried = getCollisionEntitiesAtCoords({x,y,z});
                         ret.insert(ret.end(), queried.begin(), queried.end());
                     }
                 }
@@ -307,7 +721,8 @@ public:
     }
     
     const std::vector<CollisionEntity*>& getCollisionEntitiesAtCoords(Int3D coords) const {
-        return collisionGrid[coordsToRawIndex(coords)];
+        const ChunkSection& section = sections[coords.y / ChunkSection::size];
+        return section.getCollisionEntities(ChunkSection::localIndex(coords.x, coords.y % ChunkSection::size, coords.z));
     }
     
     void resetLineColors() {
@@ -329,28 +744,50 @@ public:
     }
     
 private:
-    int coordsToRawIndex(Int3D coords) const {
-        if(coords.x < 0 || coords.x >= dims.x ||
-           coords.y < 0 || coords.y >= dims.y ||
-           coords.z < 0 || coords.z >= dims.z) {
-            return -1;
+    // calls func(section, localIndex) for every collision cell a rect spanning [minPosLS, maxPosLS] is in
+    template<typename Func>
+    void forEachCollisionCell(simd::float3 minPosLS, simd::float3 maxPosLS, Func func) {
+        for(int x = minPosLS.x; x <= maxPosLS.x; x++) {
+            for(int y = minPosLS.y; y <= maxPosLS.y; y++) {
+                for(int z = minPosLS.z; z <= maxPosLS.z; z++) {
+                    // clamp indices [0, dim - 1]
+                    int xInd = std::max(std::min(x, dims.x - 1), 0);
+                    int yInd = std::max(std::min(y, dims.y - 1), 0);
+                    int zInd = std::max(std::min(z, dims.z - 1), 0);
+                    
+                    assert(isInBounds({xInd,yInd,zInd}));
+                    ChunkSection& section = sections[yInd / ChunkSection::size];
+                    func(section, ChunkSection::localIndex(xInd, yInd % ChunkSection::size, zInd));
+                }
+            }
         }
-        
-        // simplifies to:
-        // dims[0] * (z + dims[2] * y) + x
-        return (coords.y * dims.x * dims.z) + (coords.x + dims.x * coords.z);
+    }
+    
+    bool isInBounds(Int3D coords) const {
+        return coords.x >= 0 && coords.x < dims.x &&
+               coords.y >= 0 && coords.y < dims.y &&
+               coords.z >= 0 && coords.z < dims.z;
     }
     
     Int3D dims;
     Int3D position;
-    std::vector<EVoxelType> voxels;
+    EVoxelStorageMode storageMode;
+    // stacked bottom to top, each covers ChunkSection::size rows of y
+    std::vector<ChunkSection> sections;
+    std::array<int, numVoxelTypes> voxelTypeCounts;
+    // (behind a pointer, so chunks stay movable)
+    std::unique_ptr<std::shared_mutex> voxelsMutex = std::make_unique<std::shared_mutex>();
     Int3D index;
     std::map<Int3D, simd::float3> voxelLightColor;
     
-    std::vector< std::vector<CollisionEntity*> > collisionGrid;
-    std::vector<CollisionRect*> collisionRects;
+    // owned here, the section collision cells point into these
+    std::vector<std::unique_ptr<CollisionRect>> collisionRects;
+    std::vector<int> pointLightIds;
+    uint64_t lastAccessFrame;
     
     IEngine* engine;
     std::map<int, DebugRect*> collisionIdToDebugRect;
 };
 
+typedef BasicChunkSection<ChunkVoxelLayout> ChunkSection;
+typedef BasicChunk<ChunkVoxelLayout> Chunk;
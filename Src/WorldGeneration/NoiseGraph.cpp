@@ -0,0 +1,762 @@
+// a single-octave perlin source has to give exactly WorldNoise's noise, so no multiply and add are fused
+// into an FMA in this file either (see PerlinNoiseGenerator.cpp)
+#if defined(__clang__)
+#pragma STDC FP_CONTRACT OFF
+#endif
+
+#include "NoiseGraph.hpp"
+#include "NoiseLanes.hpp"
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <cmath>
+#include <cctype>
+#include <cstdlib>
+
+namespace {
+
+// the noise a perlin source stays within (see TerrainGenerator::fillVolumetric)
+const float maxPerlinMagnitude = 1.5f;
+// seeds of a node's octaves, from the world seed
+const uint32_t nodeSeedStep = 0x9e3779b9u;
+const uint32_t octaveSeedStep = 0x632be5abu;
+
+std::vector<std::string> splitTokens(const std::string& line) {
+    std::vector<std::string> tokens;
+    std::istringstream stream(line);
+    std::string token;
+    while(stream >> token) {
+        tokens.push_back(token);
+    }
+    return tokens;
+}
+
+bool isName(const std::string& s) {
+    if(s.empty() || !(std::isalpha((unsigned char) s[0]) || s[0] == '_')) {
+        return false;
+    }
+    return std::all_of(s.begin(), s.end(), [](char c) { return std::isalnum((unsigned char) c) || c == '_'; });
+}
+
+bool parseFloat(const std::string& s, float& out) {
+    char* end = nullptr;
+    out = std::strtof(s.c_str(), &end);
+    return !s.empty() && *end == '\0';
+}
+
+bool parseInt(const std::string& s, int& out) {
+    char* end = nullptr;
+    out = (int) std::strtol(s.c_str(), &end, 10);
+    return !s.empty() && *end == '\0';
+}
+
+bool parseSource(const std::string& s, ENoiseSource& out) {
+    if(s == "perlin") {
+        out = ENoiseSource::Perlin;
+    }
+    else if(s == "value") {
+        out = ENoiseSource::Value;
+    }
+    else if(s == "cellular") {
+        out = ENoiseSource::Cellular;
+    }
+    else {
+        return false;
+    }
+    return true;
+}
+
+NoiseLanes::Float fadeLanes(NoiseLanes::Float t) {
+    typedef NoiseLanes L;
+    const L::Float t3 = L::mul(L::mul(t, t), t);
+    const L::Float inner = L::sub(L::mul(t, L::set(6)), L::set(15));
+    return L::mul(t3, L::add(L::mul(t, inner), L::set(10)));
+}
+
+NoiseLanes::Float lerpLanes(NoiseLanes::Float t, NoiseLanes::Float a, NoiseLanes::Float b) {
+    typedef NoiseLanes L;
+    return L::add(a, L::mul(t, L::sub(b, a)));
+}
+
+// value noise at 8 points: a hashed value in [-1, 1] per lattice point, interpolated like the Perlin noise
+void valueNoise8(uint32_t seed, const float* xs, const float* ys, const float* zs, float* out) {
+    typedef NoiseLanes L;
+    const int width = L::width;
+
+    // the last cell's values, the points of a batch are mostly neighbors
+    int lastX = 0, lastY = 0, lastZ = 0;
+    bool hasLastCell = false;
+    float lastValues[8];
+
+    for(int base = 0; base < 8; base += width) {
+        L::Float x = L::load(xs + base);
+        L::Float y = L::load(ys + base);
+        L::Float z = L::load(zs + base);
+
+        int X[width], Y[width], Z[width];
+        x = L::sub(x, L::floor(x, X));
+        y = L::sub(y, L::floor(y, Y));
+        z = L::sub(z, L::floor(z, Z));
+
+        float values[8][width];
+        for(int i = 0; i < width; i++) {
+            if(!hasLastCell || X[i] != lastX || Y[i] != lastY || Z[i] != lastZ) {
+                for(int c = 0; c < 8; c++) {
+                    const uint32_t h = WorldNoise::hashLatticePoint(seed, X[i] + (c & 1), Y[i] + ((c >> 1) & 1), Z[i] + ((c >> 2) & 1));
+                    lastValues[c] = (float) (h >> 8) * (2.0f / 16777216.0f) - 1.0f;
+                }
+                lastX = X[i];
+                lastY = Y[i];
+                lastZ = Z[i];
+                hasLastCell = true;
+            }
+            for(int c = 0; c < 8; c++) {
+                values[c][i] = lastValues[c];
+            }
+        }
+
+        const L::Float u = fadeLanes(x);
+        const L::Float v = fadeLanes(y);
+        const L::Float w = fadeLanes(z);
+        const L::Float nx00 = lerpLanes(u, L::load(values[0]), L::load(values[1]));
+        const L::Float nx01 = lerpLanes(u, L::load(values[4]), L::load(values[5]));
+        const L::Float nx10 = lerpLanes(u, L::load(values[2]), L::load(values[3]));
+        const L::Float nx11 = lerpLanes(u, L::load(values[6]), L::load(values[7]));
+        const L::Float nxy0 = lerpLanes(v, nx00, nx10);
+        const L::Float nxy1 = lerpLanes(v, nx01, nx11);
+        L::store(out + base, lerpLanes(w, nxy0, nxy1));
+    }
+}
+
+// cellular (Worley F1) noise at 8 points: the distance to the nearest feature point, one per lattice cell
+// at a hashed position within it, searched over the 27 cells around the point's. Point by point, the
+// search doesn't map onto lanes
+void cellularNoise8(uint32_t seed, const float* xs, const float* ys, const float* zs, float* out) {
+    // the feature points around the last cell, relative to its corner
+    int lastX = 0, lastY = 0, lastZ = 0;
+    bool hasLastCell = false;
+    float featureX[27], featureY[27], featureZ[27];
+
+    for(int i = 0; i < 8; i++) {
+        const float fx = std::floor(xs[i]);
+        const float fy = std::floor(ys[i]);
+        const float fz = std::floor(zs[i]);
+        const int X = (int) fx;
+        const int Y = (int) fy;
+        const int Z = (int) fz;
+
+        if(!hasLastCell || X != lastX || Y != lastY || Z != lastZ) {
+            int f = 0;
+            for(int dz = -1; dz <= 1; dz++) {
+                for(int dy = -1; dy <= 1; dy++) {
+                    for(int dx = -1; dx <= 1; dx++) {
+                        // 10 bits of the hash per axis
+                        const uint32_t h = WorldNoise::hashLatticePoint(seed, X + dx, Y + dy, Z + dz);
+                        featureX[f] = dx + (float) (h & 0x3ff) / 1024.0f;
+                        featureY[f] = dy + (float) ((h >> 10) & 0x3ff) / 1024.0f;
+                        featureZ[f] = dz + (float) ((h >> 20) & 0x3ff) / 1024.0f;
+                        f++;
+                    }
+                }
+            }
+            lastX = X;
+            lastY = Y;
+            lastZ = Z;
+            hasLastCell = true;
+        }
+
+        const float x = xs[i] - fx;
+        const float y = ys[i] - fy;
+        const float z = zs[i] - fz;
+        float nearest = INFINITY;
+        for(int f = 0; f < 27; f++) {
+            const float ox = featureX[f] - x;
+            const float oy = featureY[f] - y;
+            const float oz = featureZ[f] - z;
+            nearest = std::min(nearest, ox * ox + oy * oy + oz * oz);
+        }
+        out[i] = std::sqrt(nearest);
+    }
+}
+
+}
+
+std::optional<NoiseGraph> NoiseGraph::parse(const std::string& text, std::string& outError) {
+    NoiseGraph graph;
+    std::istringstream lines(text);
+    std::string line;
+    int lineNumber = 0;
+    auto fail = [&](const std::string& reason) {
+        outError = "line " + std::to_string(lineNumber) + ": " + reason;
+        return std::nullopt;
+    };
+
+    while(std::getline(lines, line)) {
+        lineNumber++;
+        const std::vector<std::string> tokens = splitTokens(line.substr(0, line.find('#')));
+        if(tokens.empty()) {
+            continue;
+        }
+
+        if(tokens[0] == "output") {
+            if(tokens.size() != 4 || !isName(tokens[1]) || tokens[2] != "=") {
+                return fail("expected output name = node");
+            }
+            const int node = graph.findNode(tokens[3]);
+            if(node < 0) {
+                return fail("unknown node " + tokens[3]);
+            }
+            if(graph.findOutput(tokens[1]) >= 0) {
+                return fail("output " + tokens[1] + " is already bound");
+            }
+            graph.outputs.push_back({tokens[1], node});
+            continue;
+        }
+
+        if(tokens.size() < 3 || !isName(tokens[0]) || tokens[1] != "=") {
+            return fail("expected name = op inputs... key=value...");
+        }
+        if(graph.findNode(tokens[0]) >= 0) {
+            return fail("node " + tokens[0] + " is already defined");
+        }
+
+        NoiseGraphNode node;
+        node.name = tokens[0];
+        const std::string& op = tokens[2];
+
+        std::vector<std::string> inputs;
+        std::vector<std::pair<std::string, std::string>> keys;
+        for(size_t t = 3; t < tokens.size(); t++) {
+            const size_t equals = tokens[t].find('=');
+            if(equals == std::string::npos) {
+                inputs.push_back(tokens[t]);
+            }
+            else {
+                keys.push_back({tokens[t].substr(0, equals), tokens[t].substr(equals + 1)});
+            }
+        }
+
+        size_t numInputs = 0;
+        std::vector<std::string> allowedKeys;
+        if(parseSource(op, node.source)) {
+            node.op = ENoiseNodeOp::Source;
+            allowedKeys = {"frequency", "seed"};
+        }
+        else if(op == "fbm") {
+            node.op = ENoiseNodeOp::Source;
+            node.octaves = 4;
+            allowedKeys = {"source", "frequency", "octaves", "lacunarity", "gain", "seed"};
+        }
+        else if(op == "warp") {
+            node.op = ENoiseNodeOp::Warp;
+            numInputs = 4;
+            allowedKeys = {"amplitude"};
+        }
+        else if(op == "height") {
+            node.op = ENoiseNodeOp::Height;
+            allowedKeys = {"slope", "offset"};
+        }
+        else if(op == "add" || op == "sub" || op == "mul" || op == "min" || op == "max") {
+            node.op = op == "add"? ENoiseNodeOp::Add : op == "sub"? ENoiseNodeOp::Sub : op == "mul"? ENoiseNodeOp::Mul
+                    : op == "min"? ENoiseNodeOp::Min : ENoiseNodeOp::Max;
+            numInputs = 2;
+        }
+        else if(op == "clamp") {
+            node.op = ENoiseNodeOp::Clamp;
+            numInputs = 3;
+        }
+        else if(op == "select") {
+            node.op = ENoiseNodeOp::Select;
+            numInputs = 3;
+            allowedKeys = {"threshold"};
+        }
+        else {
+            return fail("unknown op " + op);
+        }
+
+        if(inputs.size() != numInputs) {
+            return fail(op + " takes " + std::to_string(numInputs) + " inputs");
+        }
+        for(const std::string& input : inputs) {
+            NoiseGraphOperand operand;
+            operand.node = graph.findNode(input);
+            if(operand.node < 0 && !parseFloat(input, operand.value)) {
+                return fail("unknown node " + input);
+            }
+            node.inputs.push_back(operand);
+        }
+        if(node.op == ENoiseNodeOp::Warp && (node.inputs[0].node < 0 || graph.nodes[node.inputs[0].node].op != ENoiseNodeOp::Source)) {
+            return fail("warp's first input must be a perlin, value, cellular or fbm node");
+        }
+
+        for(const auto& [key, value] : keys) {
+            if(std::find(allowedKeys.begin(), allowedKeys.end(), key) == allowedKeys.end()) {
+                return fail(op + " has no key " + key);
+            }
+
+            bool valid = true;
+            if(key == "frequency") {
+                std::string components = value;
+                std::replace(components.begin(), components.end(), ',', ' ');
+                const std::vector<std::string> axes = splitTokens(components);
+                if(axes.size() == 1) {
+                    valid = parseFloat(axes[0], node.frequency.x);
+                    node.frequency = simd::make_float3(node.frequency.x, node.frequency.x, node.frequency.x);
+                }
+                else if(axes.size() == 3) {
+                    valid = parseFloat(axes[0], node.frequency.x) && parseFloat(axes[1], node.frequency.y) && parseFloat(axes[2], node.frequency.z);
+                }
+                else {
+                    valid = false;
+                }
+            }
+            else if(key == "seed") {
+                int seed = 0;
+                valid = parseInt(value, seed);
+                node.seed = (uint32_t) seed;
+            }
+            else if(key == "source") {
+                valid = parseSource(value, node.source);
+            }
+            else if(key == "octaves") {
+                valid = parseInt(value, node.octaves) && node.octaves >= 1 && node.octaves <= 16;
+            }
+            else {
+                float* field = key == "lacunarity"? &node.lacunarity : key == "gain"? &node.gain : key == "amplitude"? &node.amplitude
+                             : key == "slope"? &node.slope : key == "offset"? &node.offset : &node.threshold;
+                valid = parseFloat(value, *field);
+            }
+            if(!valid) {
+                return fail("invalid " + key + " " + value);
+            }
+        }
+
+        graph.nodes.push_back(node);
+    }
+
+    if(graph.outputs.empty()) {
+        outError = "no outputs";
+        return std::nullopt;
+    }
+    return graph;
+}
+
+std::optional<NoiseGraph> NoiseGraph::load(const std::string& path, std::string& outError) {
+    std::ifstream file(path);
+    if(!file) {
+        outError = "can't open " + path;
+        return std::nullopt;
+    }
+    std::stringstream text;
+    text << file.rdbuf();
+
+    std::optional<NoiseGraph> graph = parse(text.str(), outError);
+    if(!graph.has_value()) {
+        outError = path + ", " + outError;
+    }
+    return graph;
+}
+
+int NoiseGraph::findOutput(const std::string& outputName) const {
+    for(const auto& [name, node] : outputs) {
+        if(name == outputName) {
+            return node;
+        }
+    }
+    return -1;
+}
+
+int NoiseGraph::findNode(const std::string& name) const {
+    for(int i = 0; i < (int) nodes.size(); i++) {
+        if(nodes[i].name == name) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+std::optional<NoiseGraphPlan> NoiseGraphPlan::compile(const NoiseGraph& graph, const std::vector<std::string>& outputNames,
+                                                      uint32_t seed, std::string& outError) {
+    const std::vector<NoiseGraphNode>& nodes = graph.getNodes();
+    const int numNodes = (int) nodes.size();
+
+    std::vector<int> outputNodes;
+    std::vector<bool> isOutput(numNodes, false);
+    for(const std::string& outputName : outputNames) {
+        const int node = graph.findOutput(outputName);
+        if(node < 0) {
+            outError = "no output " + outputName;
+            return std::nullopt;
+        }
+        outputNodes.push_back(node);
+        isOutput[node] = true;
+    }
+
+    // the nodes the outputs depend on, walking back from them (inputs come before their readers)
+    std::vector<bool> needed = isOutput;
+    for(int n = numNodes - 1; n >= 0; n--) {
+        if(needed[n]) {
+            for(const NoiseGraphOperand& input : nodes[n].inputs) {
+                if(input.node >= 0) {
+                    needed[input.node] = true;
+                }
+            }
+        }
+    }
+
+    // instructions reading each node's value (a warp samples its source node instead, a source only
+    // warped is never evaluated on its own)
+    std::vector<int> numReads(numNodes, 0);
+    for(int n = 0; n < numNodes; n++) {
+        if(!needed[n]) {
+            continue;
+        }
+        for(size_t i = 0; i < nodes[n].inputs.size(); i++) {
+            const int input = nodes[n].inputs[i].node;
+            if(input >= 0 && !(nodes[n].op == ENoiseNodeOp::Warp && i == 0)) {
+                numReads[input]++;
+            }
+        }
+    }
+
+    // multiplies only read by an add are fused into it, fusedInput is the add's input they were
+    std::vector<bool> fused(numNodes, false);
+    std::vector<int> fusedInput(numNodes, -1);
+    for(int n = 0; n < numNodes; n++) {
+        if(!needed[n] || nodes[n].op != ENoiseNodeOp::Add) {
+            continue;
+        }
+        for(int i = 0; i < 2; i++) {
+            const int input = nodes[n].inputs[i].node;
+            if(input >= 0 && nodes[input].op == ENoiseNodeOp::Mul && numReads[input] == 1 && !isOutput[input]) {
+                fused[input] = true;
+                fusedInput[n] = i;
+                break;
+            }
+        }
+    }
+
+    NoiseGraphPlan plan;
+    std::vector<int> nodeRegisters(numNodes, -1);
+    std::vector<int> remainingReads = numReads;
+    std::array<bool, maxRegisters> registerInUse = {};
+
+    auto operandOf = [&](const NoiseGraphOperand& input) {
+        Operand operand;
+        if(input.node >= 0) {
+            operand.reg = nodeRegisters[input.node];
+        }
+        else {
+            operand.value = input.value;
+        }
+        return operand;
+    };
+    auto addSource = [&](const NoiseGraphNode& node, bool warped, float warpAmplitude) {
+        Source source;
+        source.kind = node.source;
+        source.warped = warped;
+        source.warpAmplitude = warpAmplitude;
+        simd::float3 frequency = node.frequency;
+        float amplitude = 1.0f;
+        for(int o = 0; o < node.octaves; o++) {
+            source.noises.push_back(WorldNoise(seed + node.seed * nodeSeedStep + (uint32_t) o * octaveSeedStep));
+            source.frequencies.push_back(frequency);
+            source.amplitudes.push_back(amplitude);
+            frequency *= node.lacunarity;
+            amplitude *= node.gain;
+        }
+        plan.sources.push_back(source);
+        return (int) plan.sources.size() - 1;
+    };
+
+    for(int n = 0; n < numNodes; n++) {
+        if(!needed[n] || fused[n] || (numReads[n] == 0 && !isOutput[n])) {
+            continue;
+        }
+        const NoiseGraphNode& node = nodes[n];
+        Instruction instruction;
+        // the inputs whose values the instruction reads
+        std::vector<NoiseGraphOperand> reads;
+
+        switch(node.op) {
+            case ENoiseNodeOp::Source:
+                instruction.op = EOp::Source;
+                instruction.source = addSource(node, false, 0.0f);
+                break;
+            case ENoiseNodeOp::Warp:
+                instruction.op = EOp::Source;
+                instruction.source = addSource(nodes[node.inputs[0].node], true, node.amplitude);
+                reads = {node.inputs[1], node.inputs[2], node.inputs[3]};
+                break;
+            case ENoiseNodeOp::Height:
+                instruction.op = EOp::Height;
+                instruction.args[0].value = node.slope;
+                instruction.args[1].value = node.offset;
+                break;
+            case ENoiseNodeOp::Add:
+                if(fusedInput[n] >= 0) {
+                    const NoiseGraphNode& mul = nodes[node.inputs[fusedInput[n]].node];
+                    instruction.op = EOp::MulAdd;
+                    reads = {mul.inputs[0], mul.inputs[1], node.inputs[1 - fusedInput[n]]};
+                }
+                else {
+                    instruction.op = EOp::Add;
+                    reads = node.inputs;
+                }
+                break;
+            case ENoiseNodeOp::Sub:
+            case ENoiseNodeOp::Mul:
+            case ENoiseNodeOp::Min:
+            case ENoiseNodeOp::Max:
+            case ENoiseNodeOp::Clamp:
+                instruction.op = node.op == ENoiseNodeOp::Sub? EOp::Sub : node.op == ENoiseNodeOp::Mul? EOp::Mul
+                               : node.op == ENoiseNodeOp::Min? EOp::Min : node.op == ENoiseNodeOp::Max? EOp::Max : EOp::Clamp;
+                reads = node.inputs;
+                break;
+            case ENoiseNodeOp::Select:
+                instruction.op = EOp::Select;
+                reads = node.inputs;
+                instruction.args[3].value = node.threshold;
+                break;
+        }
+
+        for(size_t i = 0; i < reads.size(); i++) {
+            instruction.args[i] = operandOf(reads[i]);
+        }
+        // registers whose last reader this is are free again, the instruction may write to one of them
+        // (it reads its operands before writing)
+        for(const NoiseGraphOperand& read : reads) {
+            if(read.node >= 0 && --remainingReads[read.node] == 0 && !isOutput[read.node]) {
+                registerInUse[nodeRegisters[read.node]] = false;
+            }
+        }
+
+        const auto freeRegister = std::find(registerInUse.begin(), registerInUse.end(), false);
+        if(freeRegister == registerInUse.end()) {
+            outError = "the graph needs more than " + std::to_string(maxRegisters) + " registers";
+            return std::nullopt;
+        }
+        *freeRegister = true;
+        instruction.dst = (int) (freeRegister - registerInUse.begin());
+        plan.numRegisters = std::max(plan.numRegisters, instruction.dst + 1);
+        nodeRegisters[n] = instruction.dst;
+        plan.instructions.push_back(instruction);
+    }
+
+    for(int node : outputNodes) {
+        plan.outputRegisters.push_back(nodeRegisters[node]);
+    }
+    return plan;
+}
+
+void NoiseGraphPlan::evaluate(const float* x, const float* y, const float* z, int count, float* const* outputs) const {
+    alignas(32) float registers[maxRegisters][8];
+    const int numOutputs = getNumOutputs();
+
+    int i = 0;
+    for(; i + 8 <= count; i += 8) {
+        evaluate8(x + i, y + i, z + i, registers);
+        for(int o = 0; o < numOutputs; o++) {
+            std::copy(registers[outputRegisters[o]], registers[outputRegisters[o]] + 8, outputs[o] + i);
+        }
+    }
+
+    if(i < count) {
+        const int rest = count - i;
+        float padX[8] = {}, padY[8] = {}, padZ[8] = {};
+        std::copy(x + i, x + count, padX);
+        std::copy(y + i, y + count, padY);
+        std::copy(z + i, z + count, padZ);
+        evaluate8(padX, padY, padZ, registers);
+        for(int o = 0; o < numOutputs; o++) {
+            std::copy(registers[outputRegisters[o]], registers[outputRegisters[o]] + rest, outputs[o] + i);
+        }
+    }
+}
+
+void NoiseGraphPlan::evaluate8(const float* x, const float* y, const float* z, float (*registers)[8]) const {
+    typedef NoiseLanes L;
+    auto load = [registers](const Operand& operand, int lane) {
+        return operand.reg >= 0? L::load(registers[operand.reg] + lane) : L::set(operand.value);
+    };
+
+    for(const Instruction& instruction : instructions) {
+        if(instruction.op == EOp::Source) {
+            evaluateSource8(sources[instruction.source], instruction, x, y, z, registers);
+            continue;
+        }
+
+        const std::array<Operand, 4>& args = instruction.args;
+        float* dst = registers[instruction.dst];
+        for(int lane = 0; lane < 8; lane += L::width) {
+            L::Float result = L::set(0);
+            switch(instruction.op) {
+                case EOp::Height:
+                    result = L::add(L::mul(L::load(y + lane), load(args[0], lane)), load(args[1], lane));
+                    break;
+                case EOp::Add:
+                    result = L::add(load(args[0], lane), load(args[1], lane));
+                    break;
+                case EOp::Sub:
+                    result = L::sub(load(args[0], lane), load(args[1], lane));
+                    break;
+                case EOp::Mul:
+                    result = L::mul(load(args[0], lane), load(args[1], lane));
+                    break;
+                case EOp::MulAdd:
+                    result = L::add(L::mul(load(args[0], lane), load(args[1], lane)), load(args[2], lane));
+                    break;
+                case EOp::Min:
+                    result = L::min(load(args[0], lane), load(args[1], lane));
+                    break;
+                case EOp::Max:
+                    result = L::max(load(args[0], lane), load(args[1], lane));
+                    break;
+                case EOp::Clamp:
+                    result = L::min(L::max(load(args[0], lane), load(args[1], lane)), load(args[2], lane));
+                    break;
+                case EOp::Select:
+                    result = L::select(load(args[0], lane), load(args[1], lane), load(args[2], lane), load(args[3], lane));
+                    break;
+                case EOp::Source:
+                    break;
+            }
+            L::store(dst + lane, result);
+        }
+    }
+}
+
+void NoiseGraphPlan::evaluateSource8(const Source& source, const Instruction& instruction, const float* x, const float* y,
+                                     const float* z, float (*registers)[8]) const {
+    typedef NoiseLanes L;
+
+    // the sample points, displaced first if warped (the displacement is read before dst is written, it
+    // may be the same register)
+    float px[8], py[8], pz[8];
+    if(source.warped) {
+        const L::Float amplitude = L::set(source.warpAmplitude);
+        const std::array<Operand, 4>& args = instruction.args;
+        auto displacement = [registers](const Operand& operand, int lane) {
+            return operand.reg >= 0? L::load(registers[operand.reg] + lane) : L::set(operand.value);
+        };
+        for(int lane = 0; lane < 8; lane += L::width) {
+            L::store(px + lane, L::add(L::load(x + lane), L::mul(amplitude, displacement(args[0], lane))));
+            L::store(py + lane, L::add(L::load(y + lane), L::mul(amplitude, displacement(args[1], lane))));
+            L::store(pz + lane, L::add(L::load(z + lane), L::mul(amplitude, displacement(args[2], lane))));
+        }
+    }
+    else {
+        std::copy(x, x + 8, px);
+        std::copy(y, y + 8, py);
+        std::copy(z, z + 8, pz);
+    }
+
+    float* dst = registers[instruction.dst];
+    float sx[8], sy[8], sz[8], octave[8];
+    for(int o = 0; o < (int) source.noises.size(); o++) {
+        const simd::float3 frequency = source.frequencies[o];
+        for(int lane = 0; lane < 8; lane += L::width) {
+            L::store(sx + lane, L::mul(L::load(px + lane), L::set(frequency.x)));
+            L::store(sy + lane, L::mul(L::load(py + lane), L::set(frequency.y)));
+            L::store(sz + lane, L::mul(L::load(pz + lane), L::set(frequency.z)));
+        }
+
+        // the first octave (at amplitude 1) straight into dst, the others added to it
+        float* out = o == 0? dst : octave;
+        switch(source.kind) {
+            case ENoiseSource::Perlin:
+                source.noises[o].noise8(sx, sy, sz, out);
+                break;
+            case ENoiseSource::Value:
+                valueNoise8(source.noises[o].getSeed(), sx, sy, sz, out);
+                break;
+            case ENoiseSource::Cellular:
+                cellularNoise8(source.noises[o].getSeed(), sx, sy, sz, out);
+                break;
+        }
+        if(o > 0) {
+            const L::Float amplitude = L::set(source.amplitudes[o]);
+            for(int lane = 0; lane < 8; lane += L::width) {
+                L::store(dst + lane, L::add(L::load(dst + lane), L::mul(amplitude, L::load(octave + lane))));
+            }
+        }
+    }
+}
+
+std::pair<float, float> NoiseGraphPlan::getOutputBounds(int output, float minY, float maxY) const {
+    // interval arithmetic over the instructions, one interval per register
+    std::array<std::pair<float, float>, maxRegisters> bounds;
+    auto boundsOf = [&bounds](const Operand& operand) {
+        return operand.reg >= 0? bounds[operand.reg] : std::make_pair(operand.value, operand.value);
+    };
+    auto multiply = [](std::pair<float, float> a, std::pair<float, float> b) {
+        const float products[4] = {a.first * b.first, a.first * b.second, a.second * b.first, a.second * b.second};
+        return std::make_pair(*std::min_element(products, products + 4), *std::max_element(products, products + 4));
+    };
+
+    for(const Instruction& instruction : instructions) {
+        const std::array<Operand, 4>& args = instruction.args;
+        std::pair<float, float> result;
+        switch(instruction.op) {
+            case EOp::Source: {
+                const Source& source = sources[instruction.source];
+                const std::pair<float, float> octaveBounds = source.kind == ENoiseSource::Perlin? std::make_pair(-maxPerlinMagnitude, maxPerlinMagnitude)
+                                                           : source.kind == ENoiseSource::Value? std::make_pair(-1.0f, 1.0f)
+                                                           : std::make_pair(0.0f, std::sqrt(3.0f));
+                result = {0.0f, 0.0f};
+                for(float amplitude : source.amplitudes) {
+                    const std::pair<float, float> scaled = multiply(octaveBounds, {amplitude, amplitude});
+                    result = {result.first + scaled.first, result.second + scaled.second};
+                }
+                break;
+            }
+            case EOp::Height: {
+                const float slope = args[0].value;
+                const float offset = args[1].value;
+                const float atMinY = slope * minY + offset;
+                const float atMaxY = slope * maxY + offset;
+                result = {std::min(atMinY, atMaxY), std::max(atMinY, atMaxY)};
+                break;
+            }
+            case EOp::Add:
+            case EOp::MulAdd: {
+                const std::pair<float, float> a = instruction.op == EOp::MulAdd? multiply(boundsOf(args[0]), boundsOf(args[1])) : boundsOf(args[0]);
+                const std::pair<float, float> b = boundsOf(args[instruction.op == EOp::MulAdd? 2 : 1]);
+                result = {a.first + b.first, a.second + b.second};
+                break;
+            }
+            case EOp::Sub:
+                result = {boundsOf(args[0]).first - boundsOf(args[1]).second, boundsOf(args[0]).second - boundsOf(args[1]).first};
+                break;
+            case EOp::Mul:
+                result = multiply(boundsOf(args[0]), boundsOf(args[1]));
+                break;
+            case EOp::Min:
+                result = {std::min(boundsOf(args[0]).first, boundsOf(args[1]).first), std::min(boundsOf(args[0]).second, boundsOf(args[1]).second)};
+                break;
+            case EOp::Max:
+                result = {std::max(boundsOf(args[0]).first, boundsOf(args[1]).first), std::max(boundsOf(args[0]).second, boundsOf(args[1]).second)};
+                break;
+            case EOp::Clamp: {
+                const std::pair<float, float> value = boundsOf(args[0]);
+                const std::pair<float, float> lo = boundsOf(args[1]);
+                const std::pair<float, float> hi = boundsOf(args[2]);
+                result = {std::min(std::max(value.first, lo.first), hi.first), std::min(std::max(value.second, lo.second), hi.second)};
+                break;
+            }
+            case EOp::Select:
+                result = {std::min(boundsOf(args[0]).first, boundsOf(args[1]).first), std::max(boundsOf(args[0]).second, boundsOf(args[1]).second)};
+                break;
+        }
+        bounds[instruction.dst] = result;
+    }
+    return bounds[outputRegisters[output]];
+}
+
+int NoiseGraphPlan::getNumNoiseSamplesPerPoint() const {
+    int numSamples = 0;
+    for(const Source& source : sources) {
+        numSamples += (int) source.noises.size();
+    }
+    return numSamples;
+}
@@ -0,0 +1,187 @@
+#pragma once
+#include <simd/simd.h>
+#include <string>
+#include <vector>
+#include <array>
+#include <utility>
+#include <optional>
+#include <cstdint>
+#include "WorldNoise.hpp"
+
+// the noise a source node samples
+enum class ENoiseSource {
+    // WorldNoise, within about [-1, 1]
+    Perlin,
+    // a hashed value in [-1, 1] per lattice point, smoothly interpolated
+    Value,
+    // distance to the nearest of one hashed feature point per lattice cell, in [0, sqrt(3)]
+    Cellular
+};
+
+enum class ENoiseNodeOp {
+    // fBm of a source's noise (a single octave for perlin, value and cellular)
+    Source,
+    // a source sampled at p + amplitude * (inputs 1, 2, 3), input 0 being the source node
+    Warp,
+    // slope * y + offset
+    Height,
+    Add,
+    Sub,
+    Mul,
+    Min,
+    Max,
+    // input 0 clamped to [input 1, input 2]
+    Clamp,
+    // input 2 > threshold? input 1 : input 0
+    Select
+};
+
+// an input of a node, another node or a constant
+struct NoiseGraphOperand {
+    // index of the node in the graph, -1 for value
+    int node = -1;
+    float value = 0.0f;
+};
+
+struct NoiseGraphNode {
+    std::string name;
+    ENoiseNodeOp op = ENoiseNodeOp::Source;
+    std::vector<NoiseGraphOperand> inputs;
+
+    // Source: the sum of octaves octaves of the source's noise at p * frequency, each one at lacunarity
+    // times the frequency and gain times the amplitude of the one before (the first at amplitude 1)
+    ENoiseSource source = ENoiseSource::Perlin;
+    simd::float3 frequency = simd::make_float3(1, 1, 1);
+    int octaves = 1;
+    float lacunarity = 2.0f;
+    float gain = 0.5f;
+    // added to the world seed, so sources of the same kind differ
+    uint32_t seed = 0;
+    // Warp
+    float amplitude = 1.0f;
+    // Height
+    float slope = 1.0f;
+    float offset = 0.0f;
+    // Select
+    float threshold = 0.0f;
+};
+
+// A terrain function of the world position, as a graph of noise nodes described in a text file (see
+// Assets/Terrain/terrain.noisegraph). One node per line, after its name:
+//
+//     name = op input... key=value...      # comment
+//     output outputName = node
+//
+// where an input is the name of an earlier node or a number, and op one of
+//
+//     perlin | value | cellular    frequency=f or fx,fy,fz  seed=n
+//     fbm                          source=perlin|value|cellular  frequency  octaves=n  lacunarity=l  gain=g  seed=n
+//                                  (4 octaves of perlin, lacunarity 2 and gain 0.5 if left out)
+//     warp source dx dy dz         amplitude=a (source is a perlin, value, cellular or fbm node)
+//     height                       slope=s  offset=o
+//     add a b | sub a b | mul a b | min a b | max a b
+//     clamp v lo hi
+//     select a b cond              threshold=t
+//
+// Positions are in voxels, world space. See NoiseGraphPlan to evaluate it
+class NoiseGraph {
+public:
+    // nullopt, with the line and reason in outError, if the text isn't a valid graph
+    static std::optional<NoiseGraph> parse(const std::string& text, std::string& outError);
+    static std::optional<NoiseGraph> load(const std::string& path, std::string& outError);
+
+    const std::vector<NoiseGraphNode>& getNodes() const { return nodes; }
+
+    // the index of the node bound to the output, -1 if there's none
+    int findOutput(const std::string& outputName) const;
+
+private:
+    // inputs always come before the nodes that read them
+    std::vector<NoiseGraphNode> nodes;
+    std::vector<std::pair<std::string, int>> outputs;
+
+    int findNode(const std::string& name) const;
+};
+
+// A NoiseGraph compiled into a flat list of instructions, evaluated 8 points at a time through NoiseLanes.
+//
+// All the instructions run on a batch before the next batch starts, over a fixed file of 8-float
+// registers (on the stack of evaluate), so intermediate values stay in L1 and no node allocates or keeps
+// a buffer of its own. Nodes the compiled outputs don't depend on are dropped, registers are reused once
+// their value's last reader has run, a multiply read only by an add becomes one multiply-add, fBm octaves
+// run within their source's instruction, and a warped source reads its displacement straight from the
+// registers.
+//
+// Thread-safe (all members are const).
+class NoiseGraphPlan {
+public:
+    static const int maxRegisters = 16;
+
+    // The plan of the graph's outputs outputNames (in that order), its noise seeded with seed. nullopt,
+    // with the reason in outError, if an output is missing or it needs more than maxRegisters registers
+    static std::optional<NoiseGraphPlan> compile(const NoiseGraph& graph, const std::vector<std::string>& outputNames,
+                                                 uint32_t seed, std::string& outError);
+
+    // outputs[o][i] is the o-th output at (x[i], y[i], z[i]), for count points (in batches of 8, the last
+    // points padded to a batch)
+    void evaluate(const float* x, const float* y, const float* z, int count, float* const* outputs) const;
+
+    // bounds of the output over all x and z, and y in [minY, maxY], e.g. to skip the chunks it's
+    // negative everywhere in. Conservative: the output may stay well within them
+    std::pair<float, float> getOutputBounds(int output, float minY, float maxY) const;
+
+    int getNumOutputs() const { return (int) outputRegisters.size(); }
+    int getNumInstructions() const { return (int) instructions.size(); }
+    int getNumRegisters() const { return numRegisters; }
+    // noise samples (octaves of all the sources) per point
+    int getNumNoiseSamplesPerPoint() const;
+
+private:
+    enum class EOp {
+        Source,
+        Height,
+        Add,
+        Sub,
+        Mul,
+        // args[0] * args[1] + args[2]
+        MulAdd,
+        Min,
+        Max,
+        Clamp,
+        Select
+    };
+
+    // a register, or an immediate value
+    struct Operand {
+        int reg = -1;
+        float value = 0.0f;
+    };
+
+    struct Instruction {
+        EOp op;
+        int dst = -1;
+        // Source: the warp displacement if warped. Height: slope and offset. Select: a, b, cond and threshold
+        std::array<Operand, 4> args;
+        // index in sources
+        int source = -1;
+    };
+
+    struct Source {
+        ENoiseSource kind = ENoiseSource::Perlin;
+        // per octave
+        std::vector<WorldNoise> noises;
+        std::vector<simd::float3> frequencies;
+        std::vector<float> amplitudes;
+        bool warped = false;
+        float warpAmplitude = 0.0f;
+    };
+
+    std::vector<Instruction> instructions;
+    std::vector<Source> sources;
+    std::vector<int> outputRegisters;
+    int numRegisters = 0;
+
+    void evaluate8(const float* x, const float* y, const float* z, float (*registers)[8]) const;
+    void evaluateSource8(const Source& source, const Instruction& instruction, const float* x, const float* y,
+                         const float* z, float (*registers)[8]) const;
+};
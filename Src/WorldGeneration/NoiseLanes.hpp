@@ -0,0 +1,210 @@
+#pragma once
+#include <simd/simd.h>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <algorithm>
+
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+// The float operations of the batched Perlin noise over one vector of lanes: 8 on AVX2, 4 on SSE2 and
+// NEON, or a single float otherwise. Each one rounds like its scalar counterpart, so a batch matches the
+// scalar noise to the bit as long as both are compiled without FMA contraction (see the .cpp files).
+#if defined(__AVX2__)
+struct NoiseLanes {
+    typedef __m256 Float;
+    static const int width = 8;
+
+    static Float load(const float* p) { return _mm256_loadu_ps(p); }
+    static void store(float* p, Float v) { _mm256_storeu_ps(p, v); }
+    static Float set(float s) { return _mm256_set1_ps(s); }
+    static Float add(Float a, Float b) { return _mm256_add_ps(a, b); }
+    static Float sub(Float a, Float b) { return _mm256_sub_ps(a, b); }
+    static Float mul(Float a, Float b) { return _mm256_mul_ps(a, b); }
+    static Float abs(Float v) { return _mm256_andnot_ps(_mm256_set1_ps(-0.0f), v); }
+    static Float min(Float a, Float b) { return _mm256_min_ps(a, b); }
+    static Float max(Float a, Float b) { return _mm256_max_ps(a, b); }
+    // cond > threshold? b : a
+    static Float select(Float a, Float b, Float cond, Float threshold) { return _mm256_blendv_ps(a, b, _mm256_cmp_ps(cond, threshold, _CMP_GT_OQ)); }
+
+    // floor(v), also stored as ints into outInts
+    static Float floor(Float v, int* outInts) {
+        const Float f = _mm256_floor_ps(v);
+        _mm256_storeu_si256((__m256i*) outInts, _mm256_cvttps_epi32(f));
+        return f;
+    }
+};
+#elif defined(__SSE2__)
+struct NoiseLanes {
+    typedef __m128 Float;
+    static const int width = 4;
+
+    static Float load(const float* p) { return _mm_loadu_ps(p); }
+    static void store(float* p, Float v) { _mm_storeu_ps(p, v); }
+    static Float set(float s) { return _mm_set1_ps(s); }
+    static Float add(Float a, Float b) { return _mm_add_ps(a, b); }
+    static Float sub(Float a, Float b) { return _mm_sub_ps(a, b); }
+    static Float mul(Float a, Float b) { return _mm_mul_ps(a, b); }
+    static Float abs(Float v) { return _mm_andnot_ps(_mm_set1_ps(-0.0f), v); }
+    static Float min(Float a, Float b) { return _mm_min_ps(a, b); }
+    static Float max(Float a, Float b) { return _mm_max_ps(a, b); }
+    static Float select(Float a, Float b, Float cond, Float threshold) {
+        const Float mask = _mm_cmpgt_ps(cond, threshold);
+        return _mm_or_ps(_mm_and_ps(mask, b), _mm_andnot_ps(mask, a));
+    }
+
+    static Float floor(Float v, int* outInts) {
+        // truncate, then step the negative non-integers down (SSE2 has no floor)
+        const Float t = _mm_cvtepi32_ps(_mm_cvttps_epi32(v));
+        const Float f = _mm_sub_ps(t, _mm_and_ps(_mm_cmpgt_ps(t, v), _mm_set1_ps(1.0f)));
+        _mm_storeu_si128((__m128i*) outInts, _mm_cvttps_epi32(f));
+        return f;
+    }
+};
+#elif defined(__ARM_NEON)
+struct NoiseLanes {
+    typedef float32x4_t Float;
+    static const int width = 4;
+
+    static Float load(const float* p) { return vld1q_f32(p); }
+    static void store(float* p, Float v) { vst1q_f32(p, v); }
+    static Float set(float s) { return vdupq_n_f32(s); }
+    static Float add(Float a, Float b) { return vaddq_f32(a, b); }
+    static Float sub(Float a, Float b) { return vsubq_f32(a, b); }
+    static Float mul(Float a, Float b) { return vmulq_f32(a, b); }
+    static Float abs(Float v) { return vabsq_f32(v); }
+    static Float min(Float a, Float b) { return vminq_f32(a, b); }
+    static Float max(Float a, Float b) { return vmaxq_f32(a, b); }
+    static Float select(Float a, Float b, Float cond, Float threshold) { return vbslq_f32(vcgtq_f32(cond, threshold), b, a); }
+
+    static Float floor(Float v, int* outInts) {
+        const Float f = vrndmq_f32(v);
+        vst1q_s32(outInts, vcvtq_s32_f32(f));
+        return f;
+    }
+};
+#else
+struct NoiseLanes {
+    typedef float Float;
+    static const int width = 1;
+
+    static Float load(const float* p) { return *p; }
+    static void store(float* p, Float v) { *p = v; }
+    static Float set(float s) { return s; }
+    static Float add(Float a, Float b) { return a + b; }
+    static Float sub(Float a, Float b) { return a - b; }
+    static Float mul(Float a, Float b) { return a * b; }
+    static Float abs(Float v) { return std::abs(v); }
+    static Float min(Float a, Float b) { return std::min(a, b); }
+    static Float max(Float a, Float b) { return std::max(a, b); }
+    static Float select(Float a, Float b, Float cond, Float threshold) { return cond > threshold? b : a; }
+
+    static Float floor(Float v, int* outInts) {
+        const Float f = std::floor(v);
+        *outInts = (int) f;
+        return f;
+    }
+};
+#endif
+
+// Perlin noise at 8 points (x[i], y[i], z[i]), optionally mirrored to abs(p) first. cellGradients(X, Y,
+// Z, outIndices) gives the indices in gradients of the 8 corners of the lattice cell (X, Y, Z), corner
+// bit 0 being +x, bit 1 +y and bit 2 +z. The expressions are the ones of the scalar noise, see
+// PerlinNoiseGenerator::noise(simd::float3)
+template<typename CellGradients>
+void evaluateNoiseLanes8(const float* xs, const float* ys, const float* zs, float* out, bool mirrored,
+                         const simd::float3* gradients, CellGradients&& cellGradients) {
+    typedef NoiseLanes L;
+    const int width = L::width;
+    const L::Float one = L::set(1);
+
+    auto fade = [](L::Float t) {
+        const L::Float t3 = L::mul(L::mul(t, t), t);
+        const L::Float inner = L::sub(L::mul(t, L::set(6)), L::set(15));
+        return L::mul(t3, L::add(L::mul(t, inner), L::set(10)));
+    };
+    auto lerp = [](L::Float t, L::Float a, L::Float b) {
+        return L::add(a, L::mul(t, L::sub(b, a)));
+    };
+
+    for(int base = 0; base < 8; base += width) {
+        L::Float x = L::load(xs + base);
+        L::Float y = L::load(ys + base);
+        L::Float z = L::load(zs + base);
+        if(mirrored) {
+            x = L::abs(x);
+            y = L::abs(y);
+            z = L::abs(z);
+        }
+
+        // xyz becomes fractional part of input
+        int X[width], Y[width], Z[width];
+        x = L::sub(x, L::floor(x, X));
+        y = L::sub(y, L::floor(y, Y));
+        z = L::sub(z, L::floor(z, Z));
+
+        // gradient of each corner of each lane's cell
+        float gx[8][width], gy[8][width], gz[8][width];
+        for(int i = 0; i < width; i++) {
+            std::array<uint8_t, 8> cell;
+            cellGradients(X[i], Y[i], Z[i], cell);
+            for(int c = 0; c < 8; c++) {
+                const simd::float3& g = gradients[cell[c]];
+                gx[c][i] = g.x;
+                gy[c][i] = g.y;
+                gz[c][i] = g.z;
+            }
+        }
+
+        const L::Float u = fade(x);
+        const L::Float v = fade(y);
+        const L::Float w = fade(z);
+
+        // contribution of each corner, the dot product with its offset from the point (one gradient
+        // component is always 0, so the sum rounds the same in any order)
+        const L::Float dx[2] = {x, L::sub(x, one)};
+        const L::Float dy[2] = {y, L::sub(y, one)};
+        const L::Float dz[2] = {z, L::sub(z, one)};
+        L::Float n[8];
+        for(int c = 0; c < 8; c++) {
+            n[c] = L::add(L::add(L::mul(L::load(gx[c]), dx[c & 1]), L::mul(L::load(gy[c]), dy[(c >> 1) & 1])),
+                          L::mul(L::load(gz[c]), dz[(c >> 2) & 1]));
+        }
+
+        const L::Float nx00 = lerp(u, n[0], n[1]);
+        const L::Float nx01 = lerp(u, n[4], n[5]);
+        const L::Float nx10 = lerp(u, n[2], n[3]);
+        const L::Float nx11 = lerp(u, n[6], n[7]);
+        const L::Float nxy0 = lerp(v, nx00, nx10);
+        const L::Float nxy1 = lerp(v, nx01, nx11);
+        L::store(out + base, lerp(w, nxy0, nxy1));
+    }
+}
+
+// the noise at count points in batches of 8, the last points padded to a batch with the point at 0.
+// noise8(x, y, z, out) evaluates one batch
+template<typename Noise8>
+void fillNoiseInBatches(const float* x, const float* y, const float* z, int count, float* out, Noise8&& noise8) {
+    int i = 0;
+    for(; i + 8 <= count; i += 8) {
+        noise8(x + i, y + i, z + i, out + i);
+    }
+
+    if(i < count) {
+        const int rest = count - i;
+        float padX[8] = {}, padY[8] = {}, padZ[8] = {}, padOut[8];
+        for(int j = 0; j < rest; j++) {
+            padX[j] = x[i + j];
+            padY[j] = y[i + j];
+            padZ[j] = z[i + j];
+        }
+        noise8(padX, padY, padZ, padOut);
+        for(int j = 0; j < rest; j++) {
+            out[i + j] = padOut[j];
+        }
+    }
+}
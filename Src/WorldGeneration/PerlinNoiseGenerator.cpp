@@ -4,7 +4,15 @@
 //
 //  Created by Ronnin Padilla on 8/10/24.
 //
+
+// noise(simd::float3) and the batched noise have to round alike, so no multiply and add are fused into
+// an FMA in this file (which clang otherwise does on arm64)
+#if defined(__clang__)
+#pragma STDC FP_CONTRACT OFF
+#endif
+
 #include "PerlinNoiseGenerator.hpp"
+#include "NoiseLanes.hpp"
 #include <random>
 #include <cstdlib>
 #include <cassert>
@@ -112,6 +120,8 @@ PerlinNoiseGenerator::PerlinNoiseGenerator(simd::int3 resolution)
     cornerGradients.insert({std::make_tuple(resX,0,resZ), uniGradient(rng)});
     cornerGradients.insert({std::make_tuple(0,resY,resZ), uniGradient(rng)});
     cornerGradients.insert({std::make_tuple(resX,resY,resZ), uniGradient(rng)});
+    
+    buildCellGradients();
 }
 
 float PerlinNoiseGenerator::noise(float v) {
@@ -322,7 +332,38 @@ void PerlinNoiseGenerator::syncFace(const PerlinNoiseGenerator& source, int srcF
         
         assert(srcVal >= 0 && srcVal < 12);
     }
+    
+    buildCellGradients();
 }
 
+void PerlinNoiseGenerator::buildCellGradients() {
+    cellGradients.resize((size_t) resolution.x * resolution.y * resolution.z);
+    for(int X = 0; X < resolution.x; X++) {
+        for(int Y = 0; Y < resolution.y; Y++) {
+            for(int Z = 0; Z < resolution.z; Z++) {
+                std::array<uint8_t, 8>& cell = cellGradients[(X * resolution.y + Y) * resolution.z + Z];
+                for(int c = 0; c < 8; c++) {
+                    cell[c] = (uint8_t) getGradientIndex(X + (c & 1), Y + ((c >> 1) & 1), Z + ((c >> 2) & 1));
+                }
+            }
+        }
+    }
+}
+
+void PerlinNoiseGenerator::noise8(const float* x, const float* y, const float* z, float* out) const {
+    evaluateNoiseLanes8(x, y, z, out, true, gradients3D, [this](int X, int Y, int Z, std::array<uint8_t, 8>& outIndices) {
+        assert(X < resolution.x && Y < resolution.y && Z < resolution.z);
+        outIndices = cellGradients[(X * resolution.y + Y) * resolution.z + Z];
+    });
+}
 
+void PerlinNoiseGenerator::noise16(const float* x, const float* y, const float* z, float* out) const {
+    noise8(x, y, z, out);
+    noise8(x + 8, y + 8, z + 8, out + 8);
+}
 
+void PerlinNoiseGenerator::fillNoise(const float* x, const float* y, const float* z, int count, float* out) const {
+    fillNoiseInBatches(x, y, z, count, out, [this](const float* x, const float* y, const float* z, float* out) {
+        noise8(x, y, z, out);
+    });
+}
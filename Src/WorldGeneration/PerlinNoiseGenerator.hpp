@@ -1,7 +1,9 @@
 #pragma once
 #include <simd/simd.h>
 #include <vector>
+#include <array>
 #include <map>
+#include <cstdint>
 
 /*
  https://github.com/keijiro/PerlinNoise/blob/master/Assets/Perlin.cs
@@ -22,12 +24,25 @@ public:
     float noise(simd::float2 v);
     float noise(simd::float3 v);
     
+    // Batched noise(simd::float3): out[i] is the noise at (x[i], y[i], z[i]), to the bit (the lanes go
+    // through AVX2, SSE2 or NEON, the same float operations in the same order). The points must lie
+    // within the resolution, i.e. abs(coordinate) < resolution along each axis
+    void noise8(const float* x, const float* y, const float* z, float* out) const;
+    void noise16(const float* x, const float* y, const float* z, float* out) const;
+    
+    // noise at count points, e.g. a whole row or column of voxels (in batches of 8, the last points
+    // padded to a batch)
+    void fillNoise(const float* x, const float* y, const float* z, int count, float* out) const;
+    
     void syncFace(const PerlinNoiseGenerator& source, int srcFace, int dstFace);
     simd::int3 getResolution() const { return resolution; }
     
 private:
     int getGradientIndex(int X, int Y, int Z);
     
+    // cellGradients from getGradientIndex, after every change to the face and corner gradients
+    void buildCellGradients();
+    
     static float fade(float t) {
         return t * t * t * (t * (t * 6 - 15) + 10);
     }
@@ -57,4 +72,9 @@ private:
     
     std::array<std::vector<int>, 6> faceGradients;
     std::map<std::tuple<int,int,int>, int> cornerGradients;
+    
+    // gradient indices of the 8 corners of each lattice cell (X, Y, Z) at (X * resolution.y + Y) *
+    // resolution.z + Z, in the order of the offsets in noise(simd::float3) (corner bit 0 is +x, bit 1
+    // +y, bit 2 +z), so the batched noise needs no face tests or corner map lookups
+    std::vector<std::array<uint8_t, 8>> cellGradients;
 };
@@ -0,0 +1,455 @@
+#pragma once
+#include <simd/simd.h>
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cassert>
+#include <string>
+#include "WorldNoise.hpp"
+#include "NoiseGraph.hpp"
+#import "Voxel/VoxelTypes.hpp"
+
+enum class ETerrainGenerator {
+    // decides every voxel from two 3D noise samples (and the row above each column from two more)
+    Volumetric,
+    // decides the voxels from a 2D map of surface and stone heights per chunk column (TerrainHeightmap),
+    // shared by all the levels of the column. 3D noise is only sampled in a band around the surface, to
+    // roughen it with small overhangs
+    Heightmap,
+    // Volumetric's noise sampled on a coarse lattice of cells of a few voxels (including the lattice points
+    // on the chunk's far sides, which its neighbors sample as well), trilinearly interpolated for the voxels
+    CoarseLattice,
+    // evaluates a NoiseGraph loaded from a config file at every voxel (see TerrainGenerator::fillFromGraph)
+    NoiseGraph
+};
+
+// How far ETerrainGenerator::CoarseLattice is from sampling the noise at every voxel (Volumetric),
+// accumulated over chunks
+struct TerrainLatticeError {
+    size_t numVoxels = 0;
+    // voxels (and rows above the chunks) whose type differs
+    size_t numDifferingVoxels = 0;
+    // absolute differences of the interpolated terrain noise
+    double sumNoiseError = 0.0;
+    float maxNoiseError = 0.0f;
+
+    void add(const TerrainLatticeError& other) {
+        numVoxels += other.numVoxels;
+        numDifferingVoxels += other.numDifferingVoxels;
+        sumNoiseError += other.sumNoiseError;
+        maxNoiseError = std::max(maxNoiseError, other.maxNoiseError);
+    }
+};
+
+// The terrain of one chunk column as heights per voxel column, in world-space y. Cached per column by
+// the engine and shared by the column's levels; nothing else samples it (neighbors and lower levels of
+// detail read the generated voxels)
+struct TerrainHeightmap {
+    int sizeX = 0;
+    int sizeZ = 0;
+    // voxels below the surface are solid (before the overhang band)
+    std::vector<float> surfaceHeights;
+    // solid voxels below this are stone, dirt above
+    std::vector<float> stoneHeights;
+    float maxSurfaceHeight = 0.0f;
+    // noise samples it took to build
+    size_t numNoiseSamples = 0;
+
+    float getSurfaceHeight(int x, int z) const { return surfaceHeights[x * sizeZ + z]; }
+    float getStoneHeight(int x, int z) const { return stoneHeights[x * sizeZ + z]; }
+};
+
+// First pass of MTLEngine::generateChunk, the chunk's terrain voxels (stone, dirt, grass and water).
+//
+// Both generators sample the WorldNoise with one lattice cell per chunk. Volumetric keeps the original
+// terrain: a voxel is air when noise(p) plus a bias growing with the height is positive, and stone below
+// a second, coarser noise. Heightmap solves the same rule for the
+// height once per voxel column, on one slice of the noise, so a chunk of 16x32x16 voxels takes 2 noise
+// samples per column (per chunk column, not per level) instead of 66 per column and level. CoarseLattice
+// keeps Volumetric's terrain up to the interpolation, from 2 noise samples per lattice point (450 per
+// chunk with 4-voxel cells). NoiseGraph leaves the shape to a graph of noise nodes, the default one
+// (Assets/Terrain/terrain.noisegraph) being Volumetric's terrain.
+class TerrainGenerator {
+public:
+    static const int seaLevel = 5;
+
+    // the surface and stone heights of the chunk column at (chunkX, chunkZ)
+    static TerrainHeightmap createHeightmap(const WorldNoise& noise, int chunkX, int chunkZ, const Int3D& chunkDims) {
+        TerrainHeightmap heightmap;
+        heightmap.sizeX = chunkDims.x;
+        heightmap.sizeZ = chunkDims.z;
+
+        const int numColumns = chunkDims.x * chunkDims.z;
+        std::vector<float> x(numColumns), y(numColumns), z(numColumns);
+        std::vector<float> stoneX(numColumns), stoneY(numColumns), stoneZ(numColumns);
+        for(int cx = 0; cx < chunkDims.x; cx++) {
+            for(int cz = 0; cz < chunkDims.z; cz++) {
+                const int i = cx * chunkDims.z + cz;
+                x[i] = (float) (chunkX * chunkDims.x + cx) / chunkDims.x;
+                y[i] = surfaceNoiseSliceY;
+                z[i] = (float) (chunkZ * chunkDims.z + cz) / chunkDims.z;
+                // same scale as the volumetric stone noise, at half the position
+                stoneX[i] = x[i] * 0.5f;
+                stoneY[i] = surfaceNoiseSliceY * 0.5f;
+                stoneZ[i] = z[i] * 0.5f;
+            }
+        }
+
+        heightmap.surfaceHeights.resize(numColumns);
+        heightmap.stoneHeights.resize(numColumns);
+        noise.fillNoise(x.data(), y.data(), z.data(), numColumns, heightmap.surfaceHeights.data());
+        noise.fillNoise(stoneX.data(), stoneY.data(), stoneZ.data(), numColumns, heightmap.stoneHeights.data());
+        heightmap.numNoiseSamples = 2 * numColumns;
+
+        heightmap.maxSurfaceHeight = -INFINITY;
+        for(int i = 0; i < numColumns; i++) {
+            // air where noise + height bias > 0
+            heightmap.surfaceHeights[i] = (float) (-heightmap.surfaceHeights[i] * chunkDims.y / heightBias);
+            heightmap.stoneHeights[i] = stoneHeightOfNoise(heightmap.stoneHeights[i]);
+            heightmap.maxSurfaceHeight = std::max(heightmap.maxSurfaceHeight, heightmap.surfaceHeights[i]);
+        }
+        return heightmap;
+    }
+
+    // Fills the chunk at chunkIndex from 3D noise at every voxel. Returns the number of noise samples
+    template<typename ChunkType>
+    static size_t fillVolumetric(ChunkType& chunk, const WorldNoise& noise, const Int3D& chunkIndex) {
+        const Int3D dims = chunk.getDimensions();
+        const int baseX = chunkIndex.x * dims.x;
+        const int baseY = chunkIndex.y * dims.y;
+        const int baseZ = chunkIndex.z * dims.z;
+
+        // The noise stays well within [-1.5, 1.5], so once the height bias alone outweighs it the whole
+        // chunk is air. It's left untouched (all-None sections stay uniform, and cost no memory), so
+        // levels above the terrain are nearly free to generate.
+        const float maxNoiseMagnitude = 1.5f;
+        if(baseY >= seaLevel && ((float) baseY / dims.y) * heightBias > maxNoiseMagnitude) {
+            return 0;
+        }
+
+        // sample points of a column, from its bottom row to the row above the chunk, and their noise
+        // (a whole column at a time through the batched noise)
+        const int numColumnSamples = dims.y + 1;
+        std::vector<float> sampleX(numColumnSamples), sampleY(numColumnSamples), sampleZ(numColumnSamples);
+        std::vector<float> halfX(numColumnSamples), halfY(numColumnSamples), halfZ(numColumnSamples);
+        std::vector<float> columnNoise(numColumnSamples), stoneNoise(numColumnSamples);
+        size_t numNoiseSamples = 0;
+
+        for(int x = 0; x < dims.x; x++) {
+            for(int z = 0; z < dims.z; z++) {
+                for(int i = 0; i < numColumnSamples; i++) {
+                    const simd::float3 v = sampleNoisePoint(baseX + x, baseY + i, baseZ + z, dims);
+                    sampleX[i] = v.x;
+                    sampleY[i] = v.y;
+                    sampleZ[i] = v.z;
+                    halfX[i] = v.x * 0.5f;
+                    halfY[i] = v.y * 0.5f;
+                    halfZ[i] = v.z * 0.5f;
+                }
+                noise.fillNoise(sampleX.data(), sampleY.data(), sampleZ.data(), numColumnSamples, columnNoise.data());
+                noise.fillNoise(halfX.data(), halfY.data(), halfZ.data(), numColumnSamples, stoneNoise.data());
+                numNoiseSamples += 2 * numColumnSamples;
+
+                fillColumn(chunk, x, z, baseY, [&](int worldY)->EVoxelType {
+                    const int i = worldY - baseY;
+                    return volumetricType(worldY, dims.y, columnNoise[i], stoneNoise[i]);
+                });
+            }
+        }
+        return numNoiseSamples;
+    }
+
+    // Fills the chunk at chunkIndex like fillVolumetric, from the noise at every latticeSpacing voxels
+    // (which must divide the chunk's dimensions) interpolated in between. With outError, the noise is
+    // also sampled at every voxel and the differences are added to it. Returns the number of noise
+    // samples (without the ones for outError)
+    template<typename ChunkType>
+    static size_t fillFromLattice(ChunkType& chunk, const WorldNoise& noise, const Int3D& chunkIndex, int latticeSpacing,
+                                  TerrainLatticeError* outError = nullptr) {
+        const Int3D dims = chunk.getDimensions();
+        assert(dims.x % latticeSpacing == 0 && dims.y % latticeSpacing == 0 && dims.z % latticeSpacing == 0);
+        const int baseX = chunkIndex.x * dims.x;
+        const int baseY = chunkIndex.y * dims.y;
+        const int baseZ = chunkIndex.z * dims.z;
+
+        const float maxNoiseMagnitude = 1.5f;
+        if(baseY >= seaLevel && ((float) baseY / dims.y) * heightBias > maxNoiseMagnitude) {
+            return 0;
+        }
+
+        // lattice points from the chunk's near sides to its far sides inclusive, the far ones being the
+        // neighbors' near ones (the top row is also the row above the chunk, for the grass)
+        const Int3D cells = {dims.x / latticeSpacing, dims.y / latticeSpacing, dims.z / latticeSpacing};
+        const Int3D points = {cells.x + 1, cells.y + 1, cells.z + 1};
+        const int numPoints = points.x * points.y * points.z;
+        auto pointIndex = [&points](int i, int j, int k) { return (i * points.y + j) * points.z + k; };
+
+        std::vector<float> x(numPoints), y(numPoints), z(numPoints);
+        std::vector<float> halfX(numPoints), halfY(numPoints), halfZ(numPoints);
+        for(int i = 0; i < points.x; i++) {
+            for(int j = 0; j < points.y; j++) {
+                for(int k = 0; k < points.z; k++) {
+                    const int p = pointIndex(i, j, k);
+                    // the same sample points as fillVolumetric
+                    const simd::float3 v = sampleNoisePoint(baseX + i * latticeSpacing, baseY + j * latticeSpacing,
+                                                            baseZ + k * latticeSpacing, dims);
+                    x[p] = v.x;
+                    y[p] = v.y;
+                    z[p] = v.z;
+                    halfX[p] = v.x * 0.5f;
+                    halfY[p] = v.y * 0.5f;
+                    halfZ[p] = v.z * 0.5f;
+                }
+            }
+        }
+        std::vector<float> latticeNoise(numPoints), latticeStoneNoise(numPoints);
+        noise.fillNoise(x.data(), y.data(), z.data(), numPoints, latticeNoise.data());
+        noise.fillNoise(halfX.data(), halfY.data(), halfZ.data(), numPoints, latticeStoneNoise.data());
+
+        // a voxel column's noise, interpolated from the lattice (and exact, for outError)
+        const int numColumnSamples = dims.y + 1;
+        std::vector<float> columnNoise(numColumnSamples), columnStoneNoise(numColumnSamples);
+        std::vector<float> rowNoise(points.y), rowStoneNoise(points.y);
+        std::vector<float> exactX(numColumnSamples), exactY(numColumnSamples), exactZ(numColumnSamples);
+        std::vector<float> exactHalfX(numColumnSamples), exactHalfY(numColumnSamples), exactHalfZ(numColumnSamples);
+        std::vector<float> exactNoise(numColumnSamples), exactStoneNoise(numColumnSamples);
+        TerrainLatticeError error;
+
+        for(int vx = 0; vx < dims.x; vx++) {
+            const int i = vx / latticeSpacing;
+            const float tx = (float) (vx % latticeSpacing) / latticeSpacing;
+            for(int vz = 0; vz < dims.z; vz++) {
+                const int k = vz / latticeSpacing;
+                const float tz = (float) (vz % latticeSpacing) / latticeSpacing;
+
+                // bilinear in x and z at every lattice row, then linear in y
+                for(int j = 0; j < points.y; j++) {
+                    rowNoise[j] = bilinear(latticeNoise, pointIndex(i, j, k), pointIndex(i + 1, j, k), pointIndex(i, j, k + 1),
+                                           pointIndex(i + 1, j, k + 1), tx, tz);
+                    rowStoneNoise[j] = bilinear(latticeStoneNoise, pointIndex(i, j, k), pointIndex(i + 1, j, k), pointIndex(i, j, k + 1),
+                                                pointIndex(i + 1, j, k + 1), tx, tz);
+                }
+                for(int vy = 0; vy < numColumnSamples; vy++) {
+                    const int j = std::min(vy / latticeSpacing, cells.y - 1);
+                    const float ty = (float) (vy - j * latticeSpacing) / latticeSpacing;
+                    columnNoise[vy] = rowNoise[j] + ty * (rowNoise[j + 1] - rowNoise[j]);
+                    columnStoneNoise[vy] = rowStoneNoise[j] + ty * (rowStoneNoise[j + 1] - rowStoneNoise[j]);
+                }
+
+                fillColumn(chunk, vx, vz, baseY, [&](int worldY)->EVoxelType {
+                    const int vy = worldY - baseY;
+                    return volumetricType(worldY, dims.y, columnNoise[vy], columnStoneNoise[vy]);
+                });
+
+                if(outError != nullptr) {
+                    for(int vy = 0; vy < numColumnSamples; vy++) {
+                        const simd::float3 v = sampleNoisePoint(baseX + vx, baseY + vy, baseZ + vz, dims);
+                        exactX[vy] = v.x;
+                        exactY[vy] = v.y;
+                        exactZ[vy] = v.z;
+                        exactHalfX[vy] = v.x * 0.5f;
+                        exactHalfY[vy] = v.y * 0.5f;
+                        exactHalfZ[vy] = v.z * 0.5f;
+                    }
+                    noise.fillNoise(exactX.data(), exactY.data(), exactZ.data(), numColumnSamples, exactNoise.data());
+                    noise.fillNoise(exactHalfX.data(), exactHalfY.data(), exactHalfZ.data(), numColumnSamples, exactStoneNoise.data());
+                    for(int vy = 0; vy < numColumnSamples; vy++) {
+                        const int worldY = baseY + vy;
+                        const float noiseError = std::abs(columnNoise[vy] - exactNoise[vy]);
+                        error.sumNoiseError += noiseError;
+                        error.maxNoiseError = std::max(error.maxNoiseError, noiseError);
+                        error.numDifferingVoxels += volumetricType(worldY, dims.y, columnNoise[vy], columnStoneNoise[vy]) !=
+                                                    volumetricType(worldY, dims.y, exactNoise[vy], exactStoneNoise[vy]);
+                        error.numVoxels++;
+                    }
+                }
+            }
+        }
+
+        if(outError != nullptr) {
+            outError->add(error);
+        }
+        return 2 * numPoints;
+    }
+
+    // the outputs of the plans fillFromGraph takes, in that order
+    static std::vector<std::string> getGraphOutputNames() {
+        return {"solid", "stone"};
+    }
+
+    // Fills the chunk at chunkIndex from a plan of the graph outputs getGraphOutputNames(): a voxel is solid
+    // where "solid" > 0, and stone rather than dirt where "stone" > 0 as well (the bottom row is always
+    // stone). The whole chunk is evaluated as one block. Returns the number of noise samples
+    template<typename ChunkType>
+    static size_t fillFromGraph(ChunkType& chunk, const NoiseGraphPlan& plan, const Int3D& chunkIndex) {
+        assert(plan.getNumOutputs() == 2);
+        const Int3D dims = chunk.getDimensions();
+        const int baseX = chunkIndex.x * dims.x;
+        const int baseY = chunkIndex.y * dims.y;
+        const int baseZ = chunkIndex.z * dims.z;
+
+        // "solid" can't be positive anywhere in the chunk (or the row above it), it stays uniform air
+        if(baseY >= seaLevel && plan.getOutputBounds(0, (float) baseY, (float) (baseY + dims.y)).second <= 0) {
+            return 0;
+        }
+
+        // every column from its bottom row to the row above the chunk
+        const int numColumnSamples = dims.y + 1;
+        const int numPoints = dims.x * dims.z * numColumnSamples;
+        std::vector<float> x(numPoints), y(numPoints), z(numPoints), solid(numPoints), stone(numPoints);
+        for(int vx = 0; vx < dims.x; vx++) {
+            for(int vz = 0; vz < dims.z; vz++) {
+                const int column = (vx * dims.z + vz) * numColumnSamples;
+                for(int i = 0; i < numColumnSamples; i++) {
+                    x[column + i] = (float) (baseX + vx);
+                    y[column + i] = (float) (baseY + i);
+                    z[column + i] = (float) (baseZ + vz);
+                }
+            }
+        }
+        float* const outputs[2] = {solid.data(), stone.data()};
+        plan.evaluate(x.data(), y.data(), z.data(), numPoints, outputs);
+
+        for(int vx = 0; vx < dims.x; vx++) {
+            for(int vz = 0; vz < dims.z; vz++) {
+                const int column = (vx * dims.z + vz) * numColumnSamples;
+                fillColumn(chunk, vx, vz, baseY, [&](int worldY)->EVoxelType {
+                    if(worldY == 0) {
+                        return EVoxelType::Stone;
+                    }
+                    const int i = column + worldY - baseY;
+                    if(solid[i] <= 0) {
+                        return EVoxelType::None;
+                    }
+                    return stone[i] > 0? EVoxelType::Stone : EVoxelType::Dirt;
+                });
+            }
+        }
+        return (size_t) numPoints * plan.getNumNoiseSamplesPerPoint();
+    }
+
+    // Fills the chunk at chunkIndex from the heightmap of its chunk column. Within overhangBand voxels of
+    // the surface, 3D noise moves it by up to overhangBand (0 gives a plain heightfield). Returns the
+    // number of noise samples, not counting the heightmap's
+    template<typename ChunkType>
+    static size_t fillFromHeightmap(ChunkType& chunk, const WorldNoise& noise, const TerrainHeightmap& heightmap,
+                                    const Int3D& chunkIndex, int overhangBand) {
+        const Int3D dims = chunk.getDimensions();
+        const int baseX = chunkIndex.x * dims.x;
+        const int baseY = chunkIndex.y * dims.y;
+        const int baseZ = chunkIndex.z * dims.z;
+        const float band = (float) overhangBand;
+
+        // nothing is solid (or water) this high up, the chunk stays uniform air
+        if(baseY >= seaLevel && baseY >= heightmap.maxSurfaceHeight + band) {
+            return 0;
+        }
+
+        // the band's rows of a column, in this level or the row above it
+        std::vector<float> bandX(dims.y + 1), bandY(dims.y + 1), bandZ(dims.y + 1), bandNoise(dims.y + 1);
+        size_t numNoiseSamples = 0;
+
+        for(int x = 0; x < dims.x; x++) {
+            for(int z = 0; z < dims.z; z++) {
+                const float surface = heightmap.getSurfaceHeight(x, z);
+                const float stone = heightmap.getStoneHeight(x, z);
+
+                // rows strictly within the band, i.e. surface - band < worldY < surface + band
+                const int firstBandY = std::max(baseY, (int) std::floor(surface - band) + 1);
+                const int lastBandY = std::min(baseY + dims.y, (int) std::ceil(surface + band) - 1);
+                const int numBandRows = std::max(0, lastBandY - firstBandY + 1);
+                for(int i = 0; i < numBandRows; i++) {
+                    bandX[i] = (baseX + x) * overhangNoiseScale;
+                    bandY[i] = (firstBandY + i) * overhangNoiseScale;
+                    bandZ[i] = (baseZ + z) * overhangNoiseScale;
+                }
+                if(numBandRows > 0) {
+                    noise.fillNoise(bandX.data(), bandY.data(), bandZ.data(), numBandRows, bandNoise.data());
+                    numNoiseSamples += numBandRows;
+                }
+
+                fillColumn(chunk, x, z, baseY, [&](int worldY)->EVoxelType {
+                    if(worldY == 0) {
+                        return EVoxelType::Stone;
+                    }
+                    float depth = surface - worldY;
+                    if(worldY >= firstBandY && worldY <= lastBandY) {
+                        depth -= band * bandNoise[worldY - firstBandY];
+                    }
+                    if(depth <= 0) {
+                        return EVoxelType::None;
+                    }
+                    return worldY < stone? EVoxelType::Stone : EVoxelType::Dirt;
+                });
+            }
+        }
+        return numNoiseSamples;
+    }
+
+private:
+    // weight of the height bias, a voxel is air when noise + (worldY / chunk height) * heightBias > 0
+    static constexpr double heightBias = 0.9;
+    // the slice of the noise the heightmap is sampled on, halfway up the chunk (the noise is 0 on the
+    // lattice planes)
+    static constexpr float surfaceNoiseSliceY = 0.5f;
+    // lattice cells per voxel of the overhang band's noise
+    static constexpr float overhangNoiseScale = 1.0f / 8;
+
+    // the top of the stone layer, from the stone noise
+    static float stoneHeightOfNoise(float stoneNoise) {
+        return seaLevel + (-25 * stoneNoise + 5);
+    }
+
+    // Where Volumetric samples the terrain noise for the world-space voxel, one lattice cell of the noise
+    // per chunk along each axis, so every level gets its own 3D terrain (thinning out into air as the
+    // height bias grows). The stone noise is sampled at half of it
+    static simd::float3 sampleNoisePoint(int worldX, int worldY, int worldZ, const Int3D& chunkDims) {
+        return simd::make_float3(worldX, worldY, worldZ) / simd::make_float3(chunkDims.x, chunkDims.y, chunkDims.z);
+    }
+
+    // Volumetric's type of the voxel (without grass or water) from its terrain and stone noise
+    static EVoxelType volumetricType(int worldY, int chunkHeight, float terrainNoise, float stoneNoise) {
+        if(worldY == 0) {
+            return EVoxelType::Stone;
+        }
+        // if y is high, more chance of being None
+        if(terrainNoise + ((float) worldY / chunkHeight) * heightBias > 0) {
+            return EVoxelType::None;
+        }
+        return worldY < stoneHeightOfNoise(stoneNoise)? EVoxelType::Stone : EVoxelType::Dirt;
+    }
+
+    static float bilinear(const std::vector<float>& values, int i00, int i10, int i01, int i11, float tx, float tz) {
+        const float v0 = values[i00] + tx * (values[i10] - values[i00]);
+        const float v1 = values[i01] + tx * (values[i11] - values[i01]);
+        return v0 + tz * (v1 - v0);
+    }
+
+    // Walks up the column at (x, z) from the chunk's bottom row. terrainType(worldY) is the type of the
+    // voxel without grass or water, for the chunk's rows and the row above it, which decides whether the
+    // top row's dirt is topped with grass
+    template<typename ChunkType, typename TerrainType>
+    static void fillColumn(ChunkType& chunk, int x, int z, int baseY, TerrainType&& terrainType) {
+        const Int3D dims = chunk.getDimensions();
+        EVoxelType voxelType = terrainType(baseY);
+
+        for(int y = 0; y < dims.y; y++) {
+            const int worldY = baseY + y;
+            const EVoxelType aboveType = terrainType(worldY + 1);
+
+            EVoxelType outType = voxelType;
+
+            if(outType == EVoxelType::Dirt && aboveType == EVoxelType::None) {
+                outType = EVoxelType::Grass;
+            }
+
+            if(outType == EVoxelType::None && worldY < seaLevel) {
+                outType = EVoxelType::Water;
+            }
+
+            chunk.setVoxel({x, y, z}, outType);
+            voxelType = aboveType;
+        }
+    }
+};
@@ -0,0 +1,74 @@
+// noise(simd::float3) and the batched noise have to round alike, so no multiply and add are fused into
+// an FMA in this file (see PerlinNoiseGenerator.cpp)
+#if defined(__clang__)
+#pragma STDC FP_CONTRACT OFF
+#endif
+
+#include "WorldNoise.hpp"
+#include "PerlinNoiseGenerator.hpp"
+#include "NoiseLanes.hpp"
+#include <cmath>
+
+float WorldNoise::noise(simd::float3 p) const {
+    const float fx = std::floor(p.x);
+    const float fy = std::floor(p.y);
+    const float fz = std::floor(p.z);
+    const int X = (int) fx;
+    const int Y = (int) fy;
+    const int Z = (int) fz;
+
+    // fractional part of the position
+    const float x = p.x - fx;
+    const float y = p.y - fy;
+    const float z = p.z - fz;
+
+    const float u = fade(x);
+    const float v = fade(y);
+    const float w = fade(z);
+
+    // contribution of each corner (bit 0 is +x, bit 1 +y, bit 2 +z), the dot product of its gradient
+    // with its offset from the point
+    float n[8];
+    for(int c = 0; c < 8; c++) {
+        const int dx = c & 1;
+        const int dy = (c >> 1) & 1;
+        const int dz = (c >> 2) & 1;
+        const simd::float3& g = PerlinNoiseGenerator::gradients3D[getGradientIndex(X + dx, Y + dy, Z + dz)];
+        n[c] = g.x * (dx? x - 1 : x) + g.y * (dy? y - 1 : y) + g.z * (dz? z - 1 : z);
+    }
+
+    const float nx00 = lerp(u, n[0], n[1]);
+    const float nx01 = lerp(u, n[4], n[5]);
+    const float nx10 = lerp(u, n[2], n[3]);
+    const float nx11 = lerp(u, n[6], n[7]);
+    const float nxy0 = lerp(v, nx00, nx10);
+    const float nxy1 = lerp(v, nx01, nx11);
+    return lerp(w, nxy0, nxy1);
+}
+
+void WorldNoise::noise8(const float* x, const float* y, const float* z, float* out) const {
+    // the points of a batch are mostly neighbors (e.g. a column of voxels), so the last cell's gradients
+    // are kept instead of hashing its corners again
+    int lastX = 0, lastY = 0, lastZ = 0;
+    bool hasLastCell = false;
+    std::array<uint8_t, 8> lastCell;
+    evaluateNoiseLanes8(x, y, z, out, false, PerlinNoiseGenerator::gradients3D,
+                        [&](int X, int Y, int Z, std::array<uint8_t, 8>& outIndices) {
+        if(!hasLastCell || X != lastX || Y != lastY || Z != lastZ) {
+            for(int c = 0; c < 8; c++) {
+                lastCell[c] = (uint8_t) getGradientIndex(X + (c & 1), Y + ((c >> 1) & 1), Z + ((c >> 2) & 1));
+            }
+            lastX = X;
+            lastY = Y;
+            lastZ = Z;
+            hasLastCell = true;
+        }
+        outIndices = lastCell;
+    });
+}
+
+void WorldNoise::fillNoise(const float* x, const float* y, const float* z, int count, float* out) const {
+    fillNoiseInBatches(x, y, z, count, out, [this](const float* x, const float* y, const float* z, float* out) {
+        noise8(x, y, z, out);
+    });
+}
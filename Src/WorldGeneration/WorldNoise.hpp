@@ -0,0 +1,58 @@
+#pragma once
+#include <simd/simd.h>
+#include <cstdint>
+
+// Perlin noise over all of world space, from a single seed.
+//
+// The gradient of each lattice point is picked by hashing its integer coordinates with the seed, so the
+// noise is a pure function of the position: there are no tables to build or share, any chunk can be
+// generated on its own and on any thread, and neighboring chunks agree along their borders because they
+// sample the same function. Unlike PerlinNoiseGenerator it is not mirrored around 0.
+//
+// Thread-safe (all members are const).
+class WorldNoise {
+public:
+    explicit WorldNoise(uint32_t seed = 0) : seed(seed) {}
+
+    float noise(simd::float3 p) const;
+
+    // Batched noise(simd::float3), out[i] is the noise at (x[i], y[i], z[i]), to the bit (see NoiseLanes)
+    void noise8(const float* x, const float* y, const float* z, float* out) const;
+
+    // noise at count points, e.g. a whole row or column of voxels (in batches of 8, the last points
+    // padded to a batch)
+    void fillNoise(const float* x, const float* y, const float* z, int count, float* out) const;
+
+    uint32_t getSeed() const { return seed; }
+
+    // hash of the lattice point with the seed
+    static uint32_t hashLatticePoint(uint32_t seed, int X, int Y, int Z) {
+        uint32_t h = seed;
+        h ^= (uint32_t) X * 0x8da6b343u;
+        h ^= (uint32_t) Y * 0xd8163841u;
+        h ^= (uint32_t) Z * 0xcb1ab31fu;
+        // murmur3 finalizer, so nearby points get unrelated hashes
+        h ^= h >> 16;
+        h *= 0x85ebca6bu;
+        h ^= h >> 13;
+        h *= 0xc2b2ae35u;
+        h ^= h >> 16;
+        return h;
+    }
+
+private:
+    uint32_t seed;
+
+    // index in PerlinNoiseGenerator::gradients3D of the lattice point's gradient
+    int getGradientIndex(int X, int Y, int Z) const {
+        return hashLatticePoint(seed, X, Y, Z) % 12;
+    }
+
+    static float fade(float t) {
+        return t * t * t * (t * (t * 6 - 15) + 10);
+    }
+
+    static float lerp(float t, float a, float b) {
+        return a + t * (b - a);
+    }
+};
@@ -5,8 +5,15 @@
 //  Created by Ronnin Padilla on 7/19/24.
 //
 #include "Engine.hpp"
+#include "Benchmarks/VoxelBenchmarks.hpp"
+#include <string>
 
 int main(int argc, const char * argv[]) {
+    if(argc > 1 && std::string(argv[1]) == "--benchmark") {
+        VoxelBenchmarks::runAll();
+        return 0;
+    }
+    
     MTLEngine engine;
     engine.init();
     engine.run();